@@ -21,6 +21,12 @@ epicsEnvSet("CBUFFS", "500")
 # The search path for database files
 epicsEnvSet("EPICS_DB_INCLUDE_PATH", "$(ADCORE)/db")
 
+# prosilicaDiscoveryConfig(noDiscovery,    # 1 to initialize PvAPI without broadcast discovery
+#                          cacheFile,      # File mapping unique IDs to IP addresses, "" for none
+#                          refreshPeriod)  # Seconds between background refreshes of the cache, 0 for none
+# This must come before the first prosilicaConfig
+#prosilicaDiscoveryConfig(0, "prosilicaCameras.txt", 60)
+
 # prosilicaConfig(portName,    # The name of the asyn port to be created
 #                 cameraId,    # Unique ID, IP address, or IP name of the camera
 #                 maxBuffers,  # Maximum number of NDArray buffers driver can allocate. 0=unlimited
@@ -36,11 +42,25 @@ epicsEnvSet("EPICS_DB_INCLUDE_PATH", "$(ADCORE)/db")
 #prosilicaConfig("$(PORT)", 164.54.160.203, 50, 0)
 prosilicaConfig("$(PORT)", 5000698, 50, 0)
 
+# prosilicaGroupConfig(groupName,  # Name of the acquisition group
+#                      portNames,  # Port names of the member cameras, separated by spaces or commas
+#                      tolerance)  # Maximum difference in seconds between frame times of one trigger
+#prosilicaGroupConfig("STEREO", "PS1 PS2", 0.001)
+
+# prosilicaMetrics(fileName,  # OpenMetrics file with the counters of all cameras
+#                  period)    # Seconds between writes, 0 to write once
+#prosilicaMetrics("/var/lib/node_exporter/prosilica.prom", 10)
+
 asynSetTraceIOMask("$(PORT)",0,2)
 #asynSetTraceMask("$(PORT)",0,255)
 
 dbLoadRecords("$(ADPROSILICA)/db/prosilica.template","P=$(PREFIX),R=cam1:,PORT=$(PORT),ADDR=0,TIMEOUT=1")
 
+# Sub-region outputs of the driver on addresses 1 to 8.  A plugin gets a region by connecting to its address.
+#dbLoadRecords("$(ADPROSILICA)/db/prosilicaRegion.template","P=$(PREFIX),R=cam1:Region1:,PORT=$(PORT),ADDR=1,TIMEOUT=1")
+#NDStatsConfigure("STATS_REGION1", $(QSIZE), 0, "$(PORT)", 1, 0, 0)
+#NDTimeSeriesConfigure("STATS_REGION1_TS", $(QSIZE), 0, "$(PORT)", 1, 23)
+
 # Create a standard arrays plugin, set it to get data from first Prosilica driver.
 NDStdArraysConfigure("Image1", 5, 0, "$(PORT)", 0, 0)
 
@@ -27,12 +27,25 @@
 #include <epicsString.h>
 #include <epicsStdio.h>
 #include <epicsMutex.h>
+#include <epicsEvent.h>
+#include <epicsAtomic.h>
 #include <cantProceed.h>
 #include <osiSock.h>
 #include <iocsh.h>
 #include <epicsExit.h>
 
 #include "PvApi.h"
+#include "psHostStats.h"
+#include "psCameraCache.h"
+#include "psMetrics.h"
+#include "psPerfCounters.h"
+#include "psBayerKernels.h"
+#include "psRgbKernels.h"
+#include "psBinning.h"
+#include "psNuma.h"
+#include "psHistory.h"
+#include "psAttrStats.h"
+#include "psPtpTime.h"
 
 #include "ADDriver.h"
 
@@ -45,6 +58,8 @@
 static const char *driverName = "prosilica";
 
 static int PvApiInitialized;
+static int PvApiNoDiscovery;          /* PvAPI was initialized without broadcast discovery */
+static double discoveryRefreshPeriod; /* Seconds between refreshes of the camera cache, 0 for none */
 
 static ELLLIST *cameraList;
 
@@ -53,6 +68,169 @@ static ELLLIST *cameraList;
 
 #define CONNECT_RETRY_COUNT    30 /* Number of times to retry connecting */
 #define CONNECT_RETRY_INTERVAL  1 /* Time to sleep between trying to connect */
+#define MAX_DISCOVERY_CAMERAS  64 /* Number of cameras listed when the camera cache is refreshed */
+
+#define MAX_GROUP_CAMERAS       8 /**< Maximum number of cameras in an acquisition group */
+#define MAX_GROUP_SETS        256 /**< Number of trigger sets a group keeps open for frame matching.
+                                       This must cover the frames a camera can hold with StreamHold */
+#define DEFAULT_GROUP_TOLERANCE 0.001 /**< Default frame matching tolerance in seconds */
+#define DEFAULT_LINK_RATE   115000000 /**< Default StreamHold link rate in bytes/second */
+#define STREAM_HOLD_MIN_SLOT    0.005 /**< Minimum time a camera is released by the StreamHold coordinator */
+#define STREAM_HOLD_MARGIN        1.2 /**< Safety factor applied to the StreamHold drain time */
+
+#define NUM_REGIONS                 8 /**< Number of sub-region outputs, on asyn addresses 1 to NUM_REGIONS */
+#define MAX_THREAD_STATS          256 /**< Number of threads of the IOC sampled for the thread statistics */
+#define NUM_PERF_STAGES             3 /**< Number of frame callback stages measured with the hardware counters */
+#define LATENCY_RING_SIZE        1024 /**< Number of recent frame latencies kept for percentiles */
+#define NUM_HISTORY_SERIES          9 /**< Number of PSHistory_t series */
+#define HISTORY_SIZE             3600 /**< Samples kept of each history series */
+#define HISTORY_PERIOD            1.0 /**< Seconds between history samples */
+#define SOAK_WARMUP_FRACTION      0.1 /**< Fraction of the soak samples ignored when fitting trends */
+#define SOAK_MIN_SAMPLES            8 /**< Minimum number of soak samples needed to fit trends */
+#define SOAK_LINK_DROP_CYCLES      10 /**< The soak test disconnects the camera every this many cycles */
+#define SOAK_RSS_FLOOR        1048576 /**< RSS growth in bytes which is always tolerated */
+#define SOAK_LATENCY_FLOOR      0.001 /**< Latency growth in seconds which is always tolerated */
+#define NUM_SYNTH_FRAMES            4 /**< Synthetic frames which can be injected into the frame callback at once */
+#define STRESS_FRAME_THREADS        2 /**< Threads injecting frames in the stress test */
+#define STRESS_DRAIN_TIMEOUT     10.0 /**< Seconds the stress test waits for the plugins to release their arrays */
+#define HEADROOM_START_RATE      10.0 /**< Frames/s of the first step of the headroom benchmark */
+#define HEADROOM_RATE_STEP       1.25 /**< Factor between the rates of successive headroom steps */
+#define HEADROOM_MAX_RATE    100000.0 /**< Highest rate the headroom benchmark tries */
+#define HEADROOM_STEP_TIME        3.0 /**< Seconds of each headroom step */
+#define HEADROOM_QUEUE_GROWTH       4 /**< Arrays a queue may grow by in the second half of a step */
+#define HEADROOM_RATE_TOLERANCE  0.95 /**< Fraction of the step rate which must be injected */
+#define MAX_HEADROOM_PLUGINS       16 /**< Plugins watched by the headroom benchmark */
+#define NUM_ATTR_SLOWEST            8 /**< Attributes in the PS_ATTR_SLOWEST table and arrays */
+
+#define NUM_BAYER_CONVERT_MODES     5 /**< Number of PSBayerConvert_t modes */
+#define NUM_EST_PIXEL_FORMATS       6 /**< Pixel formats known to the frame rate estimator, Mono8 to Rgb48 */
+#define EST_PACKET_OVERHEAD        36 /**< IP, UDP and GVSP header bytes in each stream packet */
+#define EST_PACKETS_PER_FRAME       2 /**< Leader and trailer packets of each frame */
+#define EST_COST_FILTER           0.1 /**< Weight of each new frame in the measured processing cost */
+#define EST_DEFAULT_COST        1e-10 /**< Processing cost in seconds per pixel before it is measured */
+#define EST_DEFAULT_BAYER_COST   1e-8 /**< Bayer conversion cost in seconds per pixel before it is measured */
+
+#define NUM_SYNC_INPUTS             2 /**< Number of sync inputs which are monitored */
+#define DEFAULT_SYNC_IN_POLL_PERIOD  0.05 /**< Default period of the sync input poller in seconds */
+#define MIN_SYNC_IN_POLL_PERIOD     0.001 /**< Shortest period of the sync input poller, so it can not flood the control channel */
+/* Camera event IDs for the sync inputs.  Bit (ID - PS_EVENT_ID_BASE) enables the event in EventsEnable1. */
+#define PS_EVENT_ID_BASE        40000
+#define PS_EVENT_SYNC_IN1_RISE  40010
+#define PS_EVENT_SYNC_IN1_FALL  40011
+#define PS_EVENT_SYNC_IN2_RISE  40012
+#define PS_EVENT_SYNC_IN2_FALL  40013
+#define NUM_SYNC_OUTPUTS            3 /**< Number of sync outputs which can be GPO */
+#define GPO_LEVELS_MASK             ((1 << NUM_SYNC_OUTPUTS) - 1)
+#define MAX_GPO_PROGRAM_STEPS     256 /**< Maximum number of steps in a GPO program */
+#define GPO_SPIN_TIME           0.002 /**< The GPO program thread spins for this long before each deadline */
+#define GPO_MIN_STEP_TIME       0.001 /**< Minimum time between GPO steps, about one control channel round trip */
+#define PS_SYNC_IN_EVENT_MASK   ((1 << (PS_EVENT_SYNC_IN1_RISE - PS_EVENT_ID_BASE)) | \
+                                 (1 << (PS_EVENT_SYNC_IN1_FALL - PS_EVENT_ID_BASE)) | \
+                                 (1 << (PS_EVENT_SYNC_IN2_RISE - PS_EVENT_ID_BASE)) | \
+                                 (1 << (PS_EVENT_SYNC_IN2_FALL - PS_EVENT_ID_BASE)))
+
+struct prosilicaGroup;
+struct headroomPlugin;
+
+/** A region NDArray which uses the memory of its parent frame */
+class psViewArray : public NDArray {
+public:
+    psViewArray() : pParent(NULL) {}
+    NDArray *pParent;              /* Frame this array points into, reserved until this array is released */
+};
+
+/** Pool of the zero-copy region arrays.  Each array holds a reference to its parent frame,
+  * which is released when the last user releases the region array. */
+class psViewPool : public NDArrayPool {
+public:
+    psViewPool(asynNDArrayDriver *pDriver) : NDArrayPool(pDriver, 0) {}
+    NDArray *allocView(NDArray *pParent, int ndims, size_t *dims, size_t offset, size_t size);
+protected:
+    virtual NDArray *createArray() { return new psViewArray; }
+    virtual void onReleaseArray(NDArray *pArray);
+};
+
+/** Returns an array of size bytes at offset bytes into the memory of pParent, and reserves pParent */
+NDArray *psViewPool::allocView(NDArray *pParent, int ndims, size_t *dims, size_t offset, size_t size)
+{
+    psViewArray *pView;
+
+    pView = (psViewArray *)alloc(ndims, dims, pParent->dataType, size, (char *)pParent->pData + offset);
+    if (!pView) return NULL;
+    pParent->reserve();
+    pView->pParent = pParent;
+    return pView;
+}
+
+void psViewPool::onReleaseArray(NDArray *pArray)
+{
+    psViewArray *pView = (psViewArray *)pArray;
+    NDArray *pParent = pView->pParent;
+
+    if ((pArray->referenceCount > 0) || !pParent) return;
+    /* The memory belongs to the parent, so the pool must never free or reuse it */
+    pView->pParent = NULL;
+    pView->pData = NULL;
+    pView->dataSize = 0;
+    pParent->release();
+}
+
+/** An NDArray which remembers the node its memory was placed on */
+class psNumaArray : public NDArray {
+public:
+    psNumaArray() : pBound(NULL), boundNode(-1), pLocated(NULL), pageNode(-1) {}
+    void *pBound;                  /* Memory which was placed on boundNode */
+    int boundNode;
+    void *pLocated;                /* Memory whose node was looked up */
+    int pageNode;                  /* Node of the first page of pLocated, -1 if not known */
+};
+
+/** The NDArrayPool of the driver, which places the memory of the arrays on a NUMA node.
+  * The plugins allocate their output arrays from this pool too, so those are placed as well.
+  * Memory is only placed when it is new to an array, so recycled arrays cost nothing.  New
+  * memory which is to be placed is replaced with whole pages from psNumaAllocPages, which the
+  * pool frees with free() like its own; no array is allocated here with memory of the caller. */
+class psNumaPool : public NDArrayPool {
+public:
+    psNumaPool(asynNDArrayDriver *pDriver, size_t maxMemory) : NDArrayPool(pDriver, maxMemory), node(-1),
+        doubleReleases(0) {}
+    volatile int node;             /* Node for the memory, -1 to leave it where it is */
+    int doubleReleases;            /* Releases of arrays which were already free, updated with epicsAtomic */
+protected:
+    virtual NDArray *createArray() { return new psNumaArray; }
+    virtual void onAllocateArray(NDArray *pArray);
+    virtual void onReleaseArray(NDArray *pArray);
+};
+
+void psNumaPool::onAllocateArray(NDArray *pArray)
+{
+    psNumaArray *pNuma = (psNumaArray *)pArray;
+    int bindNode = this->node;
+    void *pPages;
+
+    if (!pArray->pData) return;
+    if ((bindNode >= 0) && ((pNuma->pBound != pArray->pData) || (pNuma->boundNode != bindNode))) {
+        if ((pNuma->pBound != pArray->pData) && ((pPages = psNumaAllocPages(pArray->dataSize)) != NULL)) {
+            free(pArray->pData);
+            pArray->pData = pPages;
+        }
+        psNumaBindMemory(pArray->pData, pArray->dataSize, bindNode);
+        pNuma->pBound = pArray->pData;
+        pNuma->boundNode = bindNode;
+        pNuma->pLocated = NULL;
+    }
+    /* The node is looked up once, rather than for every frame */
+    if (pNuma->pLocated != pArray->pData) {
+        pNuma->pageNode = psNumaPageNode(pArray->pData);
+        pNuma->pLocated = pArray->pData;
+    }
+}
+
+void psNumaPool::onReleaseArray(NDArray *pArray)
+{
+    /* NDArrayPool only prints an error, the stress test needs the count */
+    if (pArray->referenceCount < 0) epicsAtomicIncrIntT(&this->doubleReleases);
+}
 
 /** Driver for Prosilica GigE and CameraLink cameras using their PvApi library */
 class prosilica : public ADDriver {
@@ -69,21 +247,55 @@ public:
     /* These are the methods that we override from ADDriver */
     virtual asynStatus writeInt32(asynUser *pasynUser, epicsInt32 value);
     virtual asynStatus writeFloat64(asynUser *pasynUser, epicsFloat64 value);
+    virtual asynStatus writeInt32Array(asynUser *pasynUser, epicsInt32 *value, size_t nElements);
+    virtual asynStatus writeFloat64Array(asynUser *pasynUser, epicsFloat64 *value, size_t nElements);
+    virtual asynStatus readFloat64Array(asynUser *pasynUser, epicsFloat64 *value, size_t nElements, size_t *nIn);
     void report(FILE *fp, int details);
     
     /* These are called from C and so must be public */
      /* This is called by the AVT driver when the connection status of a camera changes */
     static void PVDECL cameraLinkCallback(void* Context, tPvInterface Interface, 
                                           tPvLinkEvent Event, unsigned long UniqueId);
-    void frameCallback(tPvFrame *pFrame);
+    void frameCallback(tPvFrame *pFrame, const epicsTimeStamp *pArrival, epicsUInt64 arrivalMonotonic);
+    void cameraEventCallback(const tPvCameraEvent *pEventList, unsigned long numEvents);
+    void syncInPollTask();
+    void gpoProgramTask();
+    void historyTask();
+    void roiSeqTask();
+    void portThreadStart();
     /* Removes the PvAPI callback functions and disconnects the camera */
     static void shutdown(void *arg);
+    /* Creates an acquisition group from existing cameras */
+    static asynStatus createGroup(const char *groupName, const char *portNames, double tolerance);
+    /* Starts or stops acquisition on all cameras in a group */
+    static asynStatus groupStart(prosilicaGroup *pGroup, int value);
+    /* Enables or disables the StreamHold coordinator of a group */
+    static asynStatus groupStreamHold(prosilicaGroup *pGroup, int enable, int linkRate);
+    /* The StreamHold coordinator thread of a group */
+    static void streamHoldTask(prosilicaGroup *pGroup);
+    static asynStatus startSoak(const char *portName, double hours, double cyclePeriod, double tolerance);
+    void soakTask();
+    static asynStatus startStress(const char *portName, double seconds, int writers, double linkPeriod);
+    static asynStatus startHeadroom(const char *portName, int sizeX, int sizeY, const char *pixelFormat,
+                                    const char *plugins);
+    /* Prints the latency of the attribute calls of a camera */
+    static asynStatus attrReport(const char *portName, int sort, int reset);
+    void headroomTask();
+    void stressTask();
+    void stressFrameTask();
+    void stressWriteTask();
+    void stressLinkTask();
 
  
 protected:
     int PSReadStatistics;
     #define FIRST_PS_PARAM PSReadStatistics
     int PSBayerConvert;
+    int PSRgbLayout;
+    int PSSoftBinX;
+    int PSSoftBinY;
+    int PSSoftBinMode;
+    int PSSoftBinType;
     int PSGainMode;
     int PSExposureMode;
     int PSDriverType;
@@ -121,17 +333,179 @@ protected:
     int PSStrobe1CtlDuration;
     int PSStrobe1Duration;
     int PSTemperatureMainboard;
-    #define LAST_PS_PARAM PSTemperatureMainboard
+    int PSGroupName;
+    int PSGroupAcquire;
+    int PSGroupSequence;
+    int PSGroupSetsComplete;
+    int PSGroupSetsIncomplete;
+    int PSStreamHold;
+    int PSStreamHoldLinkRate;
+    int PSStreamHoldCapacity;
+    int PSStreamHoldFrames;
+    int PSPtpMode;
+    int PSPtpStatus;
+    int PSPtpLocked;
+    int PSPtpOffset;
+    int PSSyncInMonitor;
+    int PSSyncInPollPeriod;
+    int PSSyncInResetCounts;
+    int PSSyncIn1Count;
+    int PSSyncIn2Count;
+    int PSSyncIn1EdgeTime;
+    int PSSyncIn2EdgeTime;
+    int PSSyncOutGpoLevels;
+    int PSGpoPulse;
+    int PSGpoPulseWidth;
+    int PSGpoProgramMasks;
+    int PSGpoProgramTimes;
+    int PSGpoProgramRepeats;
+    int PSGpoProgramPeriod;
+    int PSGpoProgramRun;
+    int PSGpoProgramStep;
+    int PSGpoTimingError;
+    int PSGpoTimingErrorMax;
+    int PSGpoTimingErrorMean;
+    int PSHostInterface;
+    int PSHostUdpDrops;
+    int PSHostUdpRcvbufErrors;
+    int PSHostNicRxMissed;
+    int PSHostNicRxDropped;
+    int PSHostRmemMax;
+    int PSSoakState;
+    int PSSoakMessage;
+    int PSEstSizeX;
+    #define FIRST_PS_EST_PARAM PSEstSizeX
+    int PSEstSizeY;
+    int PSEstBinX;
+    int PSEstBinY;
+    int PSEstPixelFormat;
+    int PSEstBayerConvert;
+    int PSEstAcquireTime;
+    int PSEstByteRate;
+    int PSEstCopyCurrent;
+    #define LAST_PS_EST_PARAM PSEstCopyCurrent
+    int PSEstFrameRate;
+    int PSEstBytesPerSecond;
+    int PSEstPacketsPerSecond;
+    int PSEstCpuLoad;
+    int PSEstReadoutTime;
+    int PSEstLimit;
+    int PSArm;
+    int PSArmed;
+    int PSFirstFrameLatency;
+    int PSGateMode;
+    int PSGateFrames;
+    #define FIRST_PS_GATE_PARAM PSGateFrames
+    int PSGateOpen;
+    int PSGatePoint;
+    #define LAST_PS_GATE_PARAM PSGatePoint
+    int PSGateDiscarded;
+    int PSThreadFrameCpu;
+    int PSThreadFrameVoluntary;
+    int PSThreadFrameInvoluntary;
+    int PSThreadFrameLastCpu;
+    int PSThreadPortCpu;
+    int PSThreadPortVoluntary;
+    int PSThreadPortInvoluntary;
+    int PSThreadPortLastCpu;
+    int PSThreadBusiestName;
+    int PSThreadBusiestCpu;
+    int PSPerfEnable;
+    int PSPerfStatus;
+    int PSPerfConvertIpc;
+    int PSPerfConvertCycles;
+    int PSPerfConvertLlc;
+    int PSPerfConvertDtlb;
+    int PSPerfAttributesIpc;
+    int PSPerfAttributesCycles;
+    int PSPerfAttributesLlc;
+    int PSPerfAttributesDtlb;
+    int PSPerfCallbacksIpc;
+    int PSPerfCallbacksCycles;
+    int PSPerfCallbacksLlc;
+    int PSPerfCallbacksDtlb;
+    int PSRegionEnable;
+    #define FIRST_PS_REGION_PARAM PSRegionEnable
+    int PSRegionMinX;
+    int PSRegionMinY;
+    int PSRegionSizeX;
+    int PSRegionSizeY;
+    #define LAST_PS_REGION_PARAM PSRegionSizeY
+    int PSRegionZeroCopy;
+    int PSRoiSeqEnable;
+    int PSRoiSeqStatus;
+    int PSRoiSeqUnmatched;
+    int PSNumaEnable;
+    int PSNumaStatus;
+    int PSNumaNode;
+    int PSNumaBufferNode;
+    int PSNumaRemoteFrames;
+    int PSNumaFrameThreadNode;
+    int PSNumaPortThreadNode;
+    int PSHistoryTimebase;
+    #define FIRST_PS_HISTORY_PARAM PSHistoryTimebase
+    int PSHistoryFrameRate;
+    int PSHistoryByteRate;
+    int PSHistoryMissedRate;
+    int PSHistoryResentRate;
+    int PSHistoryErroneousRate;
+    int PSHistoryDropRate;
+    int PSHistoryLatencyP99;
+    int PSHistoryTemperatureSensor;
+    int PSHistoryTemperatureMainboard;
+    #define LAST_PS_HISTORY_PARAM PSHistoryTemperatureMainboard
+    int PSArrivalOffset;
+    int PSArrivalModelDelay;
+    int PSArrivalLatency;
+    int PSAttrSort;
+    int PSAttrReset;
+    int PSAttrCalls;
+    int PSAttrErrors;
+    int PSAttrTime;
+    int PSAttrSlowest;
+    int PSAttrSlowMean;
+    int PSAttrSlowMax;
+    #define LAST_PS_PARAM PSAttrSlowMax
 private:                                        
     /* These are the methods that are new to this class */
+    asynStatus setImageMode(int imageMode);
     asynStatus setPixelFormat();
     asynStatus setGeometry();
     asynStatus getGeometry();
     asynStatus readStats();
+    asynStatus readPtpStatus();
+    void publishAttrStats();
+    void readHostStats();
+    void readThreadStats();
+    void reportThreads(FILE *fp);
+    int perfFrameStart(epicsUInt64 *pValues);
+    void perfStageEnd(int stage, epicsUInt64 *pValues);
+    void readPerfCounters();
+    void doRegionCallbacks(NDArray *pImage);
+    void publishRegion(int addr, NDArray *pArray);
+    void startRoiSequence();
+    void stopRoiSequence();
+    void applyNumaPlacement();
+    void sampleHistory(double elapsed);
+    int routeRoiSequence(tPvFrame *pFrame);
+    void computeEstimate();
     asynStatus readParameters();
     asynStatus disconnectCamera();
     asynStatus connectCamera();
     asynStatus syncTimer();
+    asynStatus setAcquire(int value);
+    asynStatus setArm(int value);
+    int keepsArmed(int function);
+    int gateAccept(tPvFrame *pFrame);
+    void setGateOpen(int value);
+    void getCameraTime(unsigned long timestampHi, unsigned long timestampLo, epicsTimeStamp *pTime);
+    asynStatus setSyncInMonitor();
+    asynStatus setGpoLevels(tPvUint32 mask, tPvUint32 levels);
+    void setGpoLevelParams(tPvUint32 levels);
+    asynStatus startGpoProgram(const epicsInt32 *masks, const double *times, int numSteps,
+                               int repeats, double period);
+    void syncInEdge(int input, int level, epicsTimeStamp *pTime);
+    asynStatus setStreamHold(int enable);
     
     /* These items are specific to the Prosilica driver */
     tPvHandle PvHandle;            /* GenericPointer for the Prosilica PvAPI library */
@@ -140,6 +514,8 @@ private:
     unsigned long uniqueId;
     tPvCameraInfoEx PvCameraInfo;
     tPvFrame *PvFrames;
+    tPvFrame **parkedFrames;       /* PvAPI frames which could not be queued, see requeueFrame */
+    int numParkedFrames;
     int maxFrameSize;
     int maxPvAPIFrames_;
     int framesRemaining;
@@ -150,6 +526,139 @@ private:
     tPvUint32 sensorHeight;
     tPvUint32 timeStampFrequency;
     struct epicsTimeStamp lastSyncTime;
+    prosilicaGroup *pGroup;        /* Acquisition group this camera belongs to, or NULL */
+    int groupMember;               /* Index of this camera within pGroup */
+    tPvUint32 savedByteRate;       /* StreamBytesPerSecond before the StreamHold coordinator took over */
+    tPvUint32 payloadSize;         /* TotalBytesPerFrame, the bytes of each frame on the wire */
+    epicsEventId syncInPollEvent;  /* Wakes up the sync input poller */
+    tPvUint32 syncInLevels;        /* Sync input levels last seen by the monitor */
+    /* The GPO program thread writes the levels without the port lock.  gpoHandle and gpoLevels
+     * are only changed with gpoMutex held, and the mutex is held across each write of
+     * SyncOutGpoLevels, so that no write is made after the camera is closed. */
+    epicsMutexId gpoMutex;
+    tPvHandle gpoHandle;           /* Camera the GPO levels are written to, NULL when disconnected */
+    tPvUint32 gpoLevels;           /* Last SyncOutGpoLevels read from or written to the camera */
+    epicsInt32 gpoProgramMasks[MAX_GPO_PROGRAM_STEPS]; /* GPO program written by the user */
+    double gpoProgramTimes[MAX_GPO_PROGRAM_STEPS];
+    int gpoProgramNumMasks;
+    int gpoProgramNumTimes;
+    epicsInt32 gpoRunMasks[MAX_GPO_PROGRAM_STEPS];     /* GPO program to be run by the program thread */
+    double gpoRunTimes[MAX_GPO_PROGRAM_STEPS];
+    int gpoRunSteps;
+    int gpoRunRepeats;
+    double gpoRunPeriod;
+    int gpoRunStart;               /* Set to start the program thread, cleared when it starts */
+    int gpoRunning;                /* A GPO program has been started and has not finished */
+    int gpoRunAbort;               /* Set to stop the program thread */
+    epicsEventId gpoProgramEvent;  /* Wakes up the GPO program thread */
+    psHostNetStats hostStats;      /* Host network counters at the last readStats */
+    int hostStatsValid;
+    psMetrics metrics;             /* Counters for the OpenMetrics writer, updated with epicsAtomic */
+    int frameThreadId;             /* Linux thread ID of the PvAPI thread which calls frameCallback */
+    int portThreadId;              /* Linux thread ID of the asyn port thread */
+    psHostThreadStats *threadStats; /* Statistics of all threads at the last readThreadStats */
+    psHostThreadStats *newThreadStats;
+    int numThreadStats;
+    epicsTimeStamp threadStatsTime;
+    psPerfCounters perfCounters;   /* Hardware counters of the frame callback thread */
+    int perfFailed;                /* The counters could not be opened, do not try again until re-enabled */
+    epicsUInt64 perfSums[NUM_PERF_STAGES][PSPerfNumEvents]; /* Counts of each stage since the last readPerfCounters */
+    double perfPixels;             /* Pixels of the frames counted in perfSums */
+    psViewPool *pViewPool;         /* Zero-copy region arrays */
+    double frameLatency[LATENCY_RING_SIZE]; /* Recent delays from the frame timestamp to the frame callback */
+    epicsUInt64 numFrameLatency;   /* Latencies added to the ring, which does not wrap in the life of an IOC */
+    double soakEndTime;            /* Soak test duration, cycle period and trend tolerance */
+    double soakCyclePeriod;
+    double soakTolerance;
+    int soakRunning;
+    int soakAbort;
+    double rowReadoutTime;         /* Readout time of one binned row, from the FrameRate range */
+    double processCost[NUM_EST_PIXEL_FORMATS][NUM_BAYER_CONVERT_MODES]; /* Measured frame callback seconds per pixel */
+    int armed;                     /* Configuration pushed and buffers checked, Acquire skips the readback */
+    int firstFramePending;         /* No frame has arrived since AcquisitionStart */
+    epicsTimeStamp acquireStartTime; /* Time AcquisitionStart was sent */
+    int gateRemaining;             /* Frames still to be delivered through the open gate */
+    epicsUInt64 gateOpenTicks;     /* Camera clock latched when the gate was opened */
+    /* The windows are moved by roiSeqTask outside the port lock.  roiSeqCount is only changed
+     * with both the port lock and roiSeqMutex held, and roiSeqNext, roiSeqHandle and roiSeqError
+     * with roiSeqMutex held, so that the task never writes to a camera after the sequence has
+     * stopped. */
+    epicsMutexId roiSeqMutex;
+    epicsEventId roiSeqEvent;      /* Wakes up roiSeqTask when a frame arrives */
+    tPvHandle roiSeqHandle;        /* Camera the sequence runs on */
+    int roiSeqError;               /* PvAPI error of the last window move, published by roiSeqTask */
+    int roiSeqCount;               /* Windows in the running ROI sequence, 0 if it is not running */
+    int roiSeqNext;                /* Window to program when the next frame arrives */
+    int roiSeqX[NUM_REGIONS];      /* Binned RegionX of each window */
+    int roiSeqY[NUM_REGIONS];      /* Binned RegionY of each window */
+    int roiSeqAddr[NUM_REGIONS];   /* Address the frames of each window are published on */
+    int roiSeqActive;              /* The camera window has been moved and must be restored */
+    int roiSeqHomeX, roiSeqHomeY;  /* ADMinX and ADMinY when the sequence started */
+    int roiSeqRestore;             /* The camera was lost with the window moved, restore it on connect */
+    psNumaPool *pNumaPool;         /* The NDArrayPool of the driver */
+    NDArrayPool *pBasePool;        /* The pool created by asynNDArrayDriver, which also deletes it */
+    int numaNode;                  /* Node of the host interface, -1 if not known */
+    int numaBound;                 /* The driver threads have been bound to a node */
+    psHistory history;             /* Stream health at HISTORY_PERIOD, one series per PSHistory_t */
+    tPvUint32 historyCounters[4];  /* Frames completed, frames dropped, packets missed and resent at the last sample */
+    tPvUint32 historyErroneous;    /* Packets erroneous at the last sample */
+    int historyValid;              /* historyCounters are from the current connection */
+    epicsUInt64 historyBytes;      /* Payload bytes of the frames received from the camera */
+    epicsUInt64 historyLastBytes;  /* historyBytes at the last sample */
+    epicsUInt64 historyLatencyFrames; /* numFrameLatency at the last sample */
+    tPvFrame synthFrames[NUM_SYNTH_FRAMES]; /* Frames injected into the frame callback without the camera */
+    tPvFrame *synthFree[NUM_SYNTH_FRAMES];  /* Synthetic frames which are not being processed */
+    int numSynthFree;
+    tPvUint32 synthFrameCount;     /* FrameCount of the last synthetic frame */
+    int stressRunning;
+    int stressStop;                /* Stops the threads of the stress test, updated with epicsAtomic */
+    double stressSeconds;          /* Stress test duration, writer threads and link event period */
+    int stressWriters;
+    double stressLinkPeriod;
+    int stressWidth, stressHeight; /* Size of the injected frames */
+    int stressNextWriter;          /* Index of the next writer thread, updated with epicsAtomic */
+    int stressThreads;             /* Stress test threads which are still running, updated with epicsAtomic */
+    epicsEventId stressDoneEvent;  /* Signalled by the last stress test thread to finish */
+    size_t stressFrames;           /* Frames injected, writes and link events, updated with epicsAtomic */
+    size_t stressWrites;
+    size_t stressLinkEvents;
+    size_t stressNoFrame;          /* Times an injector found no synthetic frame free */
+    double stressWaitSum;          /* Time the writes waited in the queue of the port thread */
+    double stressWaitMax;
+    int headroomRunning;
+    int headroomAbort;             /* Stops the headroom benchmark, updated with epicsAtomic */
+    int headroomWidth;             /* Size and tPvImageFormat of the injected frames */
+    int headroomHeight;
+    int headroomFormat;
+    char *headroomPluginNames;     /* Port names of the plugins to watch */
+    psAttrStats attrStats;         /* Latency and errors of the PvAPI attribute calls */
+    double attrSlowMean[NUM_ATTR_SLOWEST]; /* Mean and maximum ms of the slowest attributes */
+    double attrSlowMax[NUM_ATTR_SLOWEST];
+    int numAttrSlow;
+
+    double latencyPercentile(double fraction, int maxFrames = LATENCY_RING_SIZE);
+    void soakCycle(int cycle);
+    tPvErr queueFrame(tPvFrame *pFrame);
+    void requeueFrame(tPvFrame *pFrame);
+    void requeueParkedFrames();
+    tPvFrame *getSynthFrame(int width, int height, int format);
+    void freeSynthFrames();
+    int injectFrame(int width, int height, int format);
+    int heldArrays(int *pViews);
+    void stressThreadDone();
+    int headroomStep(double rate, struct headroomPlugin *pPlugins, int numPlugins,
+                     double *pAchieved, char *reason, size_t size);
+    void headroomDrain(struct headroomPlugin *pPlugins, int numPlugins);
+    void countAttr(PSAttrOp_t op, const char *name, epicsUInt64 start, tPvErr err);
+    tPvErr attrUint32Get(const char *name, tPvUint32 *pValue);
+    tPvErr attrUint32Set(const char *name, tPvUint32 value);
+    tPvErr attrFloat32Get(const char *name, tPvFloat32 *pValue);
+    tPvErr attrFloat32Set(const char *name, tPvFloat32 value);
+    tPvErr attrRangeFloat32(const char *name, tPvFloat32 *pMin, tPvFloat32 *pMax);
+    tPvErr attrEnumGet(const char *name, char *buffer, unsigned long size, unsigned long *pSize);
+    tPvErr attrEnumSet(const char *name, const char *value);
+    tPvErr attrStringGet(const char *name, char *buffer, unsigned long size, unsigned long *pSize);
+    tPvErr commandRun(const char *name);
 };
 
 typedef struct {
@@ -157,6 +666,40 @@ typedef struct {
     prosilica *pCamera;
 } cameraNode;
 
+/** One trigger of an acquisition group, i.e. the set of frames the member cameras
+  * are expected to deliver for it */
+typedef struct {
+    epicsUInt32 sequence;          /* Group sequence number of this set */
+    double time;                   /* Frame time of the first frame in the set, EPICS seconds */
+    epicsUInt32 memberMask;        /* One bit for each member which has delivered its frame */
+} groupSet;
+
+/** Cameras which are armed together and whose frames are matched by frame time */
+typedef struct prosilicaGroup {
+    ELLNODE node;
+    char *name;
+    prosilica *pMembers[MAX_GROUP_CAMERAS];
+    int numMembers;
+    double tolerance;              /* Frames closer than this (seconds) belong to the same set */
+    epicsMutexId mutex;            /* Protects everything below */
+    groupSet sets[MAX_GROUP_SETS]; /* Sets which are still waiting for frames */
+    int numSets;
+    double lastTime[MAX_GROUP_CAMERAS]; /* Frame time of the last frame from each member */
+    epicsInt32 lastSequence[MAX_GROUP_CAMERAS]; /* Sequence number of the last frame from each member */
+    epicsUInt32 nextSequence;
+    int setsComplete;
+    int setsIncomplete;
+    int holdEnable;                /* StreamHold coordinator is enabled */
+    int holdLinkRate;              /* Bytes/second available on the shared link */
+    epicsEventId holdEvent;        /* Wakes up the StreamHold coordinator */
+} prosilicaGroup;
+
+static ELLLIST *groupList;
+
+static epicsInt32 groupMatchFrame(prosilicaGroup *pGroup, int member, double frameTime,
+                                  int *setsComplete, int *setsIncomplete);
+static int groupHeldFrames(prosilicaGroup *pGroup, int member);
+
 #define NUM_PS_PARAMS ((int)(&LAST_PS_PARAM - &FIRST_PS_PARAM + 1))
 typedef enum {
     /* These parameters describe the trigger modes of the Prosilica
@@ -183,18 +726,101 @@ typedef enum {
     // The number of seconds since the POSIX Epoch (00:00:00 UTC, January 1, 1970)
     PSTimestampTypeEPICS,         
     // The number of seconds since the EPICS Epoch (January 1, 1990)
-    PSTimestampTypeIOC
+    PSTimestampTypeIOC,
     // Use the IOC clock to sync timeStamp and driver timestamps
+    PSTimestampTypePTP,
+    // The number of seconds since the EPICS Epoch, taken directly from the IEEE 1588 camera clock
+    PSTimestampTypeExposure
+    // The middle of the exposure, estimated from the IOC clock when the frame arrived
 } PSTimestampType_t;
 
 
+/* These describe how the sync inputs are monitored */
+typedef enum {
+    PSSyncInMonitorOff,
+    PSSyncInMonitorEvents,
+    // Edges are reported by camera events and timestamped with the camera clock
+    PSSyncInMonitorPoll
+    // The levels are polled and edges are timestamped with the IOC clock
+} PSSyncInMonitor_t;
+
+
+/* These are the pixel formats of the frame rate estimator, in the order of tPvImageFormat */
+static const char *PSEstPixelFormats[NUM_EST_PIXEL_FORMATS] = {
+    "Mono8", "Mono16", "Bayer8", "Bayer16", "Rgb24", "Rgb48"
+};
+static const int PSEstBytesPerPixel[NUM_EST_PIXEL_FORMATS] = {1, 2, 1, 2, 3, 6};
+
+/* These are the limits of the estimated frame rate */
+typedef enum {
+    PSEstLimitExposure,
+    PSEstLimitReadout,
+    PSEstLimitBandwidth
+} PSEstLimit_t;
+
+/* These are the frame callback stages measured with the hardware counters */
+typedef enum {
+    PSPerfStageConvert,            /* Pixel format and Bayer conversion */
+    PSPerfStageAttributes,         /* Timestamp, attributes and getAttributes */
+    PSPerfStageCallbacks           /* doCallbacksGenericPointer, including blocking plugins */
+} PSPerfStage_t;
+
+/* These are the states of the soak test */
+typedef enum {
+    PSSoakIdle,
+    PSSoakRunning,
+    PSSoakPassed,
+    PSSoakFailed
+} PSSoakState_t;
+
+/* These are the series of the stream health history, in the order of their parameters */
+typedef enum {
+    PSHistoryFrameRateSeries,
+    PSHistoryByteRateSeries,
+    PSHistoryMissedRateSeries,
+    PSHistoryResentRateSeries,
+    PSHistoryErroneousRateSeries,
+    PSHistoryDropRateSeries,
+    PSHistoryLatencyP99Series,
+    PSHistoryTemperatureSensorSeries,
+    PSHistoryTemperatureMainboardSeries
+} PSHistory_t;
+
+
 typedef enum {
     PSBayerConvertNone,
     PSBayerConvertRGB1,
     PSBayerConvertRGB2,
     PSBayerConvertRGB3,
+    PSBayerConvertMono,
 } PSBayerConvert_t;
 
+/* These are the layouts of the native RGB formats.  The RGB2 and RGB3 frames are split by the driver. */
+typedef enum {
+    PSRgbLayoutRGB1,
+    PSRgbLayoutRGB2,
+    PSRgbLayoutRGB3
+} PSRgbLayout_t;
+
+/* These are the software binning modes and output data types */
+typedef enum {
+    PSSoftBinSum,
+    PSSoftBinAverage
+} PSSoftBinMode_t;
+
+typedef enum {
+    PSSoftBinUInt16,
+    PSSoftBinUInt32
+} PSSoftBinType_t;
+
+/** Returns the PSBayerConvert_t under which the processing cost of an RGB layout is measured */
+static int rgbLayoutConversion(int rgbLayout)
+{
+    if (rgbLayout == PSRgbLayoutRGB2) return PSBayerConvertRGB2;
+    if (rgbLayout == PSRgbLayoutRGB3) return PSBayerConvertRGB3;
+    return PSBayerConvertNone;
+}
+
 static const char *PSTriggerStartModes[] = {
     "Freerun",
     "SyncIn1",
@@ -270,10 +896,39 @@ static const char *PSGainModes[] = {
 };
 #define NUM_GAIN_MODES (int)(sizeof(PSGainModes) / sizeof(PSGainModes[0]))
 
+static const char *PSPtpModes[] = {
+    "Off",
+    "Slave",
+    "Master",
+    "Auto",
+};
+#define NUM_PTP_MODES (int)(sizeof(PSPtpModes) / sizeof(PSPtpModes[0]))
+
+/* The last entry is used for any state the driver does not know about */
+static const char *PSPtpStatuses[] = {
+    "Off",
+    "Initializing",
+    "Faulty",
+    "Disabled",
+    "Listening",
+    "PreMaster",
+    "Master",
+    "Passive",
+    "Uncalibrated",
+    "Slave",
+    "Unknown",
+};
+#define NUM_PTP_STATUSES (int)(sizeof(PSPtpStatuses) / sizeof(PSPtpStatuses[0]))
+
 /** Driver-specific parameters for the Prosilica driver */
     /*                                       String              asyn interface  access   Description  */
 #define PSReadStatisticsString       "PS_READ_STATISTICS"      /* (asynInt32,    r/w) Write to read statistics  */ 
 #define PSBayerConvertString         "PS_BAYER_CONVERT"        /* (asynInt32,    r/w) Convert Bayer to another format */ 
+#define PSRgbLayoutString            "PS_RGB_LAYOUT"           /* (asynInt32,    r/w) Color mode of the Rgb24 and Rgb48 frames */
+#define PSSoftBinXString             "PS_SOFT_BIN_X"           /* (asynInt32,    r/w) Software binning in X */
+#define PSSoftBinYString             "PS_SOFT_BIN_Y"           /* (asynInt32,    r/w) Software binning in Y */
+#define PSSoftBinModeString          "PS_SOFT_BIN_MODE"        /* (asynInt32,    r/w) Sum or average the binned pixels */
+#define PSSoftBinTypeString          "PS_SOFT_BIN_TYPE"        /* (asynInt32,    r/w) Data type of the binned image, UInt16 or UInt32 */
 #define PSGainModeString             "PS_GAIN_MODE"            /* (asynInt32,    r/w) Camera gain mode, manual or auto */
 #define PSExposureModeString         "PS_EXPOSURE_MODE"        /* (asynInt32,    r/w) Camera exposure mode, manual or auto */
 #define PSDriverTypeString           "PS_DRIVER_TYPE"          /* (asynOctet,    r/o) Ethernet driver type */ 
@@ -311,6 +966,177 @@ static const char *PSGainModes[] = {
 #define PSStrobe1CtlDurationString   "PS_STROBE_1_CTL_DURATION"/* (asynInt32,    r/w) Strobe 1 controlled duration */
 #define PSStrobe1DurationString      "PS_STROBE_1_DURATION"    /* (asynFloat64,  r/w) Strobe 1 duration */
 #define PSTemperatureMainboardString "PS_TEMPERATURE_MAINBOARD"/* (asynFloat64,  r/o) Device temperature mainboard*/
+#define PSGroupNameString            "PS_GROUP_NAME"           /* (asynOctet,    r/o) Acquisition group name */
+#define PSGroupAcquireString         "PS_GROUP_ACQUIRE"        /* (asynInt32,    r/w) Start/stop all cameras in the group */
+#define PSGroupSequenceString        "PS_GROUP_SEQUENCE"       /* (asynInt32,    r/o) Group sequence number of last frame */
+#define PSGroupSetsCompleteString    "PS_GROUP_SETS_COMPLETE"  /* (asynInt32,    r/o) Number of complete frame sets */
+#define PSGroupSetsIncompleteString  "PS_GROUP_SETS_INCOMPLETE"/* (asynInt32,    r/o) Number of incomplete frame sets */
+#define PSStreamHoldString           "PS_STREAM_HOLD"          /* (asynInt32,    r/w) Enable group StreamHold coordinator */
+#define PSStreamHoldLinkRateString   "PS_STREAM_HOLD_LINK_RATE"/* (asynInt32,    r/w) Bytes/second of the shared link */
+#define PSStreamHoldCapacityString   "PS_STREAM_HOLD_CAPACITY" /* (asynInt32,    r/o) Frames the camera can hold */
+#define PSStreamHoldFramesString     "PS_STREAM_HOLD_FRAMES"   /* (asynInt32,    r/o) Estimated frames held in the camera */
+#define PSPtpModeString              "PS_PTP_MODE"             /* (asynInt32,    r/w) IEEE 1588 mode of the camera */
+#define PSPtpStatusString            "PS_PTP_STATUS"           /* (asynInt32,    r/o) IEEE 1588 port state of the camera */
+#define PSPtpLockedString            "PS_PTP_LOCKED"           /* (asynInt32,    r/o) Camera clock is locked to PTP */
+#define PSPtpOffsetString            "PS_PTP_OFFSET"           /* (asynFloat64,  r/o) Camera PTP clock minus IOC clock */
+#define PSSyncInMonitorString        "PS_SYNC_IN_MONITOR"      /* (asynInt32,    r/w) Sync input monitor Off/Events/Poll */
+#define PSSyncInPollPeriodString     "PS_SYNC_IN_POLL_PERIOD"  /* (asynFloat64,  r/w) Sync input poll period */
+#define PSSyncInResetCountsString    "PS_SYNC_IN_RESET_COUNTS" /* (asynInt32,    r/w) Reset the sync input pulse counts */
+#define PSSyncIn1CountString         "PS_SYNC_IN_1_COUNT"      /* (asynInt32,    r/o) Sync input 1 pulse count */
+#define PSSyncIn2CountString         "PS_SYNC_IN_2_COUNT"      /* (asynInt32,    r/o) Sync input 2 pulse count */
+#define PSSyncIn1EdgeTimeString      "PS_SYNC_IN_1_EDGE_TIME"  /* (asynFloat64,  r/o) Time of last sync input 1 edge */
+#define PSSyncIn2EdgeTimeString      "PS_SYNC_IN_2_EDGE_TIME"  /* (asynFloat64,  r/o) Time of last sync input 2 edge */
+#define PSSyncOutGpoLevelsString     "PS_SYNC_OUT_GPO_LEVELS"  /* (asynInt32,    r/w) All sync output levels as a mask */
+#define PSGpoPulseString             "PS_GPO_PULSE"            /* (asynInt32,    r/w) Pulse the sync outputs in this mask */
+#define PSGpoPulseWidthString        "PS_GPO_PULSE_WIDTH"      /* (asynFloat64,  r/w) GPO pulse width */
+#define PSGpoProgramMasksString      "PS_GPO_PROGRAM_MASKS"    /* (asynInt32Array,   r/w) GPO program level masks */
+#define PSGpoProgramTimesString      "PS_GPO_PROGRAM_TIMES"    /* (asynFloat64Array, r/w) GPO program step times */
+#define PSGpoProgramRepeatsString    "PS_GPO_PROGRAM_REPEATS"  /* (asynInt32,    r/w) GPO program repeats, 0=until stopped */
+#define PSGpoProgramPeriodString     "PS_GPO_PROGRAM_PERIOD"   /* (asynFloat64,  r/w) GPO program repeat period */
+#define PSGpoProgramRunString        "PS_GPO_PROGRAM_RUN"      /* (asynInt32,    r/w) Run or stop the GPO program */
+#define PSGpoProgramStepString       "PS_GPO_PROGRAM_STEP"     /* (asynInt32,    r/o) Current GPO program step */
+#define PSGpoTimingErrorString       "PS_GPO_TIMING_ERROR"     /* (asynFloat64,  r/o) Timing error of last GPO step */
+#define PSGpoTimingErrorMaxString    "PS_GPO_TIMING_ERROR_MAX" /* (asynFloat64,  r/o) Maximum GPO timing error in run */
+#define PSGpoTimingErrorMeanString   "PS_GPO_TIMING_ERROR_MEAN"/* (asynFloat64,  r/o) Mean GPO timing error in run */
+#define PSHostInterfaceString        "PS_HOST_INTERFACE"       /* (asynOctet,    r/o) Host interface routing to the camera */
+#define PSHostUdpDropsString         "PS_HOST_UDP_DROPS"       /* (asynInt32,    r/o) New drops on the UDP sockets of the IOC */
+#define PSHostUdpRcvbufErrorsString  "PS_HOST_UDP_RCVBUF_ERRORS" /* (asynInt32,  r/o) New UDP RcvbufErrors of the host */
+#define PSHostNicRxMissedString      "PS_HOST_NIC_RX_MISSED"   /* (asynInt32,    r/o) New rx_missed_errors of the interface */
+#define PSHostNicRxDroppedString     "PS_HOST_NIC_RX_DROPPED"  /* (asynInt32,    r/o) New rx_dropped of the interface */
+#define PSHostRmemMaxString          "PS_HOST_RMEM_MAX"        /* (asynInt32,    r/o) net.core.rmem_max sysctl */
+#define PSSoakStateString            "PS_SOAK_STATE"           /* (asynInt32,    r/o) Soak test Idle/Running/Passed/Failed */
+#define PSSoakMessageString          "PS_SOAK_MESSAGE"         /* (asynOctet,    r/o) Soak test progress or failure */
+#define PSEstSizeXString             "PS_EST_SIZE_X"           /* (asynInt32,    r/w) Candidate X size for the estimator */
+#define PSEstSizeYString             "PS_EST_SIZE_Y"           /* (asynInt32,    r/w) Candidate Y size */
+#define PSEstBinXString              "PS_EST_BIN_X"            /* (asynInt32,    r/w) Candidate X binning */
+#define PSEstBinYString              "PS_EST_BIN_Y"            /* (asynInt32,    r/w) Candidate Y binning */
+#define PSEstPixelFormatString       "PS_EST_PIXEL_FORMAT"     /* (asynInt32,    r/w) Candidate pixel format */
+#define PSEstBayerConvertString      "PS_EST_BAYER_CONVERT"    /* (asynInt32,    r/w) Candidate Bayer conversion */
+#define PSEstAcquireTimeString       "PS_EST_ACQUIRE_TIME"     /* (asynFloat64,  r/w) Candidate exposure time */
+#define PSEstByteRateString          "PS_EST_BYTE_RATE"        /* (asynInt32,    r/w) Candidate StreamBytesPerSecond */
+#define PSEstCopyCurrentString       "PS_EST_COPY_CURRENT"     /* (asynInt32,    r/w) Copy the current settings to the candidate */
+#define PSEstFrameRateString         "PS_EST_FRAME_RATE"       /* (asynFloat64,  r/o) Estimated frame rate */
+#define PSEstBytesPerSecondString    "PS_EST_BYTES_PER_SECOND" /* (asynFloat64,  r/o) Estimated payload bytes/s */
+#define PSEstPacketsPerSecondString  "PS_EST_PACKETS_PER_SECOND" /* (asynFloat64, r/o) Estimated packets/s */
+#define PSEstCpuLoadString           "PS_EST_CPU_LOAD"         /* (asynFloat64,  r/o) Estimated frame callback CPU, fraction of a core */
+#define PSEstReadoutTimeString       "PS_EST_READOUT_TIME"     /* (asynFloat64,  r/o) Estimated readout time */
+#define PSEstLimitString             "PS_EST_LIMIT"            /* (asynInt32,    r/o) What limits the estimated frame rate */
+#define PSArmString                  "PS_ARM"                  /* (asynInt32,    r/w) Arm (1) or disarm (0) for a fast Acquire */
+#define PSArmedString                "PS_ARMED"                /* (asynInt32,    r/o) The camera is armed */
+#define PSFirstFrameLatencyString    "PS_FIRST_FRAME_LATENCY"  /* (asynFloat64,  r/o) Acquire to first frame time of the last acquisition */
+#define PSGateModeString             "PS_GATE_MODE"            /* (asynInt32,    r/w) Deliver only the frames inside the gate */
+#define PSGateFramesString           "PS_GATE_FRAMES"          /* (asynInt32,    r/w) Frames delivered each time the gate opens */
+#define PSGateOpenString             "PS_GATE_OPEN"            /* (asynInt32,    r/w) Open the gate, closes after PSGateFrames */
+#define PSGatePointString            "PS_GATE_POINT"           /* (asynInt32,    r/w) Scan point index of the gated frames */
+#define PSGateDiscardedString        "PS_GATE_DISCARDED"       /* (asynInt32,    r/o) Frames discarded outside the gate */
+#define PSThreadFrameCpuString       "PS_THREAD_FRAME_CPU"     /* (asynFloat64,  r/o) CPU % of the PvAPI frame callback thread */
+#define PSThreadFrameVoluntaryString "PS_THREAD_FRAME_VOLUNTARY" /* (asynInt32,  r/o) New voluntary context switches */
+#define PSThreadFrameInvoluntaryString "PS_THREAD_FRAME_INVOLUNTARY" /* (asynInt32, r/o) New involuntary context switches */
+#define PSThreadFrameLastCpuString   "PS_THREAD_FRAME_LAST_CPU" /* (asynInt32,   r/o) CPU the thread last ran on */
+#define PSThreadPortCpuString        "PS_THREAD_PORT_CPU"      /* (asynFloat64,  r/o) CPU % of the asyn port thread */
+#define PSThreadPortVoluntaryString  "PS_THREAD_PORT_VOLUNTARY" /* (asynInt32,   r/o) New voluntary context switches */
+#define PSThreadPortInvoluntaryString "PS_THREAD_PORT_INVOLUNTARY" /* (asynInt32, r/o) New involuntary context switches */
+#define PSThreadPortLastCpuString    "PS_THREAD_PORT_LAST_CPU" /* (asynInt32,    r/o) CPU the thread last ran on */
+#define PSThreadBusiestNameString    "PS_THREAD_BUSIEST_NAME"  /* (asynOctet,    r/o) Busiest other thread of the IOC */
+#define PSThreadBusiestCpuString     "PS_THREAD_BUSIEST_CPU"   /* (asynFloat64,  r/o) CPU % of the busiest other thread */
+#define PSPerfEnableString           "PS_PERF_ENABLE"          /* (asynInt32,    r/w) Count the frame callback stages with perf_event_open */
+#define PSPerfStatusString           "PS_PERF_STATUS"          /* (asynOctet,    r/o) State of the hardware counters */
+#define PSPerfConvertIpcString       "PS_PERF_CONVERT_IPC"     /* (asynFloat64,  r/o) Instructions per cycle of the conversion stage */
+#define PSPerfConvertCyclesString    "PS_PERF_CONVERT_CYCLES"  /* (asynFloat64,  r/o) Cycles per pixel */
+#define PSPerfConvertLlcString       "PS_PERF_CONVERT_LLC"     /* (asynFloat64,  r/o) Last level cache misses per pixel */
+#define PSPerfConvertDtlbString      "PS_PERF_CONVERT_DTLB"    /* (asynFloat64,  r/o) dTLB misses per pixel */
+#define PSPerfAttributesIpcString    "PS_PERF_ATTRIBUTES_IPC"  /* (asynFloat64,  r/o) Instructions per cycle of the attributes stage */
+#define PSPerfAttributesCyclesString "PS_PERF_ATTRIBUTES_CYCLES" /* (asynFloat64, r/o) Cycles per pixel */
+#define PSPerfAttributesLlcString    "PS_PERF_ATTRIBUTES_LLC"  /* (asynFloat64,  r/o) Last level cache misses per pixel */
+#define PSPerfAttributesDtlbString   "PS_PERF_ATTRIBUTES_DTLB" /* (asynFloat64,  r/o) dTLB misses per pixel */
+#define PSPerfCallbacksIpcString     "PS_PERF_CALLBACKS_IPC"   /* (asynFloat64,  r/o) Instructions per cycle of the callbacks stage */
+#define PSPerfCallbacksCyclesString  "PS_PERF_CALLBACKS_CYCLES" /* (asynFloat64, r/o) Cycles per pixel */
+#define PSPerfCallbacksLlcString     "PS_PERF_CALLBACKS_LLC"   /* (asynFloat64,  r/o) Last level cache misses per pixel */
+#define PSPerfCallbacksDtlbString    "PS_PERF_CALLBACKS_DTLB"  /* (asynFloat64,  r/o) dTLB misses per pixel */
+#define PSRegionEnableString         "PS_REGION_ENABLE"        /* (asynInt32,    r/w) Publish this region, at addresses 1 to NUM_REGIONS */
+#define PSRegionMinXString           "PS_REGION_MIN_X"         /* (asynInt32,    r/w) First column of the region in the image */
+#define PSRegionMinYString           "PS_REGION_MIN_Y"         /* (asynInt32,    r/w) First row of the region in the image */
+#define PSRegionSizeXString          "PS_REGION_SIZE_X"        /* (asynInt32,    r/w) Columns of the region */
+#define PSRegionSizeYString          "PS_REGION_SIZE_Y"        /* (asynInt32,    r/w) Rows of the region */
+#define PSRegionZeroCopyString       "PS_REGION_ZERO_COPY"     /* (asynInt32,    r/o) The last region array used the frame memory */
+#define PSRoiSeqEnableString         "PS_ROI_SEQ_ENABLE"       /* (asynInt32,    r/w) Cycle the camera window through the enabled regions */
+#define PSRoiSeqStatusString         "PS_ROI_SEQ_STATUS"       /* (asynOctet,    r/o) State of the ROI sequence */
+#define PSRoiSeqUnmatchedString      "PS_ROI_SEQ_UNMATCHED"    /* (asynInt32,    r/o) Sequence frames which matched no region */
+#define PSNumaEnableString           "PS_NUMA_ENABLE"          /* (asynInt32,    r/w) Keep buffers and driver threads on the node of the interface */
+#define PSNumaStatusString           "PS_NUMA_STATUS"          /* (asynOctet,    r/o) NUMA placement state */
+#define PSNumaNodeString             "PS_NUMA_NODE"            /* (asynInt32,    r/o) Node of the host interface, -1 if not known */
+#define PSNumaBufferNodeString       "PS_NUMA_BUFFER_NODE"     /* (asynInt32,    r/o) Node of the last frame buffer */
+#define PSNumaRemoteFramesString     "PS_NUMA_REMOTE_FRAMES"   /* (asynInt32,    r/o) Frames received in a buffer on another node */
+#define PSNumaFrameThreadNodeString  "PS_NUMA_FRAME_THREAD_NODE" /* (asynInt32,  r/o) Node the frame callback thread last ran on */
+#define PSNumaPortThreadNodeString   "PS_NUMA_PORT_THREAD_NODE" /* (asynInt32,   r/o) Node the asyn port thread last ran on */
+#define PSHistoryTimebaseString      "PS_HISTORY_TIMEBASE"     /* (asynFloat64Array, r/o) Age of the history samples in seconds, 0 is the newest */
+#define PSHistoryFrameRateString     "PS_HISTORY_FRAME_RATE"   /* (asynFloat64Array, r/o) StatFrameRate history */
+#define PSHistoryByteRateString      "PS_HISTORY_BYTE_RATE"    /* (asynFloat64Array, r/o) Received bytes per second history */
+#define PSHistoryMissedRateString    "PS_HISTORY_MISSED_RATE"  /* (asynFloat64Array, r/o) Missed packets per second history */
+#define PSHistoryResentRateString    "PS_HISTORY_RESENT_RATE"  /* (asynFloat64Array, r/o) Resent packets per second history */
+#define PSHistoryErroneousRateString "PS_HISTORY_ERRONEOUS_RATE" /* (asynFloat64Array, r/o) Erroneous packets per second history */
+#define PSHistoryDropRateString      "PS_HISTORY_DROP_RATE"    /* (asynFloat64Array, r/o) Dropped frames per second history */
+#define PSHistoryLatencyP99String    "PS_HISTORY_LATENCY_P99"  /* (asynFloat64Array, r/o) 99th percentile frame latency history */
+#define PSHistoryTemperatureSensorString    "PS_HISTORY_TEMPERATURE_SENSOR"    /* (asynFloat64Array, r/o) Sensor temperature history */
+#define PSHistoryTemperatureMainboardString "PS_HISTORY_TEMPERATURE_MAINBOARD" /* (asynFloat64Array, r/o) Mainboard temperature history */
+#define PSArrivalOffsetString        "PS_ARRIVAL_OFFSET"       /* (asynFloat64,  r/w) Fixed delay from the last packet to the frame callback */
+#define PSArrivalModelDelayString    "PS_ARRIVAL_MODEL_DELAY"  /* (asynFloat64,  r/o) Modelled delay from the end of the exposure to the arrival */
+#define PSArrivalLatencyString       "PS_ARRIVAL_LATENCY"      /* (asynFloat64,  r/o) Delay from the arrival to the timestamping of the frame */
+#define PSAttrSortString             "PS_ATTR_SORT"            /* (asynInt32,    r/w) Order of the slowest attributes: Mean, Max or Total */
+#define PSAttrResetString            "PS_ATTR_RESET"           /* (asynInt32,    r/w) Clears the attribute latency counts */
+#define PSAttrCallsString            "PS_ATTR_CALLS"           /* (asynInt32,    r/o) Attribute calls since the last reset */
+#define PSAttrErrorsString           "PS_ATTR_ERRORS"          /* (asynInt32,    r/o) Attribute calls which failed */
+#define PSAttrTimeString             "PS_ATTR_TIME"            /* (asynFloat64,  r/o) Seconds spent in attribute calls */
+#define PSAttrSlowestString          "PS_ATTR_SLOWEST"         /* (asynOctet,    r/o) Table of the slowest attributes */
+#define PSAttrSlowMeanString         "PS_ATTR_SLOW_MEAN"       /* (asynFloat64Array, r/o) Mean ms of the slowest attributes */
+#define PSAttrSlowMaxString          "PS_ATTR_SLOW_MAX"        /* (asynFloat64Array, r/o) Maximum ms of the slowest attributes */
+
+
+/** Returns true if a camera Id is a unique ID (all characters are digits) rather than an IP address or name */
+static bool isUniqueIdString(const char *cameraId)
+{
+    for (int i=0; i<(int)strlen(cameraId); i++) {
+        if (!isdigit(cameraId[i])) return false;
+    }
+    return true;
+}
+
+
+/** Refreshes the camera cache in the background.  With discovery the addresses of the cameras which
+  * the PvAPI library has found are saved.  Without discovery each cached address is asked which
+  * camera it belongs to now. */
+static void discoveryRefreshTask(void *arg)
+{
+    tPvCameraInfoEx cameraInfo[MAX_DISCOVERY_CAMERAS];
+    tPvIpSettings ipSettings;
+    struct in_addr ipAddr;
+    unsigned char *pBytes;
+    char ipAddress[PS_CACHE_ADDRESS_SIZE];
+    unsigned long uniqueId, numReturned, numTotal;
+    int i;
+
+    while (1) {
+        if (PvApiNoDiscovery) {
+            for (i=0; psCacheGetEntry(i, &uniqueId, ipAddress, sizeof(ipAddress)) == 0; i++) {
+                if (hostToIPAddr(ipAddress, &ipAddr)) continue;
+                if (PvCameraInfoByAddrEx(ipAddr.s_addr, &cameraInfo[0], NULL, sizeof(tPvCameraInfoEx))) continue;
+                if (cameraInfo[0].UniqueId != uniqueId) psCacheUpdate(cameraInfo[0].UniqueId, ipAddress);
+            }
+        } else {
+            numReturned = PvCameraListEx(cameraInfo, MAX_DISCOVERY_CAMERAS, &numTotal, sizeof(tPvCameraInfoEx));
+            for (i=0; i<(int)numReturned; i++) {
+                if (PvCameraIpSettingsGet(cameraInfo[i].UniqueId, &ipSettings)) continue;
+                /* CurrentIpAddress is in network byte order */
+                pBytes = (unsigned char *)&ipSettings.CurrentIpAddress;
+                epicsSnprintf(ipAddress, sizeof(ipAddress), "%u.%u.%u.%u",
+                              pBytes[0], pBytes[1], pBytes[2], pBytes[3]);
+                psCacheUpdate(cameraInfo[i].UniqueId, ipAddress);
+            }
+        }
+        psCacheSave();
+        epicsThreadSleep(discoveryRefreshPeriod);
+    }
+}
 
 
 void prosilica::shutdown (void* arg) {
@@ -329,8 +1155,26 @@ prosilica::~prosilica() {
     this->lock();
     printf("Disconnecting camera %s\n", this->portName);
     disconnectCamera();
+    free(this->threadStats);
+    free(this->newThreadStats);
+    this->threadStats = NULL;
+    this->newThreadStats = NULL;
+    this->numThreadStats = 0;
+    /* Give back the last array of each address and the synthetic frame buffers, so that the
+     * pools below can be empty.  The views are released first, they release their frames. */
+    for (int addr=NUM_REGIONS; addr>=0; addr--) {
+        if (this->pArrays[addr]) this->pArrays[addr]->release();
+        this->pArrays[addr] = NULL;
+    }
+    freeSynthFrames();
     this->unlock();
 
+    /* A plugin which still holds an array releases it to its pool later, so a pool with arrays
+     * in use is left alone */
+    this->pNDArrayPool = this->pBasePool;
+    if (this->pViewPool->getNumFree() == this->pViewPool->getNumBuffers()) delete this->pViewPool;
+    if (this->pNumaPool->getNumFree() == this->pNumaPool->getNumBuffers()) delete this->pNumaPool;
+
     // Find this camera in the list:
     while (pNode) {
         if (pNode->pCamera == this) break;
@@ -432,14 +1276,21 @@ void PVDECL  prosilica::cameraLinkCallback(void *Context, tPvInterface Interface
 
 /* From asynPortDriver: Connects driver to device; */
 asynStatus prosilica::connect(asynUser* pasynUser) {
+    int addr;
 
+    /* The region addresses share the connection of the camera */
+    pasynManager->getAddr(pasynUser, &addr);
+    if ((addr > 0) || ((addr == 0) && this->PvHandle)) return asynPortDriver::connect(pasynUser);
     return connectCamera();
 }
 
 
 /* From asynPortDriver: Disconnects driver from device; */
 asynStatus prosilica::disconnect(asynUser* pasynUser) {
+    int addr;
 
+    pasynManager->getAddr(pasynUser, &addr);
+    if (addr > 0) return asynPortDriver::disconnect(pasynUser);
     return disconnectCamera();
 }
 
@@ -447,8 +1298,466 @@ asynStatus prosilica::disconnect(asynUser* pasynUser) {
 static void PVDECL frameCallbackC(tPvFrame *pFrame)
 {
     prosilica *pPvt = (prosilica *) pFrame->Context[0];
-    
-    pPvt->frameCallback(pFrame);
+    epicsUInt64 arrivalMonotonic;
+    epicsTimeStamp arrival;
+
+    /* Take the arrival time first, before the lock and the processing add their variable delays */
+    arrivalMonotonic = epicsMonotonicGet();
+    epicsTimeGetCurrent(&arrival);
+    pPvt->frameCallback(pFrame, &arrival, arrivalMonotonic);
+}
+
+
+static void PVDECL cameraEventCallbackC(void *Context, tPvHandle Camera,
+                                        const tPvCameraEvent *EventList, unsigned long EventListLength)
+{
+    prosilica *pPvt = (prosilica *)Context;
+
+    pPvt->cameraEventCallback(EventList, EventListLength);
+}
+
+
+static void syncInPollTaskC(void *drvPvt)
+{
+    prosilica *pPvt = (prosilica *)drvPvt;
+
+    pPvt->syncInPollTask();
+}
+
+
+static void historyTaskC(void *drvPvt)
+{
+    prosilica *pPvt = (prosilica *)drvPvt;
+
+    pPvt->historyTask();
+}
+
+
+static void roiSeqTaskC(void *drvPvt)
+{
+    prosilica *pPvt = (prosilica *)drvPvt;
+
+    pPvt->roiSeqTask();
+}
+
+
+/* Queued once by the constructor, so it runs in the asyn port thread */
+static void portThreadStartC(asynUser *pasynUser)
+{
+    prosilica *pPvt = (prosilica *)pasynUser->userPvt;
+
+    pPvt->portThreadStart();
+    pasynManager->disconnect(pasynUser);
+    pasynManager->freeAsynUser(pasynUser);
+}
+
+
+/** Records the Linux thread ID of the asyn port thread, for the thread statistics and the NUMA
+  * placement.  Called once in the port thread. */
+void prosilica::portThreadStart()
+{
+    this->lock();
+    this->portThreadId = psHostGetThreadId();
+    /* NUMA placement may have been applied before the ID was known */
+    if (this->numaBound) psNumaBindThread(NULL, this->portThreadId, this->pNumaPool->node);
+    this->unlock();
+}
+
+
+/** Samples the stream health every HISTORY_PERIOD seconds.  The samples are taken on a fixed
+  * schedule, so a late sample does not shift the ones after it. */
+void prosilica::historyTask()
+{
+    epicsTimeStamp next, now, last;
+    double delay;
+
+    epicsTimeGetCurrent(&next);
+    last = next;
+    while (1) {
+        epicsTimeAddSeconds(&next, HISTORY_PERIOD);
+        epicsTimeGetCurrent(&now);
+        delay = epicsTimeDiffInSeconds(&next, &now);
+        /* After a long stall start a new schedule rather than catch up */
+        if (delay < -HISTORY_PERIOD) {
+            next = now;
+            delay = 0.;
+        }
+        if (delay > 0.) epicsThreadSleep(delay);
+        epicsTimeGetCurrent(&now);
+        this->lock();
+        sampleHistory(epicsTimeDiffInSeconds(&now, &last));
+        this->unlock();
+        last = now;
+    }
+}
+
+
+/** Adds a sample of every history series; called with the lock held.  The rates come from the
+  * PvAPI Stat counters, which are kept by the PvAPI library on the host, so reading them does not
+  * access the camera.  The temperatures are those read by the last ReadStatistics.
+  * \param[in] elapsed Seconds since the last sample. */
+void prosilica::sampleHistory(double elapsed)
+{
+    double values[NUM_HISTORY_SERIES];
+    tPvUint32 counters[4], erroneous;
+    float frameRate;
+    int status, numFrames, i;
+    epicsUInt64 newFrames;
+
+    memset(values, 0, sizeof(values));
+    status = -1;
+    if (this->PvHandle) {
+        status  = attrFloat32Get("StatFrameRate", &frameRate);
+        status |= attrUint32Get("StatFramesCompleted", &counters[0]);
+        status |= attrUint32Get("StatFramesDropped", &counters[1]);
+        status |= attrUint32Get("StatPacketsMissed", &counters[2]);
+        status |= attrUint32Get("StatPacketsResent", &counters[3]);
+        status |= attrUint32Get("StatPacketsErroneous", &erroneous);
+    }
+    if (status == 0) {
+        /* The counters restart when the camera is reconnected, then there is no rate */
+        for (i=0; i<4; i++) {
+            if (counters[i] < this->historyCounters[i]) this->historyValid = 0;
+        }
+        if (erroneous < this->historyErroneous) this->historyValid = 0;
+        if (this->historyValid && (elapsed > 0.)) {
+            values[PSHistoryFrameRateSeries]     = frameRate;
+            values[PSHistoryByteRateSeries]      = (double)(this->historyBytes - this->historyLastBytes) / elapsed;
+            values[PSHistoryDropRateSeries]      = (counters[1] - this->historyCounters[1]) / elapsed;
+            values[PSHistoryMissedRateSeries]    = (counters[2] - this->historyCounters[2]) / elapsed;
+            values[PSHistoryResentRateSeries]    = (counters[3] - this->historyCounters[3]) / elapsed;
+            values[PSHistoryErroneousRateSeries] = (erroneous - this->historyErroneous) / elapsed;
+        }
+        memcpy(this->historyCounters, counters, sizeof(counters));
+        this->historyErroneous = erroneous;
+        this->historyValid = 1;
+    } else {
+        this->historyValid = 0;
+    }
+    this->historyLastBytes = this->historyBytes;
+    /* The latency percentile of the frames since the last sample */
+    newFrames = this->numFrameLatency - this->historyLatencyFrames;
+    numFrames = (newFrames > LATENCY_RING_SIZE) ? LATENCY_RING_SIZE : (int)newFrames;
+    if (numFrames > 0) values[PSHistoryLatencyP99Series] = latencyPercentile(0.99, numFrames);
+    this->historyLatencyFrames = this->numFrameLatency;
+    getDoubleParam(ADTemperatureActual, &values[PSHistoryTemperatureSensorSeries]);
+    getDoubleParam(PSTemperatureMainboard, &values[PSHistoryTemperatureMainboardSeries]);
+    psHistoryAdd(&this->history, values);
+}
+
+
+/** Publishes an edge on a sync input; called with the lock held.
+  * \param[in] input Sync input number, starting at 0.
+  * \param[in] level Level of the input after the edge.
+  * \param[in] pTime Time of the edge.
+  */
+void prosilica::syncInEdge(int input, int level, epicsTimeStamp *pTime)
+{
+    int count;
+    int levelParam = input ? PSSyncIn2Level : PSSyncIn1Level;
+    int countParam = input ? PSSyncIn2Count : PSSyncIn1Count;
+    int timeParam  = input ? PSSyncIn2EdgeTime : PSSyncIn1EdgeTime;
+
+    if (level) this->syncInLevels |= (1 << input);
+    else       this->syncInLevels &= ~(1 << input);
+    setIntegerParam(levelParam, level);
+    /* A pulse is counted on its rising edge */
+    if (level) {
+        getIntegerParam(countParam, &count);
+        setIntegerParam(countParam, count+1);
+    }
+    setDoubleParam(timeParam, pTime->secPastEpoch + pTime->nsec*1.e-9);
+    /* Do the callbacks for every edge, so clients see short pulses */
+    callParamCallbacks();
+}
+
+
+/** This function gets called in a thread from the PvApi library when the camera sends events */
+void prosilica::cameraEventCallback(const tPvCameraEvent *pEventList, unsigned long numEvents)
+{
+    epicsTimeStamp edgeTime;
+    const tPvCameraEvent *pEvent;
+    unsigned long i;
+
+    this->lock();
+    for (i=0; i<numEvents; i++) {
+        pEvent = &pEventList[i];
+        getCameraTime(pEvent->TimestampHi, pEvent->TimestampLo, &edgeTime);
+        switch (pEvent->EventId) {
+            case PS_EVENT_SYNC_IN1_RISE: syncInEdge(0, 1, &edgeTime); break;
+            case PS_EVENT_SYNC_IN1_FALL: syncInEdge(0, 0, &edgeTime); break;
+            case PS_EVENT_SYNC_IN2_RISE: syncInEdge(1, 1, &edgeTime); break;
+            case PS_EVENT_SYNC_IN2_FALL: syncInEdge(1, 0, &edgeTime); break;
+            default: break;
+        }
+    }
+    this->unlock();
+}
+
+
+/** Polls the sync input levels when the sync input monitor is in Poll mode.
+  * This is for cameras which do not send sync input events.  Edges are timestamped
+  * with the IOC clock, and pulses shorter than the poll period can be missed.
+  * The attribute is read without the lock, so the round trip to the camera does not hold
+  * up the port and frame threads; the lock is only taken to publish the edges. */
+void prosilica::syncInPollTask()
+{
+    int monitor;
+    double period;
+    tPvHandle handle;
+    tPvUint32 levels;
+    tPvErr err;
+    epicsUInt64 start;
+    epicsTimeStamp now;
+    int i;
+
+    while (1) {
+        this->lock();
+        getIntegerParam(PSSyncInMonitor, &monitor);
+        getDoubleParam(PSSyncInPollPeriod, &period);
+        handle = this->PvHandle;
+        this->unlock();
+        if ((monitor == PSSyncInMonitorPoll) && handle) {
+            start = epicsMonotonicGet();
+            err = PvAttrUint32Get(handle, "SyncInLevels", &levels);
+            epicsTimeGetCurrent(&now);
+            countAttr(PSAttrGet, "SyncInLevels", start, err);
+            this->lock();
+            /* The levels of a camera which was closed meanwhile are discarded */
+            if ((err == ePvErrSuccess) && (this->PvHandle == handle)) {
+                for (i=0; i<NUM_SYNC_INPUTS; i++) {
+                    if ((levels ^ this->syncInLevels) & (1 << i)) syncInEdge(i, (levels >> i) & 1, &now);
+                }
+            }
+            this->unlock();
+        }
+        if (monitor == PSSyncInMonitorPoll) epicsEventWaitWithTimeout(this->syncInPollEvent, period);
+        else epicsEventWait(this->syncInPollEvent);
+    }
+}
+
+
+/** Enables the camera events or the poller for the current sync input monitor mode;
+  * called with the lock held */
+asynStatus prosilica::setSyncInMonitor()
+{
+    int status = asynSuccess;
+    int monitor;
+    tPvUint32 eventsEnable;
+
+    if (!this->PvHandle) return asynError;
+    getIntegerParam(PSSyncInMonitor, &monitor);
+    status |= attrUint32Get("SyncInLevels", &this->syncInLevels);
+    if (attrUint32Get("EventsEnable1", &eventsEnable) == ePvErrSuccess) {
+        if (monitor == PSSyncInMonitorEvents) {
+            eventsEnable |= PS_SYNC_IN_EVENT_MASK;
+            status |= attrEnumSet("EventNotification", "On");
+        } else {
+            eventsEnable &= ~PS_SYNC_IN_EVENT_MASK;
+        }
+        status |= attrUint32Set("EventsEnable1", eventsEnable);
+    } else if (monitor == PSSyncInMonitorEvents) {
+        asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+            "%s:setSyncInMonitor: camera does not support events, use Poll mode\n", driverName);
+        status = asynError;
+    }
+    epicsEventSignal(this->syncInPollEvent);
+    return((asynStatus)status);
+}
+
+
+static void gpoProgramTaskC(void *drvPvt)
+{
+    prosilica *pPvt = (prosilica *)drvPvt;
+
+    pPvt->gpoProgramTask();
+}
+
+
+/** Writes the GPO levels in mask, keeping the others, in a single write and updates the
+  * level parameters; called with the lock held */
+asynStatus prosilica::setGpoLevels(tPvUint32 mask, tPvUint32 levels)
+{
+    int status;
+
+    epicsMutexMustLock(this->gpoMutex);
+    levels = (this->gpoLevels & ~mask) | (levels & mask);
+    status = attrUint32Set("SyncOutGpoLevels", levels);
+    if (!status) this->gpoLevels = levels;
+    epicsMutexUnlock(this->gpoMutex);
+    if (status) return asynError;
+    setGpoLevelParams(levels);
+    return asynSuccess;
+}
+
+
+/** Updates the GPO level parameters; called with the lock held */
+void prosilica::setGpoLevelParams(tPvUint32 levels)
+{
+    setIntegerParam(PSSyncOutGpoLevels, levels & GPO_LEVELS_MASK);
+    setIntegerParam(PSSyncOut1Level, levels&0x01 ? 1:0);
+    setIntegerParam(PSSyncOut2Level, levels&0x02 ? 1:0);
+    setIntegerParam(PSSyncOut3Level, levels&0x04 ? 1:0);
+}
+
+
+/** Checks a GPO program and passes it to the program thread; called with the lock held.
+  * \param[in] masks Levels of the sync outputs for each step.
+  * \param[in] times Time of each step in seconds from the start of the program.  Each step must
+  *            be at least GPO_MIN_STEP_TIME after the one before, since each is a write to the camera.
+  * \param[in] numSteps Number of steps.
+  * \param[in] repeats Number of times the program is run, 0 to run until stopped.
+  * \param[in] period Time in seconds between the starts of each repeat.  Unless the program runs
+  *            once, the first step of a repeat must also be GPO_MIN_STEP_TIME after the last step
+  *            of the one before.
+  */
+asynStatus prosilica::startGpoProgram(const epicsInt32 *masks, const double *times, int numSteps,
+                                      int repeats, double period)
+{
+    int i;
+    static const char *functionName = "startGpoProgram";
+
+    if (this->gpoRunning && !this->gpoRunAbort) {
+        asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+            "%s:%s: a GPO program is already running\n", driverName, functionName);
+        return asynError;
+    }
+    if ((numSteps < 1) || (numSteps > MAX_GPO_PROGRAM_STEPS) || (times[0] < 0.)) goto badProgram;
+    for (i=1; i<numSteps; i++) {
+        if (times[i] - times[i-1] < GPO_MIN_STEP_TIME) goto badProgram;
+    }
+    if ((repeats != 1) &&
+        ((period <= 0.) || (period + times[0] - times[numSteps-1] < GPO_MIN_STEP_TIME))) goto badProgram;
+
+    memcpy(this->gpoRunMasks, masks, numSteps*sizeof(epicsInt32));
+    memcpy(this->gpoRunTimes, times, numSteps*sizeof(double));
+    this->gpoRunSteps = numSteps;
+    this->gpoRunRepeats = repeats;
+    this->gpoRunPeriod = period;
+    this->gpoRunStart = 1;
+    this->gpoRunning = 1;
+    epicsEventSignal(this->gpoProgramEvent);
+    return asynSuccess;
+
+badProgram:
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+        "%s:%s: invalid GPO program, steps=%d, times must start at 0 or later and increase by %g s, "
+        "and the period must be longer than the program\n",
+        driverName, functionName, numSteps, GPO_MIN_STEP_TIME);
+    return asynError;
+}
+
+
+/** Runs GPO programs.  Each step has an absolute deadline from the start of the program,
+  * so errors do not accumulate over the steps and repeats.  The thread sleeps until
+  * GPO_SPIN_TIME before the deadline, then spins until the deadline and writes the levels.
+  * The levels are written without the port lock, which readParameters can hold for many round
+  * trips.  The timing error of a step is the time the camera acknowledged the write minus the
+  * deadline, so it does not include waits for the port lock. */
+void prosilica::gpoProgramTask()
+{
+    epicsInt32 masks[MAX_GPO_PROGRAM_STEPS];
+    double times[MAX_GPO_PROGRAM_STEPS];
+    int numSteps, repeats;
+    double period;
+    epicsTimeStamp start, deadline, now;
+    double remaining, error, errorSum, errorMax;
+    int numWrites;
+    int repeat, step;
+    int abort;
+    int status;
+    tPvUint32 levels = 0;
+    tPvErr err;
+    epicsUInt64 attrStart;
+    static const char *functionName = "gpoProgramTask";
+
+    while (1) {
+        this->lock();
+        while (!this->gpoRunStart) {
+            this->unlock();
+            epicsEventWait(this->gpoProgramEvent);
+            this->lock();
+        }
+        this->gpoRunStart = 0;
+        this->gpoRunAbort = 0;
+        numSteps = this->gpoRunSteps;
+        repeats = this->gpoRunRepeats;
+        period = this->gpoRunPeriod;
+        memcpy(masks, this->gpoRunMasks, numSteps*sizeof(epicsInt32));
+        memcpy(times, this->gpoRunTimes, numSteps*sizeof(double));
+        setDoubleParam(PSGpoTimingError, 0.);
+        setDoubleParam(PSGpoTimingErrorMax, 0.);
+        setDoubleParam(PSGpoTimingErrorMean, 0.);
+        callParamCallbacks();
+        this->unlock();
+
+        /* Leave time to reach the first deadline */
+        epicsTimeGetCurrent(&start);
+        epicsTimeAddSeconds(&start, GPO_SPIN_TIME);
+        errorSum = 0.;
+        errorMax = 0.;
+        numWrites = 0;
+        abort = 0;
+        status = 0;
+        for (repeat=0; ((repeats == 0) || (repeat < repeats)) && !abort && !status; repeat++) {
+            for (step=0; (step < numSteps) && !abort && !status; step++) {
+                deadline = start;
+                epicsTimeAddSeconds(&deadline, repeat*period + times[step]);
+                /* Sleep until shortly before the deadline, waking up if we are stopped */
+                while (1) {
+                    abort = this->gpoRunAbort;
+                    epicsTimeGetCurrent(&now);
+                    remaining = epicsTimeDiffInSeconds(&deadline, &now);
+                    if (abort || (remaining <= GPO_SPIN_TIME)) break;
+                    epicsEventWaitWithTimeout(this->gpoProgramEvent, remaining - GPO_SPIN_TIME);
+                }
+                if (abort) break;
+                do {
+                    epicsTimeGetCurrent(&now);
+                } while (epicsTimeDiffInSeconds(&deadline, &now) > 0.);
+
+                epicsMutexMustLock(this->gpoMutex);
+                if (this->gpoHandle) {
+                    levels = (this->gpoLevels & ~GPO_LEVELS_MASK) | (masks[step] & GPO_LEVELS_MASK);
+                    attrStart = epicsMonotonicGet();
+                    err = PvAttrUint32Set(this->gpoHandle, "SyncOutGpoLevels", levels);
+                    countAttr(PSAttrSet, "SyncOutGpoLevels", attrStart, err);
+                    if (err == ePvErrSuccess) this->gpoLevels = levels;
+                } else {
+                    err = ePvErrBadHandle;
+                }
+                epicsMutexUnlock(this->gpoMutex);
+                epicsTimeGetCurrent(&now);
+                status = (err == ePvErrSuccess) ? asynSuccess : asynError;
+                error = epicsTimeDiffInSeconds(&now, &deadline);
+                errorSum += error;
+                numWrites++;
+                if (error > errorMax) errorMax = error;
+
+                this->lock();
+                if (!status) setGpoLevelParams(levels);
+                setIntegerParam(PSGpoProgramStep, step);
+                setDoubleParam(PSGpoTimingError, error);
+                setDoubleParam(PSGpoTimingErrorMax, errorMax);
+                setDoubleParam(PSGpoTimingErrorMean, errorSum/numWrites);
+                callParamCallbacks();
+                this->unlock();
+            }
+        }
+        this->lock();
+        if (status) {
+            asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+                "%s:%s: error writing GPO levels, program stopped at repeat %d step %d\n",
+                driverName, functionName, repeat, step);
+        }
+        /* A new program may have been started after this one was stopped */
+        if (!this->gpoRunStart) {
+            this->gpoRunning = 0;
+            setIntegerParam(PSGpoProgramRun, 0);
+        }
+        callParamCallbacks();
+        this->unlock();
+    }
 }
 
 
@@ -456,10 +1765,15 @@ static void PVDECL frameCallbackC(tPvFrame *pFrame)
 asynStatus prosilica::syncTimer() {
 
     //static const char *functionName = "syncTimer";
+    int timestampType;
+
+    getIntegerParam(PSTimestampType, &timestampType);
+    /* The PTP clock is set by the PTP master, resetting it would lose the lock */
+    if (timestampType == PSTimestampTypePTP) return asynSuccess;
     if (this->PvHandle) {
         epicsTimeGetCurrent(&lastSyncTime);
         // Tell the camera to reset its internal clock
-        PvCommandRun(this->PvHandle, "TimeStampReset");
+        commandRun("TimeStampReset");
         return asynSuccess;
     }
     else {
@@ -468,8 +1782,31 @@ asynStatus prosilica::syncTimer() {
 }
 
 
-/** This function gets called in a thread from the PvApi library when a new frame arrives */
-void prosilica::frameCallback(tPvFrame *pFrame)
+/** Converts a camera timestamp to EPICS time, using the PTP clock if that is the
+  * timestamp type, and otherwise the time of the last timer reset.
+  * A PTP clock which has not been set by the master gives the IOC time instead. */
+void prosilica::getCameraTime(unsigned long timestampHi, unsigned long timestampLo, epicsTimeStamp *pTime)
+{
+    const double native_frame_ticks = ((double)timestampLo + (double)timestampHi*4294967296.);
+    int timestampType;
+
+    getIntegerParam(PSTimestampType, &timestampType);
+    if (timestampType == PSTimestampTypePTP) {
+        if (psPtpTicksToEpicsTime(((epicsUInt64)timestampHi << 32) | (epicsUInt32)timestampLo,
+                                  this->timeStampFrequency, pTime)) epicsTimeGetCurrent(pTime);
+        return;
+    }
+    if (this->timeStampFrequency == 0) this->timeStampFrequency = 1;
+    *pTime = lastSyncTime;
+    epicsTimeAddSeconds(pTime, native_frame_ticks/this->timeStampFrequency);
+}
+
+
+/** This function gets called in a thread from the PvApi library when a new frame arrives.
+  * \param[in] pFrame The PvAPI frame.
+  * \param[in] pArrival IOC time when the PvAPI library called us.
+  * \param[in] arrivalMonotonic epicsMonotonicGet() when the PvAPI library called us. */
+void prosilica::frameCallback(tPvFrame *pFrame, const epicsTimeStamp *pArrival, epicsUInt64 arrivalMonotonic)
 {
     int ndims;
     size_t dims[3];
@@ -479,8 +1816,22 @@ void prosilica::frameCallback(tPvFrame *pFrame)
     NDArray *pTempImage;
     int binX, binY;
     int badFrameCounter;
-    int bayerConvert;
+    int bayerConvert, rgbLayout, conversion;
+    int softBinX, softBinY, softBinMode, softBinType, cell;
     epicsInt32 bayerPattern, colorMode;
+    epicsInt32 groupSequence;
+    int setsComplete, setsIncomplete;
+    int gateMode, gateDiscarded;
+    int regionAddr;
+    int threadId;
+    int synthetic;
+    epicsInt32 gatePoint;
+    epicsTimeStamp processStart, processEnd;
+    epicsTimeStamp exposureStart, exposureMid, exposureEnd;
+    double exposureTime, readoutTime, transferTime, arrivalOffset, modelDelay, epicsSeconds;
+    int byteRate;
+    epicsUInt64 perfValues[PSPerfNumEvents];
+    int perfRunning;
     static const char *functionName = "frameCallback";
 
     /* If this callback is coming from a shutdown operation rather than normal collection, 
@@ -490,11 +1841,49 @@ void prosilica::frameCallback(tPvFrame *pFrame)
     if (pFrame->Status == ePvErrCancelled) return;
 
     this->lock();
+    epicsTimeGetCurrent(&processStart);
+
+    /* Frames injected by the stress test and the headroom benchmark do not come from the camera */
+    synthetic = (pFrame->Context[2] != NULL);
+
+    /* Remember the PvAPI thread which calls us for the thread statistics, and give it a name */
+    threadId = psHostGetThreadId();
+    if (!synthetic && (threadId != this->frameThreadId)) {
+        this->frameThreadId = threadId;
+        psHostSetThreadName("PvAPIFrame");
+        applyNumaPlacement();
+    }
+    /* The plugins may have given back buffers since a frame was parked */
+    if (!synthetic && this->numParkedFrames) requeueParkedFrames();
 
     pImage = (NDArray *)pFrame->Context[1];
+
+    /* The byte rate history counts what the camera sent, before any conversion or binning */
+    if (!synthetic && (pFrame->Status == ePvErrSuccess)) this->historyBytes += pFrame->ImageSize;
+
+    /* In gated mode the frames outside the gate are counted and queued again without processing.
+     * Synthetic frames are not part of an acquisition, so they are not gated. */
+    if (pImage && !synthetic && (pFrame->Status == ePvErrSuccess) && !gateAccept(pFrame)) {
+        getIntegerParam(PSGateDiscarded, &gateDiscarded);
+        setIntegerParam(PSGateDiscarded, gateDiscarded+1);
+        psMetricsAdd(&this->metrics, PSMetricGateDiscarded, 1);
+        callParamCallbacks();
+        requeueFrame(pFrame);
+        this->unlock();
+        return;
+    }
     
-    /* If we're out of memory, pImage will be NULL */
+    /* Frames without an image buffer are parked rather than queued, see requeueFrame */
     if (pImage && pFrame->Status == ePvErrSuccess) {
+        /* Publish the time from AcquisitionStart to the first frame of this acquisition */
+        if (this->firstFramePending) {
+            this->firstFramePending = 0;
+            double latency = epicsTimeDiffInSeconds(&processStart, &this->acquireStartTime);
+            setDoubleParam(PSFirstFrameLatency, latency);
+            psMetricsSet(&this->metrics, PSMetricFirstFrameLatency, (size_t)(latency*1e6 + 0.5));
+        }
+        /* Move the camera window on as early as possible, and find the region of this frame */
+        regionAddr = routeRoiSequence(pFrame);
         /* The frame we just received has NDArray* in Context[1] */ 
         /* Set the properties of the image to those of the current frame */
         /* Convert from the PvApi data types to ADDataType */
@@ -507,6 +1896,28 @@ void prosilica::frameCallback(tPvFrame *pFrame)
         pImage->uniqueId = pFrame->FrameCount;
         updateTimeStamp(&pImage->epicsTS);
 
+        /* Keep the delay from the camera timestamp to now, for the latency percentiles.
+         * Synthetic frames have no camera timestamp. */
+        if (!synthetic) {
+            epicsTimeStamp frameTime, now;
+            getCameraTime(pFrame->TimestampHi, pFrame->TimestampLo, &frameTime);
+            epicsTimeGetCurrent(&now);
+            this->frameLatency[this->numFrameLatency % LATENCY_RING_SIZE] = epicsTimeDiffInSeconds(&now, &frameTime);
+            psMetricsAddLatency(&this->metrics, this->frameLatency[this->numFrameLatency % LATENCY_RING_SIZE]);
+            this->numFrameLatency++;
+        }
+
+        /* Count the frames which arrived in memory on another node than the interface */
+        if ((this->numaNode >= 0) && (pImage->pNDArrayPool == this->pNumaPool)) {
+            int bufferNode = ((psNumaArray *)pImage)->pageNode;
+            int remoteFrames;
+            setIntegerParam(PSNumaBufferNode, bufferNode);
+            if ((bufferNode >= 0) && (bufferNode != this->numaNode)) {
+                getIntegerParam(PSNumaRemoteFrames, &remoteFrames);
+                setIntegerParam(PSNumaRemoteFrames, remoteFrames+1);
+            }
+        }
+
         getIntegerParam(ADBinX, &binX);
         getIntegerParam(ADBinY, &binY);
 
@@ -515,6 +1926,16 @@ void prosilica::frameCallback(tPvFrame *pFrame)
         if (pFrame->BayerPattern > ePvBayerBGGR) pFrame->BayerPattern = ePvBayerRGGB;
         bayerPattern = pFrame->BayerPattern;
         getIntegerParam(PSBayerConvert, &bayerConvert);
+        getIntegerParam(PSRgbLayout, &rgbLayout);
+        /* The conversion done by the driver, for the processing cost */
+        conversion = PSBayerConvertNone;
+        if ((pFrame->Format == ePvFmtBayer8) || (pFrame->Format == ePvFmtBayer16)) conversion = bayerConvert;
+        else if ((pFrame->Format == ePvFmtRgb24) || (pFrame->Format == ePvFmtRgb48)) conversion = rgbLayoutConversion(rgbLayout);
+
+        /* Count the hardware events of each stage of the frame processing if enabled.
+         * The counters belong to the PvAPI thread, which does not process the synthetic frames. */
+        perfRunning = synthetic ? 0 : perfFrameStart(perfValues);
+        if (perfRunning) this->perfPixels += (double)pFrame->Width * pFrame->Height;
 
         switch(pFrame->Format) {
             case ePvFmtMono8:
@@ -554,11 +1975,20 @@ void prosilica::frameCallback(tPvFrame *pFrame)
                     pImage->dims[1].binning = binY;
                 } else {
                     pTempImage = pImage;
-                    ndims = 3;
-                    dims[0] = 3;
-                    dims[1] = pFrame->Width;
-                    dims[2] = pFrame->Height;
-                    pImage = this->pNDArrayPool->alloc(ndims, dims, NDUInt8, this->maxFrameSize, NULL);
+                    if (bayerConvert == PSBayerConvertMono) {
+                        /* The luminance needs a third of the memory of RGB */
+                        ndims = 2;
+                        dims[0] = pFrame->Width;
+                        dims[1] = pFrame->Height;
+                        pImage = this->pNDArrayPool->alloc(ndims, dims, NDUInt8, 0, NULL);
+                    } else {
+                        ndims = 3;
+                        dims[0] = 3;
+                        dims[1] = pFrame->Width;
+                        dims[2] = pFrame->Height;
+                        pImage = this->pNDArrayPool->alloc(ndims, dims, NDUInt8, this->maxFrameSize, NULL);
+                    }
+                    if (!pImage) goto noMemory;
                     epicsUInt8 *pData = (epicsUInt8 *)pImage->pData;
                     switch (bayerConvert) {
                         case PSBayerConvertRGB1: {
@@ -611,6 +2041,19 @@ void prosilica::frameCallback(tPvFrame *pFrame)
                             pImage->dims[2].binning = 1;
                             break;
                         }
+
+                        case PSBayerConvertMono: {
+                            psBayerLuminance8((const epicsUInt8 *)pFrame->ImageBuffer, pData, pFrame->Width, pFrame->Height);
+                            colorMode = NDColorModeMono;
+                            pImage->ndims = 2;
+                            pImage->dims[0].size    = pFrame->Width;
+                            pImage->dims[0].offset  = pFrame->RegionX;
+                            pImage->dims[0].binning = binX;
+                            pImage->dims[1].size    = pFrame->Height;
+                            pImage->dims[1].offset  = pFrame->RegionY;
+                            pImage->dims[1].binning = binY;
+                            break;
+                        }
                     }
                     pTempImage->release();
                 }
@@ -629,11 +2072,20 @@ void prosilica::frameCallback(tPvFrame *pFrame)
                     pImage->dims[1].binning = binY;
                 } else {
                     pTempImage = pImage;
-                    ndims = 3;
-                    dims[0] = 3;
-                    dims[1] = pFrame->Width;
-                    dims[2] = pFrame->Height;
-                    pImage = this->pNDArrayPool->alloc(ndims, dims, NDUInt16, this->maxFrameSize, NULL);
+                    if (bayerConvert == PSBayerConvertMono) {
+                        /* The luminance needs a third of the memory of RGB */
+                        ndims = 2;
+                        dims[0] = pFrame->Width;
+                        dims[1] = pFrame->Height;
+                        pImage = this->pNDArrayPool->alloc(ndims, dims, NDUInt16, 0, NULL);
+                    } else {
+                        ndims = 3;
+                        dims[0] = 3;
+                        dims[1] = pFrame->Width;
+                        dims[2] = pFrame->Height;
+                        pImage = this->pNDArrayPool->alloc(ndims, dims, NDUInt16, this->maxFrameSize, NULL);
+                    }
+                    if (!pImage) goto noMemory;
                     epicsUInt16 *pData = (epicsUInt16 *)pImage->pData;
 
                     switch (bayerConvert) {
@@ -687,39 +2139,142 @@ void prosilica::frameCallback(tPvFrame *pFrame)
                             pImage->dims[2].binning = 1;
                             break;
                         }
-                    }
-                    pTempImage->release();
+
+                        case PSBayerConvertMono: {
+                            psBayerLuminance16((const epicsUInt16 *)pFrame->ImageBuffer, pData, pFrame->Width, pFrame->Height);
+                            colorMode = NDColorModeMono;
+                            pImage->ndims = 2;
+                            pImage->dims[0].size    = pFrame->Width;
+                            pImage->dims[0].offset  = pFrame->RegionX;
+                            pImage->dims[0].binning = binX;
+                            pImage->dims[1].size    = pFrame->Height;
+                            pImage->dims[1].offset  = pFrame->RegionY;
+                            pImage->dims[1].binning = binY;
+                            break;
+                        }
+                    }
+                    pTempImage->release();
                 }
                 break;
 
             case ePvFmtRgb24:
-                colorMode = NDColorModeRGB1;
-                pImage->dataType = NDUInt8;
-                pImage->ndims = 3;
-                pImage->dims[0].size    = 3;
-                pImage->dims[0].offset  = 0;
-                pImage->dims[0].binning = 1;
-                pImage->dims[1].size    = pFrame->Width;
-                pImage->dims[1].offset  = pFrame->RegionX;
-                pImage->dims[1].binning = binX;
-                pImage->dims[2].size    = pFrame->Height;
-                pImage->dims[2].offset  = pFrame->RegionY;
-                pImage->dims[2].binning = binY;
+                if (rgbLayout != PSRgbLayoutRGB2 && rgbLayout != PSRgbLayoutRGB3) {
+                    colorMode = NDColorModeRGB1;
+                    pImage->dataType = NDUInt8;
+                    pImage->ndims = 3;
+                    pImage->dims[0].size    = 3;
+                    pImage->dims[0].offset  = 0;
+                    pImage->dims[0].binning = 1;
+                    pImage->dims[1].size    = pFrame->Width;
+                    pImage->dims[1].offset  = pFrame->RegionX;
+                    pImage->dims[1].binning = binX;
+                    pImage->dims[2].size    = pFrame->Height;
+                    pImage->dims[2].offset  = pFrame->RegionY;
+                    pImage->dims[2].binning = binY;
+                } else {
+                    /* Split the colours into a new array, rather than leaving it to NDPluginColorConvert */
+                    pTempImage = pImage;
+                    ndims = 3;
+                    dims[0] = 3;
+                    dims[1] = pFrame->Width;
+                    dims[2] = pFrame->Height;
+                    pImage = this->pNDArrayPool->alloc(ndims, dims, NDUInt8, this->maxFrameSize, NULL);
+                    if (!pImage) goto noMemory;
+                    epicsUInt8 *pData = (epicsUInt8 *)pImage->pData;
+                    const epicsUInt8 *pRaw = (const epicsUInt8 *)pFrame->ImageBuffer;
+                    if (rgbLayout == PSRgbLayoutRGB2) {
+                        int rowSize = pFrame->Width;
+                        psRgbDeinterleave8(pRaw, pData, pData+rowSize, pData+2*rowSize,
+                                          pFrame->Width, pFrame->Height, 3*rowSize);
+                        colorMode = NDColorModeRGB2;
+                        pImage->ndims = 3;
+                        pImage->dims[0].size   = pFrame->Width;
+                        pImage->dims[0].offset = pFrame->RegionX;
+                        pImage->dims[0].binning = binX;
+                        pImage->dims[1].size    = 3;
+                        pImage->dims[1].offset  = 0;
+                        pImage->dims[1].binning = 1;
+                        pImage->dims[2].size   = pFrame->Height;
+                        pImage->dims[2].offset = pFrame->RegionY;
+                        pImage->dims[2].binning = binY;
+                    } else {
+                        int imageSize = pFrame->Width * pFrame->Height;
+                        psRgbDeinterleave8(pRaw, pData, pData+imageSize, pData+2*imageSize,
+                                          pFrame->Width, pFrame->Height, pFrame->Width);
+                        colorMode = NDColorModeRGB3;
+                        pImage->ndims = 3;
+                        pImage->dims[0].size   = pFrame->Width;
+                        pImage->dims[0].offset = pFrame->RegionX;
+                        pImage->dims[0].binning = binX;
+                        pImage->dims[1].size   = pFrame->Height;
+                        pImage->dims[1].offset = pFrame->RegionY;
+                        pImage->dims[1].binning = binY;
+                        pImage->dims[2].size    = 3;
+                        pImage->dims[2].offset  = 0;
+                        pImage->dims[2].binning = 1;
+                    }
+                    pTempImage->release();
+                }
                 break;
 
             case ePvFmtRgb48:
-                colorMode = NDColorModeRGB1;
-                pImage->dataType = NDUInt16;
-                pImage->ndims = 3;
-                pImage->dims[0].size    = 3;
-                pImage->dims[0].offset  = 0;
-                pImage->dims[0].binning = 1;
-                pImage->dims[1].size    = pFrame->Width;
-                pImage->dims[1].offset  = pFrame->RegionX;
-                pImage->dims[1].binning = binX;
-                pImage->dims[2].size    = pFrame->Height;
-                pImage->dims[2].offset  = pFrame->RegionY;
-                pImage->dims[2].binning = binY;
+                if (rgbLayout != PSRgbLayoutRGB2 && rgbLayout != PSRgbLayoutRGB3) {
+                    colorMode = NDColorModeRGB1;
+                    pImage->dataType = NDUInt16;
+                    pImage->ndims = 3;
+                    pImage->dims[0].size    = 3;
+                    pImage->dims[0].offset  = 0;
+                    pImage->dims[0].binning = 1;
+                    pImage->dims[1].size    = pFrame->Width;
+                    pImage->dims[1].offset  = pFrame->RegionX;
+                    pImage->dims[1].binning = binX;
+                    pImage->dims[2].size    = pFrame->Height;
+                    pImage->dims[2].offset  = pFrame->RegionY;
+                    pImage->dims[2].binning = binY;
+                } else {
+                    /* Split the colours into a new array, rather than leaving it to NDPluginColorConvert */
+                    pTempImage = pImage;
+                    ndims = 3;
+                    dims[0] = 3;
+                    dims[1] = pFrame->Width;
+                    dims[2] = pFrame->Height;
+                    pImage = this->pNDArrayPool->alloc(ndims, dims, NDUInt16, this->maxFrameSize, NULL);
+                    if (!pImage) goto noMemory;
+                    epicsUInt16 *pData = (epicsUInt16 *)pImage->pData;
+                    const epicsUInt16 *pRaw = (const epicsUInt16 *)pFrame->ImageBuffer;
+                    if (rgbLayout == PSRgbLayoutRGB2) {
+                        int rowSize = pFrame->Width;
+                        psRgbDeinterleave16(pRaw, pData, pData+rowSize, pData+2*rowSize,
+                                          pFrame->Width, pFrame->Height, 3*rowSize);
+                        colorMode = NDColorModeRGB2;
+                        pImage->ndims = 3;
+                        pImage->dims[0].size   = pFrame->Width;
+                        pImage->dims[0].offset = pFrame->RegionX;
+                        pImage->dims[0].binning = binX;
+                        pImage->dims[1].size    = 3;
+                        pImage->dims[1].offset  = 0;
+                        pImage->dims[1].binning = 1;
+                        pImage->dims[2].size   = pFrame->Height;
+                        pImage->dims[2].offset = pFrame->RegionY;
+                        pImage->dims[2].binning = binY;
+                    } else {
+                        int imageSize = pFrame->Width * pFrame->Height;
+                        psRgbDeinterleave16(pRaw, pData, pData+imageSize, pData+2*imageSize,
+                                          pFrame->Width, pFrame->Height, pFrame->Width);
+                        colorMode = NDColorModeRGB3;
+                        pImage->ndims = 3;
+                        pImage->dims[0].size   = pFrame->Width;
+                        pImage->dims[0].offset = pFrame->RegionX;
+                        pImage->dims[0].binning = binX;
+                        pImage->dims[1].size   = pFrame->Height;
+                        pImage->dims[1].offset = pFrame->RegionY;
+                        pImage->dims[1].binning = binY;
+                        pImage->dims[2].size    = 3;
+                        pImage->dims[2].offset  = 0;
+                        pImage->dims[2].binning = 1;
+                    }
+                    pTempImage->release();
+                }
                 break;
 
             default:
@@ -729,12 +2284,77 @@ void prosilica::frameCallback(tPvFrame *pFrame)
                     driverName, functionName, pFrame->Format);
                 break;
         }
+
+        /* Software binning of the 2-D images.  It reads the frame buffer or the converted image directly,
+         * and a Bayer mosaic is binned by colour so that it stays a mosaic with the same pattern.
+         * For Mono and raw Bayer frames this is the only pass over the pixels; after BayerConvert=Mono
+         * it is a second pass over the luminance image, which is not fused into the conversion. */
+        getIntegerParam(PSSoftBinX, &softBinX);
+        getIntegerParam(PSSoftBinY, &softBinY);
+        cell = (colorMode == NDColorModeBayer) ? 2 : 1;
+        if (((softBinX > 1) || (softBinY > 1)) && (pImage->ndims == 2) &&
+            ((pImage->dataType == NDUInt8) || (pImage->dataType == NDUInt16)) &&
+            (psBinSize((int)pImage->dims[0].size, softBinX, cell) > 0) &&
+            (psBinSize((int)pImage->dims[1].size, softBinY, cell) > 0)) {
+            getIntegerParam(PSSoftBinMode, &softBinMode);
+            getIntegerParam(PSSoftBinType, &softBinType);
+            pTempImage = pImage;
+            ndims = 2;
+            dims[0] = psBinSize((int)pTempImage->dims[0].size, softBinX, cell);
+            dims[1] = psBinSize((int)pTempImage->dims[1].size, softBinY, cell);
+            pImage = this->pNDArrayPool->alloc(ndims, dims,
+                                               (softBinType == PSSoftBinUInt32) ? NDUInt32 : NDUInt16, 0, NULL);
+            if (!pImage) {
+                /* An image converted above is released, the frame buffer stays with the frame */
+                if (pTempImage != (NDArray *)pFrame->Context[1]) pTempImage->release();
+                goto noMemory;
+            }
+            psBinImage(pTempImage->pData, (pTempImage->dataType == NDUInt8) ? 1 : 2,
+                       (int)pTempImage->dims[0].size, (int)pTempImage->dims[1].size,
+                       pImage->pData, (softBinType == PSSoftBinUInt32) ? 4 : 2,
+                       softBinX, softBinY, cell, softBinMode == PSSoftBinAverage);
+            pImage->dims[0].offset  = pTempImage->dims[0].offset;
+            pImage->dims[0].binning = pTempImage->dims[0].binning * softBinX;
+            pImage->dims[1].offset  = pTempImage->dims[1].offset;
+            pImage->dims[1].binning = pTempImage->dims[1].binning * softBinY;
+            pImage->uniqueId = pTempImage->uniqueId;
+            pImage->epicsTS = pTempImage->epicsTS;
+            pTempImage->release();
+        }
         pImage->pAttributeList->add("BayerPattern", "Bayer Pattern", NDAttrInt32, &bayerPattern);
         pImage->pAttributeList->add("ColorMode", "Color Mode", NDAttrInt32, &colorMode);
+        if (perfRunning) perfStageEnd(PSPerfStageConvert, perfValues);
         
         /* Now set timeStamp field in pImage */
         const double native_frame_ticks =  ((double)pFrame->TimestampLo + (double)pFrame->TimestampHi*4294967296.);
 
+        /* Estimate the exposure from the arrival time.  The last packet leaves the camera when the
+         * sensor has been read out and the frame has been sent at StreamBytesPerSecond, which
+         * overlap, so the exposure ended the longer of the two before the arrival. */
+        getDoubleParam(ADAcquireTime, &exposureTime);
+        getDoubleParam(PSArrivalOffset, &arrivalOffset);
+        getIntegerParam(PSByteRate, &byteRate);
+        readoutTime = this->rowReadoutTime * pFrame->Height;
+        transferTime = (byteRate > 0) ? (double)pFrame->ImageSize / byteRate : 0.;
+        modelDelay = arrivalOffset + ((readoutTime > transferTime) ? readoutTime : transferTime);
+        exposureEnd = *pArrival;
+        epicsTimeAddSeconds(&exposureEnd, -modelDelay);
+        exposureMid = exposureEnd;
+        epicsTimeAddSeconds(&exposureMid, -exposureTime/2.);
+        exposureStart = exposureEnd;
+        epicsTimeAddSeconds(&exposureStart, -exposureTime);
+        setDoubleParam(PSArrivalModelDelay, modelDelay);
+        setDoubleParam(PSArrivalLatency, (epicsMonotonicGet() - arrivalMonotonic) * 1e-9);
+        /* The attributes are seconds since the EPICS epoch */
+        epicsSeconds = pArrival->secPastEpoch + pArrival->nsec*1e-9;
+        pImage->pAttributeList->add("HostArrival", "IOC time the frame arrived", NDAttrFloat64, &epicsSeconds);
+        epicsSeconds = exposureStart.secPastEpoch + exposureStart.nsec*1e-9;
+        pImage->pAttributeList->add("ExposureStart", "Estimated start of the exposure", NDAttrFloat64, &epicsSeconds);
+        epicsSeconds = exposureMid.secPastEpoch + exposureMid.nsec*1e-9;
+        pImage->pAttributeList->add("ExposureMid", "Estimated middle of the exposure", NDAttrFloat64, &epicsSeconds);
+        epicsSeconds = exposureEnd.secPastEpoch + exposureEnd.nsec*1e-9;
+        pImage->pAttributeList->add("ExposureEnd", "Estimated end of the exposure", NDAttrFloat64, &epicsSeconds);
+
         /* Determine how to set the timeStamp */
         PSTimestampType_t timestamp_type = PSTimestampTypeNativeTicks;
         getIntegerParam(PSTimestampType, (int*)&timestamp_type);
@@ -750,10 +2370,8 @@ void prosilica::frameCallback(tPvFrame *pFrame)
                 break;
 
             case PSTimestampTypePOSIX: {
-                    if (this->timeStampFrequency == 0) this->timeStampFrequency = 1;
-                    epicsTimeStamp epics_frame_time = lastSyncTime;
-                    epicsTimeAddSeconds(&epics_frame_time, 
-                        native_frame_ticks/this->timeStampFrequency);
+                    epicsTimeStamp epics_frame_time;
+                    getCameraTime(pFrame->TimestampHi, pFrame->TimestampLo, &epics_frame_time);
                     timespec ts;
                     epicsTimeToTimespec(&ts, &epics_frame_time);
                     pImage->timeStamp = (double)ts.tv_sec + ((double)ts.tv_nsec * 1.0e-9);
@@ -761,10 +2379,8 @@ void prosilica::frameCallback(tPvFrame *pFrame)
                 break;
 
             case PSTimestampTypeEPICS: {
-                    if (this->timeStampFrequency == 0) this->timeStampFrequency = 1;
-                    epicsTimeStamp epics_frame_time = lastSyncTime;
-                    epicsTimeAddSeconds(&epics_frame_time, 
-                        native_frame_ticks/this->timeStampFrequency);
+                    epicsTimeStamp epics_frame_time;
+                    getCameraTime(pFrame->TimestampHi, pFrame->TimestampLo, &epics_frame_time);
                     pImage->timeStamp = (double)epics_frame_time.secPastEpoch + 
                       ((double)epics_frame_time.nsec * 1.0e-09);
                 }
@@ -776,32 +2392,99 @@ void prosilica::frameCallback(tPvFrame *pFrame)
                 }
                 break;
 
+            case PSTimestampTypePTP: {
+                    /* The camera clock is better than the IOC clock, so use it for epicsTS too */
+                    getCameraTime(pFrame->TimestampHi, pFrame->TimestampLo, &pImage->epicsTS);
+                    pImage->timeStamp = (double)pImage->epicsTS.secPastEpoch 
+                      + ((double)pImage->epicsTS.nsec * 1.0e-9);
+                }
+                break;
+
+            case PSTimestampTypeExposure:
+                /* Does not include the processing delay of the IOC timestamp */
+                pImage->epicsTS = exposureMid;
+                pImage->timeStamp = (double)exposureMid.secPastEpoch
+                  + ((double)exposureMid.nsec * 1.0e-9);
+                break;
+
             default:
                 pImage->timeStamp = native_frame_ticks;
         }
 
+        /* Tag the frame with the group sequence number of the trigger it belongs to */
+        if (this->pGroup && !synthetic) {
+            epicsTimeStamp groupTime;
+            getCameraTime(pFrame->TimestampHi, pFrame->TimestampLo, &groupTime);
+            groupSequence = groupMatchFrame(this->pGroup, this->groupMember,
+                                            groupTime.secPastEpoch + groupTime.nsec*1.e-9,
+                                            &setsComplete, &setsIncomplete);
+            pImage->pAttributeList->add("GroupSequence", "Acquisition group sequence number", 
+                                        NDAttrInt32, &groupSequence);
+            setIntegerParam(PSGroupSequence, groupSequence);
+            setIntegerParam(PSGroupSetsComplete, setsComplete);
+            setIntegerParam(PSGroupSetsIncomplete, setsIncomplete);
+        }
+
+        /* Tag the frame with the scan point of the gate, and close the gate after the last frame */
+        getIntegerParam(PSGateMode, &gateMode);
+        if (gateMode && !synthetic) {
+            getIntegerParam(PSGatePoint, &gatePoint);
+            pImage->pAttributeList->add("ScanPoint", "Gated delivery scan point index",
+                                        NDAttrInt32, &gatePoint);
+            if (--this->gateRemaining == 0) {
+                setIntegerParam(PSGatePoint, gatePoint+1);
+                setIntegerParam(PSGateOpen, 0);
+            }
+        }
+
+        /* Measure the processing cost of this pixel format and conversion for the estimator */
+        if ((pFrame->Format < NUM_EST_PIXEL_FORMATS) && (conversion >= 0) &&
+            (conversion < NUM_BAYER_CONVERT_MODES) && (pFrame->Width * pFrame->Height > 0)) {
+            double *pCost = &this->processCost[pFrame->Format][conversion];
+            double cost;
+            epicsTimeGetCurrent(&processEnd);
+            cost = epicsTimeDiffInSeconds(&processEnd, &processStart) / (pFrame->Width * pFrame->Height);
+            *pCost = (*pCost == 0.) ? cost : (1. - EST_COST_FILTER) * *pCost + EST_COST_FILTER * cost;
+        }
+
         /* Get any attributes that have been defined for this driver */        
         this->getAttributes(pImage->pAttributeList);
         
         getIntegerParam(NDArrayCallbacks, &arrayCallbacks);
-
-        if (arrayCallbacks) {
+        if (perfRunning) perfStageEnd(PSPerfStageAttributes, perfValues);
+
+        if (arrayCallbacks && (regionAddr > 0)) {
+            /* A frame of the ROI sequence goes only to the address of its region */
+            pImage->pAttributeList->add("RegionAddress", "Address of the ROI sequence region",
+                                        NDAttrInt32, &regionAddr);
+            pImage->reserve();
+            setIntegerParam(regionAddr, PSRegionZeroCopy, 1);
+            publishRegion(regionAddr, pImage);
+        } else if (arrayCallbacks) {
             /* Call the NDArray callback */
             doCallbacksGenericPointer(pImage, NDArrayData, 0);
+            doRegionCallbacks(pImage);
         }
-
-        /* See if acquisition is done */
-        if (this->framesRemaining > 0) this->framesRemaining--;
-        if (this->framesRemaining == 0) {
-            setShutter(0);
-            setIntegerParam(ADAcquire, 0);
-            setIntegerParam(ADStatus, ADStatusIdle);
+        if (perfRunning) perfStageEnd(PSPerfStageCallbacks, perfValues);
+
+        /* See if acquisition is done.  Synthetic frames are not part of an acquisition. */
+        if (!synthetic) {
+            if (this->framesRemaining > 0) this->framesRemaining--;
+            if (this->framesRemaining == 0) {
+                setShutter(0);
+                stopRoiSequence();
+                setIntegerParam(ADAcquire, 0);
+                setIntegerParam(PSGroupAcquire, 0);
+                setIntegerParam(ADStatus, ADStatusIdle);
+                psMetricsSet(&this->metrics, PSMetricAcquiring, 0);
+            }
         }
 
         /* Update the frame counter */
         getIntegerParam(NDArrayCounter, &imageCounter);
         imageCounter++;
         setIntegerParam(NDArrayCounter, imageCounter);
+        psMetricsAdd(&this->metrics, PSMetricFrames, 1);
 
         asynPrintIO(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, 
             (const char *)pImage->pData, pImage->dataSize,
@@ -820,8 +2503,12 @@ void prosilica::frameCallback(tPvFrame *pFrame)
         pImage = this->pNDArrayPool->alloc(ndims, dims, NDInt8, this->maxFrameSize, NULL);
         /* Put the pointer to this image buffer in the frame context[1] */
         pFrame->Context[1] = pImage;
-        /* Reset the frame buffer data pointer be this image buffer data pointer */
-        pFrame->ImageBuffer = pImage->pData;
+        /* Reset the frame buffer data pointer be this image buffer data pointer.
+         * If the pool is exhausted pImage is NULL and requeueFrame parks the frame. */
+        pFrame->ImageBuffer = pImage ? pImage->pData : NULL;
+        psMetricsSet(&this->metrics, PSMetricPoolBuffers, this->pNDArrayPool->getNumBuffers());
+        psMetricsSet(&this->metrics, PSMetricPoolFreeBuffers, this->pNDArrayPool->getNumFree());
+        psMetricsSet(&this->metrics, PSMetricPoolMemory, this->pNDArrayPool->getMemorySize());
     } else {
         asynPrint(this->pasynUserSelf, ASYN_TRACE_FLOW, 
             "%s:%s: ERROR, frame has error code %d\n",
@@ -829,14 +2516,175 @@ void prosilica::frameCallback(tPvFrame *pFrame)
         getIntegerParam(PSBadFrameCounter, &badFrameCounter);
         badFrameCounter++;
         setIntegerParam(PSBadFrameCounter, badFrameCounter);
+        psMetricsAdd(&this->metrics, PSMetricBadFrames, 1);
     }
-
+    goto frameDone;
+
+noMemory:
+    /* The pool has no memory for the converted or binned image.  The conversion is skipped, the
+     * frame keeps its buffer, which is still in Context[1], and is counted as bad. */
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+        "%s:%s: no memory for the processed image of frame %lu\n",
+        driverName, functionName, (unsigned long)pFrame->FrameCount);
+    if (perfRunning) this->perfPixels -= (double)pFrame->Width * pFrame->Height;
+    getIntegerParam(PSBadFrameCounter, &badFrameCounter);
+    badFrameCounter++;
+    setIntegerParam(PSBadFrameCounter, badFrameCounter);
+    psMetricsAdd(&this->metrics, PSMetricBadFrames, 1);
+
+frameDone:
     /* Update any changed parameters */
     callParamCallbacks();
     
     /* Queue this frame to run again */
-    PvCaptureQueueFrame(this->PvHandle, pFrame, frameCallbackC); 
+    requeueFrame(pFrame);
+    this->unlock();
+}
+
+/** Queues a PvAPI frame, first giving it a new image buffer if it has none because the pool
+  * was exhausted.  Returns ePvErrResources if there is still no buffer; called with the lock held. */
+tPvErr prosilica::queueFrame(tPvFrame *pFrame)
+{
+    NDArray *pImage;
+    size_t dims[2];
+
+    if (!pFrame->Context[1]) {
+        dims[0] = this->sensorWidth;
+        dims[1] = this->sensorHeight;
+        pImage = this->pNDArrayPool->alloc(2, dims, NDInt8, this->maxFrameSize, NULL);
+        if (!pImage) return ePvErrResources;
+        pFrame->Context[1] = pImage;
+        pFrame->ImageBuffer = pImage->pData;
+    }
+    return PvCaptureQueueFrame(this->PvHandle, pFrame, frameCallbackC);
+}
+
+/** Queues a frame to PvAPI again after it has been processed, or puts a synthetic frame back
+  * on the free list; called with the lock held.  A frame which can not be queued is parked
+  * until requeueParkedFrames, so that PvAPI never gets a frame without a buffer. */
+void prosilica::requeueFrame(tPvFrame *pFrame)
+{
+    tPvErr err;
+    static const char *functionName = "requeueFrame";
+
+    if (pFrame->Context[2]) {
+        this->synthFree[this->numSynthFree++] = pFrame;
+        return;
+    }
+    err = queueFrame(pFrame);
+    if (err == ePvErrSuccess) return;
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+        "%s:%s: unable to queue frame on camera %lu, error %d, the frame is parked\n",
+        driverName, functionName, this->uniqueId, err);
+    this->parkedFrames[this->numParkedFrames++] = pFrame;
+}
+
+/** Queues the parked frames again, and stops at the first one which still can not be queued;
+  * called with the lock held */
+void prosilica::requeueParkedFrames()
+{
+    tPvFrame *pFrame;
+
+    if (!this->PvHandle) return;
+    while (this->numParkedFrames > 0) {
+        pFrame = this->parkedFrames[this->numParkedFrames-1];
+        if (queueFrame(pFrame) != ePvErrSuccess) break;
+        this->numParkedFrames--;
+    }
+}
+
+/** Takes a synthetic frame off the free list and fills it in like a frame of width x height
+  * pixels in a pixel format from Mono8 to Rgb48.  The pixel values are whatever the buffer
+  * held, since the processing does not depend on them.  Returns NULL if all of the synthetic
+  * frames are being processed or there is no memory; called with the lock held. */
+tPvFrame *prosilica::getSynthFrame(int width, int height, int format)
+{
+    tPvFrame *pFrame;
+    NDArray *pImage;
+    size_t dims[2];
+    size_t imageSize;
+
+    if ((format < 0) || (format >= NUM_EST_PIXEL_FORMATS) || (width <= 0) || (height <= 0)) return NULL;
+    if (this->numSynthFree == 0) return NULL;
+    pFrame = this->synthFree[this->numSynthFree-1];
+    imageSize = (size_t)width * height * PSEstBytesPerPixel[format];
+    /* The frame callback gives the frame a new buffer of maxFrameSize, which can be too small */
+    pImage = (NDArray *)pFrame->Context[1];
+    if (pImage && (pImage->dataSize < imageSize)) {
+        pImage->release();
+        pImage = NULL;
+    }
+    if (!pImage) {
+        dims[0] = width;
+        dims[1] = height;
+        pImage = this->pNDArrayPool->alloc(2, dims, NDInt8, imageSize, NULL);
+        pFrame->Context[1] = pImage;
+        if (!pImage) return NULL;
+    }
+    this->numSynthFree--;
+    pFrame->Context[0] = this;
+    pFrame->Context[2] = this;
+    pFrame->ImageBuffer = pImage->pData;
+    pFrame->ImageBufferSize = (unsigned long)pImage->dataSize;
+    pFrame->ImageSize = (unsigned long)imageSize;
+    pFrame->Width = width;
+    pFrame->Height = height;
+    pFrame->RegionX = 0;
+    pFrame->RegionY = 0;
+    pFrame->Format = (tPvImageFormat)format;
+    pFrame->BitDepth = (PSEstBytesPerPixel[format] & 1) ? 8 : 16;
+    pFrame->BayerPattern = ePvBayerRGGB;
+    pFrame->FrameCount = ++this->synthFrameCount;
+    pFrame->TimestampHi = 0;
+    pFrame->TimestampLo = 0;
+    pFrame->Status = ePvErrSuccess;
+    return pFrame;
+}
+
+/** Releases the buffers of the synthetic frames, which must all be free; called with the lock held */
+void prosilica::freeSynthFrames()
+{
+    NDArray *pImage;
+    int i;
+
+    for (i=0; i<this->numSynthFree; i++) {
+        pImage = (NDArray *)this->synthFree[i]->Context[1];
+        if (pImage) pImage->release();
+        this->synthFree[i]->Context[1] = NULL;
+    }
+}
+
+/** Processes a synthetic frame in the frame callback, like a frame from PvAPI.  Returns 0, or -1
+  * if no synthetic frame was free.  Called without the lock held. */
+int prosilica::injectFrame(int width, int height, int format)
+{
+    tPvFrame *pFrame;
+
+    this->lock();
+    pFrame = getSynthFrame(width, height, format);
     this->unlock();
+    if (!pFrame) return -1;
+    frameCallbackC(pFrame);
+    return 0;
+}
+
+/** Writes the AcquisitionMode of the camera for an ADImageMode; called with the lock held */
+asynStatus prosilica::setImageMode(int imageMode)
+{
+    int status = asynSuccess;
+
+    switch(imageMode) {
+    case ADImageSingle:
+        status |= attrEnumSet("AcquisitionMode", "SingleFrame");
+        break;
+    case ADImageMultiple:
+        status |= attrEnumSet("AcquisitionMode", "MultiFrame");
+        break;
+    case ADImageContinuous:
+        status |= attrEnumSet("AcquisitionMode", "Continuous");
+        break;
+    }
+    return((asynStatus)status);
 }
 
 asynStatus prosilica::setPixelFormat()
@@ -861,7 +2709,7 @@ asynStatus prosilica::setPixelFormat()
             driverName, functionName, dataType, colorMode);
         return(asynError);
     }
-    status |= PvAttrEnumSet(this->PvHandle, "PixelFormat", pixelFormat);
+    status |= attrEnumSet("PixelFormat", pixelFormat);
     return((asynStatus)status);
 }      
 
@@ -894,16 +2742,16 @@ asynStatus prosilica::setGeometry()
     }
     
     /* CMOS cameras don't support binning, so ignore ePvErrNotFound errors */
-    s = PvAttrUint32Set(this->PvHandle, "BinningX", binX);
+    s = attrUint32Set("BinningX", binX);
     if (s != ePvErrNotFound) status |= s;
-    s = PvAttrUint32Set(this->PvHandle, "BinningY", binY);
+    s = attrUint32Set("BinningY", binY);
     if (s != ePvErrNotFound) status |= s;
 
     if(!status){
-      status |= PvAttrUint32Set(this->PvHandle, "RegionX", minX/binX);
-      status |= PvAttrUint32Set(this->PvHandle, "RegionY", minY/binY);
-      status |= PvAttrUint32Set(this->PvHandle, "Width",   sizeX/binX);
-      status |= PvAttrUint32Set(this->PvHandle, "Height",  sizeY/binY);
+      status |= attrUint32Set("RegionX", minX/binX);
+      status |= attrUint32Set("RegionY", minY/binY);
+      status |= attrUint32Set("Width",   sizeX/binX);
+      status |= attrUint32Set("Height",  sizeY/binY);
     }
     
     if (status) asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, 
@@ -920,16 +2768,16 @@ asynStatus prosilica::getGeometry()
     static const char *functionName = "getGeometry";
 
     /* CMOS cameras don't support binning, so ignore ePvErrNotFound errors */
-    s = PvAttrUint32Get(this->PvHandle, "BinningX", &binX);
+    s = attrUint32Get("BinningX", &binX);
     if (s) binX = 1;
     if (s != ePvErrNotFound) status |= s;
-    s = PvAttrUint32Get(this->PvHandle, "BinningY", &binY);
+    s = attrUint32Get("BinningY", &binY);
     if (s) binY = 1;
     if (s != ePvErrNotFound) status |= s;
-    status |= PvAttrUint32Get(this->PvHandle, "RegionX",  &minX);
-    status |= PvAttrUint32Get(this->PvHandle, "RegionY",  &minY);
-    status |= PvAttrUint32Get(this->PvHandle, "Width",    &sizeX);
-    status |= PvAttrUint32Get(this->PvHandle, "Height",   &sizeY);
+    status |= attrUint32Get("RegionX",  &minX);
+    status |= attrUint32Get("RegionY",  &minY);
+    status |= attrUint32Get("Width",    &sizeX);
+    status |= attrUint32Get("Height",   &sizeY);
     
     status |= setIntegerParam(ADBinX,  binX);
     status |= setIntegerParam(ADBinY,  binY);
@@ -954,50 +2802,67 @@ asynStatus prosilica::readStats()
     tPvUint32 uval;
     int i;
     float fval;
+    int exposureMode;
     static const char *functionName = "readStats";
     
-    status |= PvAttrEnumGet      (this->PvHandle, "StatDriverType", buffer, sizeof(buffer), &nchars);
+    status |= attrEnumGet      ("StatDriverType", buffer, sizeof(buffer), &nchars);
     if (status == ePvErrNotFound) {
         status = 0;
         strcpy(buffer, "Unsupported parameter");
     }
     status |= setStringParam (PSDriverType, buffer);    
-    status |= PvAttrStringGet    (this->PvHandle, "StatFilterVersion", buffer, sizeof(buffer), &nchars);
+    status |= attrStringGet    ("StatFilterVersion", buffer, sizeof(buffer), &nchars);
     if (status == ePvErrNotFound) {
         status = 0;
         strcpy(buffer, "Unsupported parameter");
     }
     status |= setStringParam (PSFilterVersion, buffer);
-    status |= PvAttrFloat32Get   (this->PvHandle, "StatFrameRate", &fval);
+    status |= attrFloat32Get   ("StatFrameRate", &fval);
     status |= setDoubleParam (PSFrameRate, fval);
-    status |= PvAttrUint32Get    (this->PvHandle, "StreamBytesPerSecond", &uval);
+    /* In the auto exposure modes the camera sets the exposure itself.  The frame callback takes
+     * the exposure time of the arrival estimate from ADAcquireTime, so keep it current. */
+    getIntegerParam(PSExposureMode, &exposureMode);
+    if ((strcmp(PSExposureModes[exposureMode], "Auto") == 0) ||
+        (strcmp(PSExposureModes[exposureMode], "AutoOnce") == 0)) {
+        status |= attrUint32Get("ExposureValue", &uval);
+        status |= setDoubleParam(ADAcquireTime, uval / 1.e6);
+    }
+    status |= attrUint32Get    ("StreamBytesPerSecond", &uval);
     status |= setIntegerParam(PSByteRate, (int)uval);
-    status |= PvAttrUint32Get    (this->PvHandle, "PacketSize", &uval);
+    status |= attrUint32Get    ("PacketSize", &uval);
     status |= setIntegerParam(PSPacketSize, (int)uval);
-    status |= PvAttrUint32Get    (this->PvHandle, "StatFramesCompleted", &uval);
+    status |= attrUint32Get    ("StatFramesCompleted", &uval);
     status |= setIntegerParam(PSFramesCompleted, (int)uval);
-    status |= PvAttrUint32Get    (this->PvHandle, "StatFramesDropped", &uval);
+    psMetricsSet(&this->metrics, PSMetricFramesCompleted, uval);
+    status |= attrUint32Get    ("StatFramesDropped", &uval);
     status |= setIntegerParam(PSFramesDropped, (int)uval);
-    status |= PvAttrUint32Get    (this->PvHandle, "StatPacketsErroneous", &uval);
+    psMetricsSet(&this->metrics, PSMetricFramesDropped, uval);
+    status |= attrUint32Get    ("StatPacketsErroneous", &uval);
     status |= setIntegerParam(PSPacketsErroneous, (int)uval);
-    status |= PvAttrUint32Get    (this->PvHandle, "StatPacketsMissed", &uval);
+    psMetricsSet(&this->metrics, PSMetricPacketsErroneous, uval);
+    status |= attrUint32Get    ("StatPacketsMissed", &uval);
     status |= setIntegerParam(PSPacketsMissed, (int)uval);
-    status |= PvAttrUint32Get    (this->PvHandle, "StatPacketsReceived", &uval);
+    psMetricsSet(&this->metrics, PSMetricPacketsMissed, uval);
+    status |= attrUint32Get    ("StatPacketsReceived", &uval);
     status |= setIntegerParam(PSPacketsReceived, (int)uval);
-    status |= PvAttrUint32Get    (this->PvHandle, "StatPacketsRequested", &uval);
+    psMetricsSet(&this->metrics, PSMetricPacketsReceived, uval);
+    status |= attrUint32Get    ("StatPacketsRequested", &uval);
     status |= setIntegerParam(PSPacketsRequested, (int)uval);
-    status |= PvAttrUint32Get    (this->PvHandle, "StatPacketsResent", &uval);
+    psMetricsSet(&this->metrics, PSMetricPacketsRequested, uval);
+    status |= attrUint32Get    ("StatPacketsResent", &uval);
     status |= setIntegerParam(PSPacketsResent, (int)uval);
-    status |= PvAttrUint32Get    (this->PvHandle, "SyncInLevels", &uval);
+    psMetricsSet(&this->metrics, PSMetricPacketsResent, uval);
+    status |= attrUint32Get    ("SyncInLevels", &uval);
     status |= setIntegerParam(PSSyncIn1Level, uval&0x01 ? 1:0);
     status |= setIntegerParam(PSSyncIn2Level, uval&0x02 ? 1:0);
-    status |= PvAttrUint32Get    (this->PvHandle, "SyncOutGpoLevels", &uval);
-    status |= setIntegerParam(PSSyncOut1Level, uval&0x01 ? 1:0);
-    status |= setIntegerParam(PSSyncOut2Level, uval&0x02 ? 1:0);
-    status |= setIntegerParam(PSSyncOut3Level, uval&0x04 ? 1:0);
-    status |= PvAttrUint32Get    (this->PvHandle, "FrameStartTriggerDelay", &uval);
+    epicsMutexMustLock(this->gpoMutex);
+    status |= attrUint32Get    ("SyncOutGpoLevels", &uval);
+    this->gpoLevels = uval;
+    epicsMutexUnlock(this->gpoMutex);
+    setGpoLevelParams(uval);
+    status |= attrUint32Get    ("FrameStartTriggerDelay", &uval);
     status |= setDoubleParam(PSTriggerDelay, uval/1.e6);
-    status |= PvAttrEnumGet(this->PvHandle, "FrameStartTriggerEvent", buffer, sizeof(buffer), &nchars);
+    status |= attrEnumGet("FrameStartTriggerEvent", buffer, sizeof(buffer), &nchars);
     for (i=0; i<NUM_TRIGGER_EVENT_MODES; i++) {
         if (strcmp(buffer, PSTriggerEventModes[i]) == 0) {
             status |= setIntegerParam(PSTriggerEvent, i);
@@ -1008,7 +2873,7 @@ asynStatus prosilica::readStats()
         status |= setIntegerParam(PSTriggerEvent, 0);
         status |= asynError;
     }    
-    status |= PvAttrEnumGet(this->PvHandle, "FrameStartTriggerOverlap", buffer, sizeof(buffer), &nchars);
+    status |= attrEnumGet("FrameStartTriggerOverlap", buffer, sizeof(buffer), &nchars);
     /* This parameter can be not supported */
     if (status == ePvErrNotFound) {
         status = 0;
@@ -1025,7 +2890,7 @@ asynStatus prosilica::readStats()
             status |= asynError;
         }
     }
-    status |= PvAttrEnumGet(this->PvHandle, "SyncOut1Mode", buffer, sizeof(buffer), &nchars);
+    status |= attrEnumGet("SyncOut1Mode", buffer, sizeof(buffer), &nchars);
     for (i=0; i<NUM_SYNC_OUT_MODES; i++) {
         if (strcmp(buffer, PSSyncOutModes[i]) == 0) {
             status |= setIntegerParam(PSSyncOut1Mode, i);
@@ -1036,7 +2901,7 @@ asynStatus prosilica::readStats()
         status |= setIntegerParam(PSSyncOut1Mode, 0);
         status |= asynError;
     }
-    status |= PvAttrEnumGet(this->PvHandle, "SyncOut2Mode", buffer, sizeof(buffer), &nchars);
+    status |= attrEnumGet("SyncOut2Mode", buffer, sizeof(buffer), &nchars);
     for (i=0; i<NUM_SYNC_OUT_MODES; i++) {
         if (strcmp(buffer, PSSyncOutModes[i]) == 0) {
             status |= setIntegerParam(PSSyncOut2Mode, i);
@@ -1047,7 +2912,7 @@ asynStatus prosilica::readStats()
         status |= setIntegerParam(PSSyncOut2Mode, 0);
         status |= asynError;
     }
-    status |= PvAttrEnumGet(this->PvHandle, "SyncOut3Mode", buffer, sizeof(buffer), &nchars);
+    status |= attrEnumGet("SyncOut3Mode", buffer, sizeof(buffer), &nchars);
     /* This parameter can be not supported */
     if (status == ePvErrNotFound) {
         status = 0;
@@ -1066,7 +2931,7 @@ asynStatus prosilica::readStats()
     }
     
     /* Device Temperature */
-    status |=  PvAttrFloat32Get(this->PvHandle, "DeviceTemperatureMainboard", &fval);
+    status |=  attrFloat32Get("DeviceTemperatureMainboard", &fval);
     /* This parameter can be not supported */
     if (status == ePvErrNotFound) {
         status = 0;
@@ -1074,7 +2939,7 @@ asynStatus prosilica::readStats()
     } else if (status == 0) {
         status |= setDoubleParam(PSTemperatureMainboard, fval);
     }
-    status |=  PvAttrFloat32Get(this->PvHandle, "DeviceTemperatureSensor", &fval);
+    status |=  attrFloat32Get("DeviceTemperatureSensor", &fval);
     /* This parameter can be not supported */
     if (status == ePvErrNotFound) {
         status = 0;
@@ -1083,7 +2948,7 @@ asynStatus prosilica::readStats()
         status |= setDoubleParam(ADTemperatureActual, fval);
     }
 
-    status |= PvAttrEnumGet(this->PvHandle, "SyncOut1Invert", buffer, sizeof(buffer), &nchars);
+    status |= attrEnumGet("SyncOut1Invert", buffer, sizeof(buffer), &nchars);
     if (strcmp(buffer, "Off") == 0) i = 0;
     else if (strcmp(buffer, "On") == 0) i = 1;
     else {
@@ -1091,7 +2956,7 @@ asynStatus prosilica::readStats()
         status |= asynError;
     }
     status |= setIntegerParam(PSSyncOut1Invert, i);
-    status |= PvAttrEnumGet(this->PvHandle, "SyncOut2Invert", buffer, sizeof(buffer), &nchars);
+    status |= attrEnumGet("SyncOut2Invert", buffer, sizeof(buffer), &nchars);
     if (strcmp(buffer, "Off") == 0) i = 0;
     else if (strcmp(buffer, "On") == 0) i = 1;
     else {
@@ -1099,7 +2964,7 @@ asynStatus prosilica::readStats()
         status |= asynError;
     }
     status |= setIntegerParam(PSSyncOut2Invert, i);
-    status |= PvAttrEnumGet(this->PvHandle, "SyncOut3Invert", buffer, sizeof(buffer), &nchars);
+    status |= attrEnumGet("SyncOut3Invert", buffer, sizeof(buffer), &nchars);
     if (status == ePvErrNotFound) {
         status = 0;
         i=0;
@@ -1113,7 +2978,7 @@ asynStatus prosilica::readStats()
     }
     status |= setIntegerParam(PSSyncOut3Invert, i);
 
-    status |= PvAttrEnumGet(this->PvHandle, "Strobe1Mode", buffer, sizeof(buffer), &nchars);
+    status |= attrEnumGet("Strobe1Mode", buffer, sizeof(buffer), &nchars);
     for (i=0; i<NUM_STROBE_MODES; i++) {
         if (strcmp(buffer, PSStrobeModes[i]) == 0) {
             status |= setIntegerParam(PSStrobe1Mode, i);
@@ -1124,7 +2989,7 @@ asynStatus prosilica::readStats()
         status |= setIntegerParam(PSStrobe1Mode, 0);
         status |= asynError;
     }
-    status |= PvAttrEnumGet(this->PvHandle, "Strobe1ControlledDuration", buffer, sizeof(buffer), &nchars);
+    status |= attrEnumGet("Strobe1ControlledDuration", buffer, sizeof(buffer), &nchars);
     if (strcmp(buffer, "Off") == 0) i = 0;
     else if (strcmp(buffer, "On") == 0) i = 1;
     else {
@@ -1133,148 +2998,874 @@ asynStatus prosilica::readStats()
     }
     status |= setIntegerParam(PSStrobe1CtlDuration, i);
 
-    status |= PvAttrUint32Get    (this->PvHandle, "Strobe1Delay", &uval);
+    status |= attrUint32Get    ("Strobe1Delay", &uval);
     status |= setDoubleParam(PSStrobe1Delay, uval/1.e6);
-    status |= PvAttrUint32Get    (this->PvHandle, "Strobe1Duration", &uval);
+    status |= attrUint32Get    ("Strobe1Duration", &uval);
     status |= setDoubleParam(PSStrobe1Duration, uval/1.e6);
 
+    status |= readPtpStatus();
+    readHostStats();
+    readThreadStats();
+    readPerfCounters();
+    publishAttrStats();
+
     if (status) asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, 
                       "%s:%s: error, status=%d\n", 
                       driverName, functionName, status);
     return(asynSuccess);
 }
 
-asynStatus prosilica::readParameters()
+/** Estimates the frame rate, bandwidth and frame callback CPU load of the candidate configuration
+  * in the PSEst parameters, without accessing the camera.  The frame period is the longest of the
+  * exposure time, the readout time and the transfer time at the candidate byte rate; the camera
+  * overlaps exposure with the readout of the previous frame.  The readout time per row is cached by
+  * readParameters, and the CPU cost per pixel is measured by the frame callback for each pixel format
+  * and Bayer conversion.  Called with the lock held. */
+void prosilica::computeEstimate()
 {
-    int status = asynSuccess;
-    tPvUint32 intVal;
-    int i;
-    int dataType=NDUInt8, colorMode=NDColorModeMono;
-    tPvFloat32 fltVal;
-    double dval;
-    unsigned long nchars;
-    char buffer[20];
-    static const char *functionName = "readParameters";
-
-    status |= PvAttrUint32Get(this->PvHandle, "TotalBytesPerFrame", &intVal);
-    setIntegerParam(NDArraySize, intVal);
-
-    status |= PvAttrEnumGet(this->PvHandle, "PixelFormat", buffer, sizeof(buffer), &nchars);
-    if      (!strcmp(buffer, "Mono8")) {
-        dataType = NDUInt8;
-        colorMode = NDColorModeMono;
-    }
-    else if (!strcmp(buffer, "Mono16")) {
-        dataType = NDUInt16;
-        colorMode = NDColorModeMono;
-    }
-    else if (!strcmp(buffer, "Rgb24")) {
-        dataType = NDUInt8;
-        colorMode = NDColorModeRGB1;
-    }
-    else if (!strcmp(buffer, "Rgb48")) {
-        dataType = NDUInt16;
-        colorMode = NDColorModeRGB1;
-    }
-    else if (!strcmp(buffer, "Bayer8")) {
-        dataType = NDUInt8;
-        colorMode = NDColorModeBayer;
+    int sizeX, sizeY, binX, binY, format, bayerConvert, byteRate, packetSize, limit;
+    double acquireTime, readoutTime, transferTime, period, frameRate, bytes, pixels, cost;
+    double packetsPerFrame;
+
+    getIntegerParam(PSEstSizeX, &sizeX);
+    getIntegerParam(PSEstSizeY, &sizeY);
+    getIntegerParam(PSEstBinX, &binX);
+    getIntegerParam(PSEstBinY, &binY);
+    getIntegerParam(PSEstPixelFormat, &format);
+    getIntegerParam(PSEstBayerConvert, &bayerConvert);
+    getIntegerParam(PSEstByteRate, &byteRate);
+    getDoubleParam(PSEstAcquireTime, &acquireTime);
+    getIntegerParam(PSPacketSize, &packetSize);
+    if (binX < 1) binX = 1;
+    if (binY < 1) binY = 1;
+    if ((format < 0) || (format >= NUM_EST_PIXEL_FORMATS)) format = ePvFmtMono8;
+    if ((bayerConvert < 0) || (bayerConvert >= NUM_BAYER_CONVERT_MODES)) bayerConvert = PSBayerConvertNone;
+    /* Only the Bayer formats are converted, and the RGB formats can be split into RGB2 or RGB3 */
+    if ((format == ePvFmtRgb24) || (format == ePvFmtRgb48)) {
+        if ((bayerConvert != PSBayerConvertRGB2) && (bayerConvert != PSBayerConvertRGB3)) bayerConvert = PSBayerConvertNone;
+    } else if ((format != ePvFmtBayer8) && (format != ePvFmtBayer16)) {
+        bayerConvert = PSBayerConvertNone;
     }
-    else if (!strcmp(buffer, "Bayer16")) { 
-        dataType = NDUInt16;
-        colorMode = NDColorModeBayer;
+    if (packetSize <= EST_PACKET_OVERHEAD) packetSize = 1500;
+
+    pixels = (double)(sizeX/binX) * (double)(sizeY/binY);
+    bytes = pixels * PSEstBytesPerPixel[format];
+    readoutTime = this->rowReadoutTime * (sizeY/binY);
+    transferTime = (byteRate > 0) ? bytes / byteRate : 0.;
+
+    period = acquireTime;
+    limit = PSEstLimitExposure;
+    if (readoutTime > period) {
+        period = readoutTime;
+        limit = PSEstLimitReadout;
     }
-    else {
-         /* We don't support other formats yet */
-        asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, 
-            "%s:%s: error unsupported data type %d and/or color mode %d\n", 
-            driverName, functionName, dataType, colorMode);
+    if (transferTime > period) {
+        period = transferTime;
+        limit = PSEstLimitBandwidth;
     }
-    status |= setIntegerParam(NDDataType, dataType);
-    status |= setIntegerParam(NDColorMode, colorMode);
-    
-    status |= getGeometry();
-
-    status |= PvAttrUint32Get(this->PvHandle, "AcquisitionFrameCount", &intVal);
-    status |= setIntegerParam(ADNumImages, intVal);
+    frameRate = (period > 0.) ? 1. / period : 0.;
+
+    packetsPerFrame = ceil(bytes / (packetSize - EST_PACKET_OVERHEAD)) + EST_PACKETS_PER_FRAME;
+    cost = this->processCost[format][bayerConvert];
+    if (cost == 0.) cost = (bayerConvert == PSBayerConvertNone) ? EST_DEFAULT_COST : EST_DEFAULT_BAYER_COST;
+
+    setDoubleParam(PSEstFrameRate, frameRate);
+    setDoubleParam(PSEstBytesPerSecond, frameRate * bytes);
+    setDoubleParam(PSEstPacketsPerSecond, frameRate * packetsPerFrame);
+    setDoubleParam(PSEstCpuLoad, frameRate * pixels * cost);
+    setDoubleParam(PSEstReadoutTime, readoutTime);
+    setIntegerParam(PSEstLimit, limit);
+}
 
-    status |= PvAttrEnumGet(this->PvHandle, "AcquisitionMode", buffer, sizeof(buffer), &nchars);
-    if      (!strcmp(buffer, "SingleFrame")) i = ADImageSingle;
-    else if (!strcmp(buffer, "MultiFrame"))  i = ADImageMultiple;
-    else if (!strcmp(buffer, "Recorder"))    i = ADImageMultiple;
-    else if (!strcmp(buffer, "Continuous"))  i = ADImageContinuous;
-    else {i=0; status |= asynError;}
-    status |= setIntegerParam(ADImageMode, i);
+/** Reads the host network counters and publishes how much they increased since the last call,
+  * so that losses counted by StatPacketsMissed can be placed in the NIC, the kernel or the sockets.
+  * The UDP counters are for the host or the IOC process, not only this camera. */
+void prosilica::readHostStats()
+{
+    psHostNetStats stats;
+
+    strcpy(stats.ifName, this->hostStats.ifName);
+    if (psHostReadNetStats(NULL, &stats)) return;
+    if (this->hostStatsValid) {
+        setIntegerParam(PSHostUdpDrops,        (int)(stats.udpDrops - this->hostStats.udpDrops));
+        setIntegerParam(PSHostUdpRcvbufErrors, (int)(stats.udpRcvbufErrors - this->hostStats.udpRcvbufErrors));
+        setIntegerParam(PSHostNicRxMissed,     (int)(stats.nicRxMissed - this->hostStats.nicRxMissed));
+        setIntegerParam(PSHostNicRxDropped,    (int)(stats.nicRxDropped - this->hostStats.nicRxDropped));
+        psMetricsAdd(&this->metrics, PSMetricHostUdpDrops,     (size_t)(stats.udpDrops - this->hostStats.udpDrops));
+        psMetricsAdd(&this->metrics, PSMetricHostNicRxMissed,  (size_t)(stats.nicRxMissed - this->hostStats.nicRxMissed));
+        psMetricsAdd(&this->metrics, PSMetricHostNicRxDropped, (size_t)(stats.nicRxDropped - this->hostStats.nicRxDropped));
+    }
+    setIntegerParam(PSHostRmemMax, (int)stats.rmemMax);
+    this->hostStats = stats;
+    this->hostStatsValid = 1;
+}
 
-    status |= PvAttrEnumGet(this->PvHandle, "FrameStartTriggerMode", buffer, sizeof(buffer), &nchars);
-    for (i=0; i<NUM_TRIGGER_START_MODES; i++) {
-        if (strcmp(buffer, PSTriggerStartModes[i]) == 0) {
-            status |= setIntegerParam(ADTriggerMode, i);
-            break;
+/** Samples /proc/self/task for the CPU use of the PvAPI frame callback thread, the asyn port thread and
+  * the busiest other thread of the IOC since the last sample. */
+void prosilica::readThreadStats()
+{
+    psHostThreadStats *pNew, *pOld, *pTemp;
+    epicsTimeStamp now;
+    double elapsed, cpu, busiestCpu = 0.;
+    const char *busiestName = "";
+    int numThreads, i, j;
+
+    /* The buffers are freed when the driver is deleted */
+    if (!this->newThreadStats) return;
+    epicsTimeGetCurrent(&now);
+    numThreads = psHostReadAllThreadStats(NULL, this->newThreadStats, MAX_THREAD_STATS);
+    if (numThreads < 0) return;
+    elapsed = epicsTimeDiffInSeconds(&now, &this->threadStatsTime);
+    if ((this->numThreadStats > 0) && (elapsed > 0.)) {
+        for (i=0; i<numThreads; i++) {
+            pNew = &this->newThreadStats[i];
+            for (j=0; j<this->numThreadStats; j++) {
+                if (this->threadStats[j].tid == pNew->tid) break;
+            }
+            if (j == this->numThreadStats) continue;
+            pOld = &this->threadStats[j];
+            cpu = 100. * (pNew->cpuTicks - pOld->cpuTicks) / psHostClockTicks() / elapsed;
+            if (pNew->tid == this->frameThreadId) {
+                setDoubleParam(PSThreadFrameCpu, cpu);
+                setIntegerParam(PSThreadFrameVoluntary, (int)(pNew->voluntarySwitches - pOld->voluntarySwitches));
+                setIntegerParam(PSThreadFrameInvoluntary, (int)(pNew->involuntarySwitches - pOld->involuntarySwitches));
+                setIntegerParam(PSThreadFrameLastCpu, pNew->lastCpu);
+                setIntegerParam(PSNumaFrameThreadNode, psNumaCpuNode(NULL, pNew->lastCpu));
+            } else if (pNew->tid == this->portThreadId) {
+                setDoubleParam(PSThreadPortCpu, cpu);
+                setIntegerParam(PSThreadPortVoluntary, (int)(pNew->voluntarySwitches - pOld->voluntarySwitches));
+                setIntegerParam(PSThreadPortInvoluntary, (int)(pNew->involuntarySwitches - pOld->involuntarySwitches));
+                setIntegerParam(PSThreadPortLastCpu, pNew->lastCpu);
+                setIntegerParam(PSNumaPortThreadNode, psNumaCpuNode(NULL, pNew->lastCpu));
+            } else if (cpu > busiestCpu) {
+                busiestCpu = cpu;
+                busiestName = pNew->name;
+            }
         }
+        setStringParam(PSThreadBusiestName, busiestName);
+        setDoubleParam(PSThreadBusiestCpu, busiestCpu);
     }
-    if (i == NUM_TRIGGER_START_MODES) {
-        status |= setIntegerParam(ADTriggerMode, 0);
-        status |= asynError;
+    pTemp = this->threadStats;
+    this->threadStats = this->newThreadStats;
+    this->newThreadStats = pTemp;
+    this->numThreadStats = numThreads;
+    this->threadStatsTime = now;
+}
+
+/** Opens the hardware counters in the frame callback thread when they are enabled, and reads them at the
+  * start of the first stage.  If perf_event_open is not permitted or not supported the reason is shown in
+  * PSPerfStatus and the frames are processed without the counters.  Returns 1 if the counters are running. */
+int prosilica::perfFrameStart(epicsUInt64 *pValues)
+{
+    char message[256];
+    char events[256];
+    int enable, numOpen, i;
+    static const char *functionName = "perfFrameStart";
+
+    getIntegerParam(PSPerfEnable, &enable);
+    if (!enable || this->perfFailed) return 0;
+    /* The counters count only the thread which opened them */
+    if ((this->perfCounters.numOpen == 0) || (this->perfCounters.tid != this->frameThreadId)) {
+        numOpen = psPerfOpen(&this->perfCounters, message, sizeof(message));
+        if (numOpen < 0) {
+            this->perfFailed = 1;
+            epicsSnprintf(events, sizeof(events), "Unavailable: %s", message);
+            setStringParam(PSPerfStatus, events);
+            asynPrint(this->pasynUserSelf, ASYN_TRACE_WARNING,
+                "%s:%s: hardware counters %s\n", driverName, functionName, events);
+            return 0;
+        }
+        /* Show the events which this CPU does not count */
+        strcpy(events, "Counting");
+        for (i=0; i<PSPerfNumEvents; i++) {
+            if (this->perfCounters.fd[i] >= 0) continue;
+            epicsSnprintf(message, sizeof(message), "%s, no %s", events, psPerfEventName(i));
+            strcpy(events, message);
+        }
+        setStringParam(PSPerfStatus, events);
     }
-    
-    /* Prosilica does not support more than 1 exposure per frame */
-    status |= setIntegerParam(ADNumExposures, 1);
+    if (psPerfRead(&this->perfCounters, pValues)) return 0;
+    return 1;
+}
 
-    /* Prosilica uses integer microseconds */
-    status |= PvAttrUint32Get(this->PvHandle, "ExposureValue", &intVal);
-    dval = intVal / 1.e6;
-    status |= setDoubleParam(ADAcquireTime, dval);
+/** Adds the counts since pValues to a stage, and leaves the current counts in pValues for the next stage */
+void prosilica::perfStageEnd(int stage, epicsUInt64 *pValues)
+{
+    epicsUInt64 now[PSPerfNumEvents];
+    int i;
 
-    /* Prosilica uses a frame rate in Hz */
-    status |= PvAttrFloat32Get(this->PvHandle, "FrameRate", &fltVal);
-    if (fltVal == 0.) fltVal = 1;
-    dval = 1. / fltVal;
-    status |= setDoubleParam(ADAcquirePeriod, dval);
+    if (psPerfRead(&this->perfCounters, now)) return;
+    for (i=0; i<PSPerfNumEvents; i++) {
+        this->perfSums[stage][i] += now[i] - pValues[i];
+        pValues[i] = now[i];
+    }
+}
 
-    /* Prosilica uses an integer value */
-    status |= PvAttrUint32Get(this->PvHandle, "GainValue", &intVal);
-    dval = intVal;
-    status |= setDoubleParam(ADGain, dval);
+/** Publishes the instructions per cycle and the cycles and misses per pixel of each stage of the frames
+  * since the last call */
+void prosilica::readPerfCounters()
+{
+    static const int ipcParams[NUM_PERF_STAGES][4] = {
+        {PSPerfConvertIpc,    PSPerfConvertCycles,    PSPerfConvertLlc,    PSPerfConvertDtlb},
+        {PSPerfAttributesIpc, PSPerfAttributesCycles, PSPerfAttributesLlc, PSPerfAttributesDtlb},
+        {PSPerfCallbacksIpc,  PSPerfCallbacksCycles,  PSPerfCallbacksLlc,  PSPerfCallbacksDtlb}
+    };
+    epicsUInt64 *pSums;
+    int stage;
+
+    if (this->perfPixels == 0.) return;
+    for (stage=0; stage<NUM_PERF_STAGES; stage++) {
+        pSums = this->perfSums[stage];
+        setDoubleParam(ipcParams[stage][0], pSums[PSPerfCycles] ?
+                       (double)pSums[PSPerfInstructions] / pSums[PSPerfCycles] : 0.);
+        setDoubleParam(ipcParams[stage][1], pSums[PSPerfCycles] / this->perfPixels);
+        setDoubleParam(ipcParams[stage][2], pSums[PSPerfLLCMisses] / this->perfPixels);
+        setDoubleParam(ipcParams[stage][3], pSums[PSPerfDTLBMisses] / this->perfPixels);
+    }
+    memset(this->perfSums, 0, sizeof(this->perfSums));
+    this->perfPixels = 0.;
+}
 
-    /* Exposure mode can be maunal or auto */
-    status |= PvAttrEnumGet(this->PvHandle, "ExposureMode", buffer, sizeof(buffer), &nchars);
-    for (i=0; i<NUM_EXPOSURE_MODES; i++) {
-        if (strcmp(buffer, PSExposureModes[i]) == 0) {
-            status |= setIntegerParam(PSExposureMode, i);
-            break;
+/** Publishes the enabled regions of a frame on addresses 1 to NUM_REGIONS.  NDArrays have no strides,
+  * so a region is published without a copy when it is contiguous in the frame, i.e. whole rows or part
+  * of a single row.  The region array then points into the frame, which stays reserved until the last
+  * user releases the region.  Other regions are copied row by row.  Mono, Bayer and RGB1 images are
+  * supported. */
+void prosilica::doRegionCallbacks(NDArray *pImage)
+{
+    NDArrayInfo_t info;
+    NDArray *pRegion;
+    size_t dims[3];
+    size_t pixelBytes, rowBytes, offset;
+    int ndims, addr, enable, minX, minY, sizeX, sizeY, zeroCopy, y;
+
+    pImage->getInfo(&info);
+    if ((info.colorMode != NDColorModeMono) && (info.colorMode != NDColorModeBayer) &&
+        (info.colorMode != NDColorModeRGB1)) return;
+    pixelBytes = info.bytesPerElement * ((info.colorMode == NDColorModeRGB1) ? 3 : 1);
+    rowBytes = info.xSize * pixelBytes;
+
+    for (addr=1; addr<=NUM_REGIONS; addr++) {
+        getIntegerParam(addr, PSRegionEnable, &enable);
+        if (!enable) continue;
+        getIntegerParam(addr, PSRegionMinX, &minX);
+        getIntegerParam(addr, PSRegionMinY, &minY);
+        getIntegerParam(addr, PSRegionSizeX, &sizeX);
+        getIntegerParam(addr, PSRegionSizeY, &sizeY);
+        /* Clip the region to the image */
+        if (minX < 0) minX = 0;
+        if (minY < 0) minY = 0;
+        if (sizeX > (int)info.xSize - minX) sizeX = (int)info.xSize - minX;
+        if (sizeY > (int)info.ySize - minY) sizeY = (int)info.ySize - minY;
+        if ((sizeX <= 0) || (sizeY <= 0)) continue;
+
+        ndims = 0;
+        if (info.colorMode == NDColorModeRGB1) dims[ndims++] = 3;
+        dims[ndims++] = sizeX;
+        dims[ndims++] = sizeY;
+        offset = minY * rowBytes + minX * pixelBytes;
+        zeroCopy = (sizeX == (int)info.xSize) || (sizeY == 1);
+        if (zeroCopy) {
+            pRegion = this->pViewPool->allocView(pImage, ndims, dims, offset, sizeY * sizeX * pixelBytes);
+        } else {
+            pRegion = this->pNDArrayPool->alloc(ndims, dims, pImage->dataType, 0, NULL);
+            if (pRegion) {
+                for (y=0; y<sizeY; y++) {
+                    memcpy((char *)pRegion->pData + y * sizeX * pixelBytes,
+                           (char *)pImage->pData + offset + y * rowBytes, sizeX * pixelBytes);
+                }
+            }
+        }
+        if (!pRegion) {
+            asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+                "%s:%s: cannot allocate region %d\n", driverName, "doRegionCallbacks", addr);
+            continue;
         }
+        pRegion->uniqueId = pImage->uniqueId;
+        pRegion->timeStamp = pImage->timeStamp;
+        pRegion->epicsTS = pImage->epicsTS;
+        pImage->pAttributeList->copy(pRegion->pAttributeList);
+        pRegion->dims[info.xDim].offset  = pImage->dims[info.xDim].offset + minX * pImage->dims[info.xDim].binning;
+        pRegion->dims[info.xDim].binning = pImage->dims[info.xDim].binning;
+        pRegion->dims[info.yDim].offset  = pImage->dims[info.yDim].offset + minY * pImage->dims[info.yDim].binning;
+        pRegion->dims[info.yDim].binning = pImage->dims[info.yDim].binning;
+
+        setIntegerParam(addr, PSRegionZeroCopy, zeroCopy);
+        publishRegion(addr, pRegion);
     }
-    if (i == NUM_EXPOSURE_MODES) {
-        status |= setIntegerParam(PSExposureMode, 0);
-        status |= asynError;
+}
+
+/** Calls the plugins of a region address with pArray, and keeps it as the last array of that
+  * address, like the frame on address 0.  The driver takes over the reference of the caller. */
+void prosilica::publishRegion(int addr, NDArray *pArray)
+{
+    int counter;
+
+    doCallbacksGenericPointer(pArray, NDArrayData, addr);
+    if (this->pArrays[addr]) this->pArrays[addr]->release();
+    this->pArrays[addr] = pArray;
+    getIntegerParam(addr, NDArrayCounter, &counter);
+    setIntegerParam(addr, NDArrayCounter, counter+1);
+    callParamCallbacks(addr);
+}
+
+/** Places the NDArray memory and the driver threads on the node of the host interface when
+  * NumaEnable is on, and releases the threads again when it is turned off; called with the lock
+  * held.  The driver threads are the PvAPI frame callback thread and the asyn port thread, which
+  * are only known once they have run.  The plugin threads are not moved, but the arrays they
+  * allocate from the driver pool are placed on the node. */
+void prosilica::applyNumaPlacement()
+{
+    int enable, node, status = 0;
+    char message[256];
+
+    getIntegerParam(PSNumaEnable, &enable);
+    node = enable ? this->numaNode : -1;
+    this->pNumaPool->node = node;
+    if ((node >= 0) || this->numaBound) {
+        if (this->frameThreadId > 0) status |= psNumaBindThread(NULL, this->frameThreadId, node);
+        if (this->portThreadId > 0) status |= psNumaBindThread(NULL, this->portThreadId, node);
+        this->numaBound = (node >= 0);
     }
-    
-    /* Gain mode can be maunal or auto */
-    status |= PvAttrEnumGet(this->PvHandle, "GainMode", buffer, sizeof(buffer), &nchars);
-    for (i=0; i<NUM_GAIN_MODES; i++) {
-        if (strcmp(buffer, PSGainModes[i]) == 0) {
-            status |= setIntegerParam(PSGainMode, i);
-            break;
+    if (!enable) epicsSnprintf(message, sizeof(message), "Off");
+    else if (this->numaNode < 0) epicsSnprintf(message, sizeof(message), "No node for interface %s", this->hostStats.ifName);
+    else if (status) epicsSnprintf(message, sizeof(message), "Node %d, cannot bind threads", node);
+    else epicsSnprintf(message, sizeof(message), "Node %d", node);
+    setStringParam(PSNumaStatus, message);
+}
+
+/** Starts the ROI sequence if it is enabled; called with the lock held when acquisition starts.
+  * The camera has a single window, so the sequence moves it through the enabled regions, one
+  * frame each.  All of the windows have the size ADSizeX x ADSizeY and are placed at RegionMinX
+  * and RegionMinY of their regions, so only RegionX and RegionY change, which the camera accepts
+  * while it is acquiring without a change of the frame size. */
+void prosilica::startRoiSequence()
+{
+    int enable, regionEnable, minX, minY, sizeX, sizeY, binX, binY, maxSizeX, maxSizeY;
+    int addr, count, status;
+    char message[256];
+
+    epicsMutexMustLock(this->roiSeqMutex);
+    this->roiSeqCount = 0;
+    epicsMutexUnlock(this->roiSeqMutex);
+    getIntegerParam(PSRoiSeqEnable, &enable);
+    if (!enable) {
+        setStringParam(PSRoiSeqStatus, "Off");
+        return;
+    }
+    getIntegerParam(ADBinX, &binX);
+    if (binX < 1) binX = 1;
+    getIntegerParam(ADBinY, &binY);
+    if (binY < 1) binY = 1;
+    getIntegerParam(ADSizeX, &sizeX);
+    getIntegerParam(ADSizeY, &sizeY);
+    getIntegerParam(ADMaxSizeX, &maxSizeX);
+    getIntegerParam(ADMaxSizeY, &maxSizeY);
+    /* roiSeqTask is idle while roiSeqCount is 0, so the windows can be filled in without the mutex */
+    count = 0;
+    for (addr=1; addr<=NUM_REGIONS; addr++) {
+        getIntegerParam(addr, PSRegionEnable, &regionEnable);
+        if (!regionEnable) continue;
+        getIntegerParam(addr, PSRegionMinX, &minX);
+        getIntegerParam(addr, PSRegionMinY, &minY);
+        if ((minX + sizeX > maxSizeX) || (minY + sizeY > maxSizeY)) {
+            epicsSnprintf(message, sizeof(message), "Region %d is outside the sensor", addr);
+            setStringParam(PSRoiSeqStatus, message);
+            return;
         }
+        this->roiSeqX[count] = minX/binX;
+        this->roiSeqY[count] = minY/binY;
+        this->roiSeqAddr[count] = addr;
+        count++;
     }
-    if (i == NUM_GAIN_MODES) {
-        status |= setIntegerParam(PSGainMode, 0);
-        status |= asynError;
+    if (count == 0) {
+        setStringParam(PSRoiSeqStatus, "No regions enabled");
+        return;
+    }
+    getIntegerParam(ADMinX, &this->roiSeqHomeX);
+    getIntegerParam(ADMinY, &this->roiSeqHomeY);
+    this->roiSeqActive = 1;
+    status  = attrUint32Set("RegionX", this->roiSeqX[0]);
+    status |= attrUint32Set("RegionY", this->roiSeqY[0]);
+    if (status) {
+        epicsSnprintf(message, sizeof(message), "Camera error %d setting the window", status);
+        setStringParam(PSRoiSeqStatus, message);
+        return;
     }
+    epicsMutexMustLock(this->roiSeqMutex);
+    this->roiSeqHandle = this->PvHandle;
+    this->roiSeqError = 0;
+    this->roiSeqNext = 1 % count;
+    this->roiSeqCount = count;
+    epicsMutexUnlock(this->roiSeqMutex);
+    setIntegerParam(PSRoiSeqUnmatched, 0);
+    epicsSnprintf(message, sizeof(message), "Running %d regions", count);
+    setStringParam(PSRoiSeqStatus, message);
+}
 
-    /* Call the callbacks to update the values in higher layers */
-    callParamCallbacks();
-    
-    if (status) asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, 
-                      "%s:%s: error, status=%d\n", 
-                      driverName, functionName, status);
-    return((asynStatus)status);
+/** Stops the ROI sequence and puts the camera window back to ADMinX and ADMinY; called with
+  * the lock held when acquisition stops.  A window move in progress finishes first. */
+void prosilica::stopRoiSequence()
+{
+    int enable;
+
+    epicsMutexMustLock(this->roiSeqMutex);
+    this->roiSeqCount = 0;
+    epicsMutexUnlock(this->roiSeqMutex);
+    if (!this->roiSeqActive) return;
+    this->roiSeqActive = 0;
+    /* The camera readback of RegionX and RegionY followed the sequence */
+    setIntegerParam(ADMinX, this->roiSeqHomeX);
+    setIntegerParam(ADMinY, this->roiSeqHomeY);
+    setGeometry();
+    getIntegerParam(PSRoiSeqEnable, &enable);
+    setStringParam(PSRoiSeqStatus, enable ? "Idle" : "Off");
 }
 
-asynStatus prosilica::disconnectCamera()
+/** Asks roiSeqTask for the next window of the ROI sequence and returns the region address of a
+  * frame, or 0 if the sequence is not running or the frame matches no window; called with the
+  * lock held.  A window change only applies to the exposures which start after it, so with
+  * several PvAPI frames queued a window can be used for more than one frame.  The frames are
+  * therefore routed by their own RegionX and RegionY rather than by their position in the sequence.
+  * The windows only change while the lock is held, so they can be read here without roiSeqMutex. */
+int prosilica::routeRoiSequence(tPvFrame *pFrame)
 {
-    int status = asynSuccess;
+    int unmatched, i;
+
+    if (this->roiSeqCount == 0) return 0;
+    epicsEventSignal(this->roiSeqEvent);
+    for (i=0; i<this->roiSeqCount; i++) {
+        if (((int)pFrame->RegionX == this->roiSeqX[i]) && ((int)pFrame->RegionY == this->roiSeqY[i]))
+            return this->roiSeqAddr[i];
+    }
+    getIntegerParam(PSRoiSeqUnmatched, &unmatched);
+    setIntegerParam(PSRoiSeqUnmatched, unmatched+1);
+    return 0;
+}
+
+/** Moves the camera window to the next window of the ROI sequence each time a frame arrives.
+  * The two attribute writes are a GigE round trip each, so they are made here rather than in
+  * the frame callback, and without the port lock. */
+void prosilica::roiSeqTask()
+{
+    tPvUint32 x, y;
+    tPvErr err;
+    epicsUInt64 start;
+    int i, error;
+    char message[256];
+
+    while (1) {
+        epicsEventWait(this->roiSeqEvent);
+        /* The mutex is held across the writes, so stopRoiSequence waits for them */
+        epicsMutexMustLock(this->roiSeqMutex);
+        if ((this->roiSeqCount == 0) || this->roiSeqError) {
+            epicsMutexUnlock(this->roiSeqMutex);
+            continue;
+        }
+        i = this->roiSeqNext;
+        x = this->roiSeqX[i];
+        y = this->roiSeqY[i];
+        this->roiSeqNext = (i + 1) % this->roiSeqCount;
+        start = epicsMonotonicGet();
+        err = PvAttrUint32Set(this->roiSeqHandle, "RegionX", x);
+        countAttr(PSAttrSet, "RegionX", start, err);
+        if (err == ePvErrSuccess) {
+            start = epicsMonotonicGet();
+            err = PvAttrUint32Set(this->roiSeqHandle, "RegionY", y);
+            countAttr(PSAttrSet, "RegionY", start, err);
+        }
+        this->roiSeqError = err;
+        epicsMutexUnlock(this->roiSeqMutex);
+        if (err == ePvErrSuccess) continue;
+
+        /* Stop the sequence, unless it was stopped meanwhile.  The window is restored when
+         * acquisition stops. */
+        this->lock();
+        epicsMutexMustLock(this->roiSeqMutex);
+        error = this->roiSeqCount ? this->roiSeqError : 0;
+        this->roiSeqCount = 0;
+        epicsMutexUnlock(this->roiSeqMutex);
+        if (error) {
+            epicsSnprintf(message, sizeof(message), "Camera error %d moving the window", error);
+            setStringParam(PSRoiSeqStatus, message);
+            callParamCallbacks();
+        }
+        this->unlock();
+    }
+}
+
+/** Prints the CPU use of every thread of the IOC since the last readThreadStats */
+void prosilica::reportThreads(FILE *fp)
+{
+    psHostThreadStats *pThreads;
+    psHostThreadStats *pNew, *pOld;
+    epicsTimeStamp now;
+    double elapsed, cpu;
+    const char *role;
+    int numThreads, i, j;
+
+    pThreads = (psHostThreadStats *)calloc(MAX_THREAD_STATS, sizeof(psHostThreadStats));
+    epicsTimeGetCurrent(&now);
+    numThreads = psHostReadAllThreadStats(NULL, pThreads, MAX_THREAD_STATS);
+    if (numThreads < 0) {
+        free(pThreads);
+        return;
+    }
+    elapsed = epicsTimeDiffInSeconds(&now, &this->threadStatsTime);
+    fprintf(fp, "Threads of the IOC, CPU %% since ReadStatistics was last processed:\n");
+    fprintf(fp, "  %7s %-15s %-6s %7s %10s %10s %10s %4s\n",
+            "TID", "Name", "Role", "CPU %", "CPU s", "Voluntary", "Involunt.", "CPU");
+    for (i=0; i<numThreads; i++) {
+        pNew = &pThreads[i];
+        pOld = 0;
+        for (j=0; j<this->numThreadStats; j++) {
+            if (this->threadStats[j].tid == pNew->tid) pOld = &this->threadStats[j];
+        }
+        cpu = (pOld && (elapsed > 0.)) ? 100. * (pNew->cpuTicks - pOld->cpuTicks) / psHostClockTicks() / elapsed : 0.;
+        if (pNew->tid == this->frameThreadId) role = "frame";
+        else if (pNew->tid == this->portThreadId) role = "port";
+        else role = "";
+        fprintf(fp, "  %7d %-15s %-6s %7.1f %10.2f %10llu %10llu %4d\n",
+                pNew->tid, pNew->name, role, cpu, (double)pNew->cpuTicks / psHostClockTicks(),
+                (unsigned long long)pNew->voluntarySwitches,
+                (unsigned long long)pNew->involuntarySwitches, pNew->lastCpu);
+    }
+    fprintf(fp, "\n");
+    free(pThreads);
+}
+
+/** Counts an attribute call which started at the epicsMonotonicGet() time start in attrStats.
+  * Calls made while the camera is not open only report ePvErrBadHandle, so they are not counted. */
+void prosilica::countAttr(PSAttrOp_t op, const char *name, epicsUInt64 start, tPvErr err)
+{
+    if (!this->PvHandle) return;
+    psAttrStatsAdd(&this->attrStats, op, name, (epicsMonotonicGet() - start) * 1e-9, err != ePvErrSuccess);
+}
+
+/* The attribute functions of PvAPI on the open camera, timed by countAttr.
+ * Each call is a round trip on the GigE control channel. */
+tPvErr prosilica::attrUint32Get(const char *name, tPvUint32 *pValue)
+{
+    epicsUInt64 start = epicsMonotonicGet();
+    tPvErr err = PvAttrUint32Get(this->PvHandle, name, pValue);
+
+    countAttr(PSAttrGet, name, start, err);
+    return err;
+}
+
+tPvErr prosilica::attrUint32Set(const char *name, tPvUint32 value)
+{
+    epicsUInt64 start = epicsMonotonicGet();
+    tPvErr err = PvAttrUint32Set(this->PvHandle, name, value);
+
+    countAttr(PSAttrSet, name, start, err);
+    return err;
+}
+
+tPvErr prosilica::attrFloat32Get(const char *name, tPvFloat32 *pValue)
+{
+    epicsUInt64 start = epicsMonotonicGet();
+    tPvErr err = PvAttrFloat32Get(this->PvHandle, name, pValue);
+
+    countAttr(PSAttrGet, name, start, err);
+    return err;
+}
+
+tPvErr prosilica::attrFloat32Set(const char *name, tPvFloat32 value)
+{
+    epicsUInt64 start = epicsMonotonicGet();
+    tPvErr err = PvAttrFloat32Set(this->PvHandle, name, value);
+
+    countAttr(PSAttrSet, name, start, err);
+    return err;
+}
+
+tPvErr prosilica::attrRangeFloat32(const char *name, tPvFloat32 *pMin, tPvFloat32 *pMax)
+{
+    epicsUInt64 start = epicsMonotonicGet();
+    tPvErr err = PvAttrRangeFloat32(this->PvHandle, name, pMin, pMax);
+
+    countAttr(PSAttrGet, name, start, err);
+    return err;
+}
+
+tPvErr prosilica::attrEnumGet(const char *name, char *buffer, unsigned long size, unsigned long *pSize)
+{
+    epicsUInt64 start = epicsMonotonicGet();
+    tPvErr err = PvAttrEnumGet(this->PvHandle, name, buffer, size, pSize);
+
+    countAttr(PSAttrGet, name, start, err);
+    return err;
+}
+
+tPvErr prosilica::attrEnumSet(const char *name, const char *value)
+{
+    epicsUInt64 start = epicsMonotonicGet();
+    tPvErr err = PvAttrEnumSet(this->PvHandle, name, value);
+
+    countAttr(PSAttrSet, name, start, err);
+    return err;
+}
+
+tPvErr prosilica::attrStringGet(const char *name, char *buffer, unsigned long size, unsigned long *pSize)
+{
+    epicsUInt64 start = epicsMonotonicGet();
+    tPvErr err = PvAttrStringGet(this->PvHandle, name, buffer, size, pSize);
+
+    countAttr(PSAttrGet, name, start, err);
+    return err;
+}
+
+tPvErr prosilica::commandRun(const char *name)
+{
+    epicsUInt64 start = epicsMonotonicGet();
+    tPvErr err = PvCommandRun(this->PvHandle, name);
+
+    countAttr(PSAttrCommand, name, start, err);
+    return err;
+}
+
+/** Publishes the attribute call totals, and the NUM_ATTR_SLOWEST slowest attributes in the
+  * order of PSAttrSort.  Called with the lock held. */
+void prosilica::publishAttrStats()
+{
+    psAttrEntry slowest[NUM_ATTR_SLOWEST];
+    char table[NUM_ATTR_SLOWEST*128];
+    epicsUInt32 calls, errors;
+    double totalTime;
+    int sort, n, i, len=0;
+
+    getIntegerParam(PSAttrSort, &sort);
+    n = psAttrStatsSorted(&this->attrStats, (PSAttrSort_t)sort, slowest, NUM_ATTR_SLOWEST);
+    table[0] = 0;
+    for (i=0; i<n; i++) {
+        this->attrSlowMean[i] = slowest[i].calls ? 1e3 * slowest[i].totalTime / slowest[i].calls : 0.;
+        this->attrSlowMax[i] = 1e3 * slowest[i].maxTime;
+        if (len < (int)sizeof(table)) {
+            len += epicsSnprintf(table + len, sizeof(table) - len,
+                                 "%-28s %-7s mean %7.2f ms max %7.2f ms calls %u errors %u\n",
+                                 slowest[i].name, psAttrOpName(slowest[i].op), this->attrSlowMean[i],
+                                 this->attrSlowMax[i], slowest[i].calls, slowest[i].errors);
+        }
+    }
+    this->numAttrSlow = n;
+    psAttrStatsTotals(&this->attrStats, &calls, &errors, &totalTime);
+    setIntegerParam(PSAttrCalls, (int)calls);
+    setIntegerParam(PSAttrErrors, (int)errors);
+    setDoubleParam(PSAttrTime, totalTime);
+    setStringParam(PSAttrSlowest, table);
+    doCallbacksFloat64Array(this->attrSlowMean, n, PSAttrSlowMean, 0);
+    doCallbacksFloat64Array(this->attrSlowMax, n, PSAttrSlowMax, 0);
+}
+
+/** Reads the IEEE 1588 state of the camera, and measures the offset of the camera clock
+  * from the IOC clock when the camera PTP clock is enabled.
+  * Cameras without PTP support report Off. */
+asynStatus prosilica::readPtpStatus()
+{
+    int status = asynSuccess;
+    char buffer[20];
+    unsigned long nchars;
+    tPvUint32 hi, lo;
+    epicsTimeStamp before, after, cameraTime;
+    int i, ptpMode=0, ptpStatus=0;
+    static const char *functionName = "readPtpStatus";
+
+    if (attrEnumGet("PtpMode", buffer, sizeof(buffer), &nchars) == ePvErrSuccess) {
+        for (i=0; i<NUM_PTP_MODES; i++) {
+            if (strcmp(buffer, PSPtpModes[i]) == 0) {
+                ptpMode = i;
+                break;
+            }
+        }
+        status |= attrEnumGet("PtpStatus", buffer, sizeof(buffer), &nchars);
+        for (i=0; i<NUM_PTP_STATUSES-1; i++) {
+            if (strcmp(buffer, PSPtpStatuses[i]) == 0) break;
+        }
+        ptpStatus = i;
+    }
+    setIntegerParam(PSPtpMode, ptpMode);
+    setIntegerParam(PSPtpStatus, ptpStatus);
+    setIntegerParam(PSPtpLocked, (strcmp(PSPtpStatuses[ptpStatus], "Slave") == 0) ||
+                                 (strcmp(PSPtpStatuses[ptpStatus], "Master") == 0));
+
+    if (ptpMode != 0) {
+        /* The timestamp frequency can change when PTP is enabled */
+        status |= attrUint32Get("TimeStampFrequency", &this->timeStampFrequency);
+        /* Latch the camera clock and compare it with the middle of the latch round trip */
+        epicsTimeGetCurrent(&before);
+        status |= commandRun("TimeStampValueLatch");
+        epicsTimeGetCurrent(&after);
+        status |= attrUint32Get("TimeStampValueHi", &hi);
+        status |= attrUint32Get("TimeStampValueLo", &lo);
+        if (!status) {
+            if (psPtpTicksToEpicsTime(((epicsUInt64)hi << 32) | (epicsUInt32)lo, this->timeStampFrequency,
+                                      &cameraTime) == 0)
+                setDoubleParam(PSPtpOffset, epicsTimeDiffInSeconds(&cameraTime, &before) - 
+                                            epicsTimeDiffInSeconds(&after, &before)/2.);
+            else
+                /* The clock has not been set by a PTP master yet, so it has no offset to show */
+                setDoubleParam(PSPtpOffset, 0.);
+        }
+    } else {
+        setDoubleParam(PSPtpOffset, 0.);
+    }
+    if (status) asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, 
+                      "%s:%s: error, status=%d\n", 
+                      driverName, functionName, status);
+    return((asynStatus)status);
+}
+
+asynStatus prosilica::readParameters()
+{
+    int status = asynSuccess;
+    tPvUint32 intVal;
+    int i;
+    int dataType=NDUInt8, colorMode=NDColorModeMono;
+    tPvFloat32 fltVal;
+    double dval;
+    unsigned long nchars;
+    char buffer[20];
+    static const char *functionName = "readParameters";
+
+    status |= attrUint32Get("TotalBytesPerFrame", &intVal);
+    setIntegerParam(NDArraySize, intVal);
+    this->payloadSize = intVal;
+
+    status |= attrEnumGet("PixelFormat", buffer, sizeof(buffer), &nchars);
+    if      (!strcmp(buffer, "Mono8")) {
+        dataType = NDUInt8;
+        colorMode = NDColorModeMono;
+    }
+    else if (!strcmp(buffer, "Mono16")) {
+        dataType = NDUInt16;
+        colorMode = NDColorModeMono;
+    }
+    else if (!strcmp(buffer, "Rgb24")) {
+        dataType = NDUInt8;
+        colorMode = NDColorModeRGB1;
+    }
+    else if (!strcmp(buffer, "Rgb48")) {
+        dataType = NDUInt16;
+        colorMode = NDColorModeRGB1;
+    }
+    else if (!strcmp(buffer, "Bayer8")) {
+        dataType = NDUInt8;
+        colorMode = NDColorModeBayer;
+    }
+    else if (!strcmp(buffer, "Bayer16")) { 
+        dataType = NDUInt16;
+        colorMode = NDColorModeBayer;
+    }
+    else {
+         /* We don't support other formats yet */
+        asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, 
+            "%s:%s: error unsupported data type %d and/or color mode %d\n", 
+            driverName, functionName, dataType, colorMode);
+    }
+    status |= setIntegerParam(NDDataType, dataType);
+    status |= setIntegerParam(NDColorMode, colorMode);
+    
+    status |= getGeometry();
+
+    /* Cache the readout time per row for the frame rate estimator.  The maximum frame rate is
+     * only limited by the readout when the exposure is shorter than the frame. */
+    {
+        tPvFloat32 minRate, maxRate;
+        int sizeY, binY;
+        double acquireTime;
+        getIntegerParam(ADSizeY, &sizeY);
+        getIntegerParam(ADBinY, &binY);
+        getDoubleParam(ADAcquireTime, &acquireTime);
+        if ((attrRangeFloat32("FrameRate", &minRate, &maxRate) == ePvErrSuccess) &&
+            (maxRate > 0.) && (binY > 0) && (sizeY/binY > 0) && (acquireTime*maxRate < 0.9)) {
+            this->rowReadoutTime = 1. / (maxRate * (sizeY/binY));
+        }
+    }
+
+    status |= attrUint32Get("AcquisitionFrameCount", &intVal);
+    status |= setIntegerParam(ADNumImages, intVal);
+
+    status |= attrEnumGet("AcquisitionMode", buffer, sizeof(buffer), &nchars);
+    if      (!strcmp(buffer, "SingleFrame")) i = ADImageSingle;
+    else if (!strcmp(buffer, "MultiFrame"))  i = ADImageMultiple;
+    else if (!strcmp(buffer, "Recorder"))    i = ADImageMultiple;
+    else if (!strcmp(buffer, "Continuous"))  i = ADImageContinuous;
+    else {i=0; status |= asynError;}
+    status |= setIntegerParam(ADImageMode, i);
+
+    status |= attrEnumGet("FrameStartTriggerMode", buffer, sizeof(buffer), &nchars);
+    for (i=0; i<NUM_TRIGGER_START_MODES; i++) {
+        if (strcmp(buffer, PSTriggerStartModes[i]) == 0) {
+            status |= setIntegerParam(ADTriggerMode, i);
+            break;
+        }
+    }
+    if (i == NUM_TRIGGER_START_MODES) {
+        status |= setIntegerParam(ADTriggerMode, 0);
+        status |= asynError;
+    }
+    
+    /* Prosilica does not support more than 1 exposure per frame */
+    status |= setIntegerParam(ADNumExposures, 1);
+
+    /* Prosilica uses integer microseconds */
+    status |= attrUint32Get("ExposureValue", &intVal);
+    dval = intVal / 1.e6;
+    status |= setDoubleParam(ADAcquireTime, dval);
+
+    /* Prosilica uses a frame rate in Hz */
+    status |= attrFloat32Get("FrameRate", &fltVal);
+    if (fltVal == 0.) fltVal = 1;
+    dval = 1. / fltVal;
+    status |= setDoubleParam(ADAcquirePeriod, dval);
+
+    /* Prosilica uses an integer value */
+    status |= attrUint32Get("GainValue", &intVal);
+    dval = intVal;
+    status |= setDoubleParam(ADGain, dval);
+
+    /* Exposure mode can be maunal or auto */
+    status |= attrEnumGet("ExposureMode", buffer, sizeof(buffer), &nchars);
+    for (i=0; i<NUM_EXPOSURE_MODES; i++) {
+        if (strcmp(buffer, PSExposureModes[i]) == 0) {
+            status |= setIntegerParam(PSExposureMode, i);
+            break;
+        }
+    }
+    if (i == NUM_EXPOSURE_MODES) {
+        status |= setIntegerParam(PSExposureMode, 0);
+        status |= asynError;
+    }
+    
+    /* Gain mode can be maunal or auto */
+    status |= attrEnumGet("GainMode", buffer, sizeof(buffer), &nchars);
+    for (i=0; i<NUM_GAIN_MODES; i++) {
+        if (strcmp(buffer, PSGainModes[i]) == 0) {
+            status |= setIntegerParam(PSGainMode, i);
+            break;
+        }
+    }
+    if (i == NUM_GAIN_MODES) {
+        status |= setIntegerParam(PSGainMode, 0);
+        status |= asynError;
+    }
+
+    /* The cached camera constraints may have changed */
+    computeEstimate();
+
+    /* Call the callbacks to update the values in higher layers */
+    callParamCallbacks();
+    
+    if (status) asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, 
+                      "%s:%s: error, status=%d\n", 
+                      driverName, functionName, status);
+    return((asynStatus)status);
+}
+
+asynStatus prosilica::disconnectCamera()
+{
+    int status = asynSuccess;
     tPvFrame *pFrame;
     NDArray *pImage;
     static const char *functionName = "disconnectCamera";
@@ -1288,9 +3879,18 @@ asynStatus prosilica::disconnectCamera()
     }
 
     if (!this->PvHandle) return(asynSuccess);
+    /* roiSeqTask must not write to the camera once it is closed */
+    epicsMutexMustLock(this->roiSeqMutex);
+    this->roiSeqCount = 0;
+    epicsMutexUnlock(this->roiSeqMutex);
+    /* Nor the GPO program thread */
+    epicsMutexMustLock(this->gpoMutex);
+    this->gpoHandle = NULL;
+    epicsMutexUnlock(this->gpoMutex);
     // We have the lock at this point, but these functions can block resulting in a deadlock
     //  Release the lock
     unlock();
+    PvCameraEventCallbackUnRegister(this->PvHandle, cameraEventCallbackC);
     status |= PvCaptureQueueClear(this->PvHandle);
     status |= PvCaptureEnd(this->PvHandle);
     status |= PvCameraClose(this->PvHandle);
@@ -1313,8 +3913,20 @@ asynStatus prosilica::disconnectCamera()
         if (pImage) pImage->release();
         pFrame->Context[1] = 0;
     }
+    this->numParkedFrames = 0;
 
     this->PvHandle = NULL;
+    setArm(0);
+    /* The ROI sequence stops with the camera, keep the window the user set.  The camera is
+     * still at a window of the sequence, so it is moved back when it connects again. */
+    if (this->roiSeqActive) {
+        setIntegerParam(ADMinX, this->roiSeqHomeX);
+        setIntegerParam(ADMinY, this->roiSeqHomeY);
+        this->roiSeqRestore = 1;
+    }
+    this->roiSeqActive = 0;
+    psMetricsSet(&this->metrics, PSMetricConnected, 0);
+    psMetricsSet(&this->metrics, PSMetricAcquiring, 0);
     /* We've disconnected the camera. Signal to asynManager that we are disconnected. */
     status = pasynManager->exceptionDisconnect(this->pasynUserSelf);
     if (status) {
@@ -1341,7 +3953,11 @@ asynStatus prosilica::connectCamera()
     struct in_addr ipAddr;
     unsigned long versionMajor, versionMinor;
     char versionString[20];
-    bool isUniqueId;
+    char cachedAddress[PS_CACHE_ADDRESS_SIZE];
+    char idString[20];
+    bool isUniqueId, byAddress;
+    tPvUint32 capacity;
+    int syncInMonitor;
     static const char *functionName = "connectCamera";
 
     /* Ensure that PvAPI has been initialised */
@@ -1357,14 +3973,23 @@ asynStatus prosilica::connectCamera()
     
     /* Determine if we have been passed a uniqueID (all characters in cameraId are digits), 
      * or an IP address (anything else) */
-    isUniqueId = true;
-    for (i=0; i<(int)strlen(this->cameraId); i++) {
-      if (!isdigit(this->cameraId[i])) isUniqueId = false;
-    }
+    isUniqueId = isUniqueIdString(this->cameraId);
+    byAddress = !isUniqueId;
     
     if (isUniqueId) {
         this->uniqueId = atoi(this->cameraId);
-        status = PvCameraInfoEx(this->uniqueId, &this->PvCameraInfo, sizeof(this->PvCameraInfo));
+        /* A camera in the cache is opened by its address, which does not need discovery.
+         * The cached address is only used if it still belongs to this camera. */
+        if ((psCacheLookup(this->uniqueId, cachedAddress, sizeof(cachedAddress)) == 0) &&
+            (hostToIPAddr(cachedAddress, &ipAddr) == 0) &&
+            (PvCameraInfoByAddrEx(ipAddr.s_addr, &this->PvCameraInfo, NULL, sizeof(this->PvCameraInfo)) == ePvErrSuccess) &&
+            (this->PvCameraInfo.UniqueId == this->uniqueId)) {
+            byAddress = true;
+            this->uniqueIP = (unsigned long) ipAddr.s_addr;
+            status = ePvErrSuccess;
+        } else {
+            status = PvCameraInfoEx(this->uniqueId, &this->PvCameraInfo, sizeof(this->PvCameraInfo));
+        }
         if (status) {
             asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, 
                   "%s:%s: Cannot find camera %lu\n", 
@@ -1403,7 +4028,10 @@ asynStatus prosilica::connectCamera()
         // Wait a second and fetch status again
         epicsThreadSleep(CONNECT_RETRY_INTERVAL);
 
-        status = PvCameraInfoEx(this->uniqueId, &this->PvCameraInfo, sizeof(this->PvCameraInfo));
+        if (byAddress)
+            status = PvCameraInfoByAddrEx(ipAddr.s_addr, &this->PvCameraInfo, NULL, sizeof(this->PvCameraInfo));
+        else
+            status = PvCameraInfoEx(this->uniqueId, &this->PvCameraInfo, sizeof(this->PvCameraInfo));
         if (status) {
             asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, 
                   "%s:%s: Cannot read status for camera %lu\n", 
@@ -1422,10 +4050,10 @@ asynStatus prosilica::connectCamera()
         return asynError;
     }
 
-    if (isUniqueId)
-      status = PvCameraOpen(this->uniqueId, ePvAccessMaster, &this->PvHandle);
-    else
+    if (byAddress)
       status = PvCameraOpenByAddr(ipAddr.s_addr, ePvAccessMaster, &this->PvHandle);
+    else
+      status = PvCameraOpen(this->uniqueId, ePvAccessMaster, &this->PvHandle);
     
     if (status) {
         asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, 
@@ -1434,6 +4062,9 @@ asynStatus prosilica::connectCamera()
         this->PvHandle = NULL;
         return asynError;
     }
+    epicsMutexMustLock(this->gpoMutex);
+    this->gpoHandle = this->PvHandle;
+    epicsMutexUnlock(this->gpoMutex);
  
     /* Negotiate maximum frame size */
     status = PvCaptureAdjustPacketSize(this->PvHandle, MAX_PACKET_SIZE);
@@ -1458,20 +4089,35 @@ asynStatus prosilica::connectCamera()
        since changing readout parameters happens instantly, but there will still be frames
        queued with the wrong size */
     /* Query the parameters of the image sensor */
-    status = PvAttrEnumGet(this->PvHandle, "SensorType", this->sensorType, 
-                             sizeof(this->sensorType), &nchars);
-    status |= PvAttrUint32Get(this->PvHandle, "SensorBits", &this->sensorBits);
-    status |= PvAttrUint32Get(this->PvHandle, "SensorWidth", &this->sensorWidth);
-    status |= PvAttrUint32Get(this->PvHandle, "SensorHeight", &this->sensorHeight);
-    status |= PvAttrUint32Get(this->PvHandle, "TimeStampFrequency", &this->timeStampFrequency);
-    status |= PvAttrStringGet(this->PvHandle, "DeviceIPAddress", this->IPAddress, 
-                              sizeof(this->IPAddress), &nchars);
+    status = attrEnumGet("SensorType", this->sensorType, 
+                           sizeof(this->sensorType), &nchars);
+    status |= attrUint32Get("SensorBits", &this->sensorBits);
+    status |= attrUint32Get("SensorWidth", &this->sensorWidth);
+    status |= attrUint32Get("SensorHeight", &this->sensorHeight);
+    status |= attrUint32Get("TimeStampFrequency", &this->timeStampFrequency);
+    status |= attrStringGet("DeviceIPAddress", this->IPAddress, 
+                            sizeof(this->IPAddress), &nchars);
     if (status) {
         asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, 
               "%s:%s: unable to get sensor data on camera %lu\n",
               driverName, functionName, this->uniqueId);
         return asynError;
     }
+
+    /* Remember the address of this camera, so it can be opened without discovery next time */
+    if (psCacheUpdate(this->uniqueId, this->IPAddress)) psCacheSave();
+    epicsSnprintf(idString, sizeof(idString), "%lu", this->uniqueId);
+    psMetricsSetLabels(&this->metrics, idString, this->PvCameraInfo.ModelName);
+
+    /* Find the host interface which receives the stream, for the host network counters */
+    if (psHostFindInterface(NULL, this->IPAddress, this->hostStats.ifName, sizeof(this->hostStats.ifName)))
+        this->hostStats.ifName[0] = 0;
+    setStringParam(PSHostInterface, this->hostStats.ifName);
+    /* Place the frame buffers, which are allocated next, on the node of the interface */
+    this->numaNode = psNumaInterfaceNode(NULL, this->hostStats.ifName);
+    setIntegerParam(PSNumaNode, this->numaNode);
+    applyNumaPlacement();
+    this->hostStatsValid = 0;
     
     bytesPerPixel = (this->sensorBits-1)/8 + 1;
     /* If the camera supports color then there can be 3 values per pixel */
@@ -1529,6 +4175,20 @@ asynStatus prosilica::connectCamera()
         return asynError;
     }
     
+    /* A camera which was lost during an ROI sequence is moved back to the window the user set,
+     * before it is read back */
+    if (this->roiSeqRestore) {
+        int binX, binY, minX, minY;
+        getIntegerParam(ADBinX, &binX);
+        if (binX < 1) binX = 1;
+        getIntegerParam(ADBinY, &binY);
+        if (binY < 1) binY = 1;
+        getIntegerParam(ADMinX, &minX);
+        getIntegerParam(ADMinY, &minY);
+        if ((attrUint32Set("RegionX", minX/binX) == ePvErrSuccess) &&
+            (attrUint32Set("RegionY", minY/binY) == ePvErrSuccess)) this->roiSeqRestore = 0;
+    }
+
      /* Read the current camera settings */
     status = readParameters();
     if (status) return((asynStatus)status);
@@ -1540,11 +4200,23 @@ asynStatus prosilica::connectCamera()
     /* Force acquisition to stop.  
      * With CMOS cameras if the camera is already acquiring when we connect there will be problems,
      * and this can happen if the camera was acquiring when the IOC previously exited. */
-    PvCommandRun(this->PvHandle, "AcquisitionAbort");
+    commandRun("AcquisitionAbort");
+
+    /* Frames held in camera memory are only wanted under control of the StreamHold coordinator.
+     * Older cameras do not support StreamHold, so ignore errors. */
+    if (attrUint32Get("StreamHoldCapacity", &capacity)) capacity = 0;
+    setIntegerParam(PSStreamHoldCapacity, capacity);
+    setIntegerParam(PSStreamHoldFrames, 0);
+    if (capacity) setStreamHold(0);
 
     /* Now sync the timer on the camera with the IOC */
 
     this->syncTimer();
+
+    /* Camera events are used by the sync input monitor.  Older cameras do not send events. */
+    PvCameraEventCallbackRegister(this->PvHandle, cameraEventCallbackC, this);
+    getIntegerParam(PSSyncInMonitor, &syncInMonitor);
+    if (syncInMonitor != PSSyncInMonitorOff) setSyncInMonitor();
         
     /* We found the camera and everything is OK.  Signal to asynManager that we are connected. */
     status = pasynManager->exceptionConnect(this->pasynUserSelf);
@@ -1554,6 +4226,7 @@ asynStatus prosilica::connectCamera()
             driverName, functionName, pasynUserSelf->errorMessage);
         return asynError;
     }
+    psMetricsSet(&this->metrics, PSMetricConnected, 1);
     asynPrint(this->pasynUserSelf, ASYN_TRACE_FLOW, 
         "%s:%s: Camera connected; unique id: %ld\n", 
         driverName, functionName, this->uniqueId);
@@ -1561,254 +4234,2113 @@ asynStatus prosilica::connectCamera()
 }
 
 
-/** Called when asyn clients call pasynInt32->write().
-  * This function performs actions for some parameters, including ADAcquire, ADBinX, etc.
-  * For all parameters it sets the value in the parameter library and calls any registered callbacks..
-  * \param[in] pasynUser pasynUser structure that encodes the reason and address.
-  * \param[in] value Value to write. */
-asynStatus prosilica::writeInt32(asynUser *pasynUser, epicsInt32 value)
+/** Starts or stops acquisition; called with the lock held */
+asynStatus prosilica::setAcquire(int value)
 {
-    int function = pasynUser->reason;
     int status = asynSuccess;
-    tPvUint32 syncs;
-    static const char *functionName = "writeInt32";
-
-    /* Set the parameter and readback in the parameter library.  This may be overwritten when we read back the
-     * status at the end, but that's OK */
-    status |= setIntegerParam(function, value);
 
-    if ((function == ADBinX) ||
-        (function == ADBinY) ||
-        (function == ADMinX) ||
-        (function == ADSizeX) ||
-        (function == ADMinY) ||
-        (function == ADSizeY)) {
-        /* These commands change the chip readout geometry.  We need to cache them and apply them in the
-         * correct order */
-        status |= setGeometry();
-    } else if (function == ADNumImages) {
-        status |= PvAttrUint32Set(this->PvHandle, "AcquisitionFrameCount", value);
-    } else if (function == ADImageMode) {
-        switch(value) {
+    if (value) {
+        /* We need to set the number of images we expect to collect, so the frame callback function
+           can know when acquisition is complete.  We need to find out what mode we are in and how
+           many frames have been requested.  If we are in continuous mode then set the number of
+           remaining frames to -1. */
+        int imageMode, numImages, gateMode;
+        status |= getIntegerParam(ADImageMode, &imageMode);
+        status |= getIntegerParam(ADNumImages, &numImages);
+        /* In gated mode the camera runs until it is stopped, and the gate selects the frames */
+        getIntegerParam(PSGateMode, &gateMode);
+        if (gateMode) {
+            imageMode = ADImageContinuous;
+            if (!this->armed) status |= attrEnumSet("AcquisitionMode", "Continuous");
+        }
+        switch(imageMode) {
         case ADImageSingle:
-            status |= PvAttrEnumSet(this->PvHandle, "AcquisitionMode", "SingleFrame");
+            this->framesRemaining = 1;
             break;
         case ADImageMultiple:
-            status |= PvAttrEnumSet(this->PvHandle, "AcquisitionMode", "MultiFrame");
+            this->framesRemaining = numImages;
             break;
         case ADImageContinuous:
-            status |= PvAttrEnumSet(this->PvHandle, "AcquisitionMode", "Continuous");
+            this->framesRemaining = -1;
             break;
        }
-    } else if (function == ADAcquire) {
-        if (value) {
-            /* We need to set the number of images we expect to collect, so the frame callback function
-               can know when acquisition is complete.  We need to find out what mode we are in and how
-               many frames have been requested.  If we are in continuous mode then set the number of
-               remaining frames to -1. */
-            int imageMode, numImages;
-            status |= getIntegerParam(ADImageMode, &imageMode);
-            status |= getIntegerParam(ADNumImages, &numImages);
-            switch(imageMode) {
-            case ADImageSingle:
-                this->framesRemaining = 1;
-                break;
-            case ADImageMultiple:
-                this->framesRemaining = numImages;
-                break;
-            case ADImageContinuous:
-                this->framesRemaining = -1;
-                break;
-           }
-            setIntegerParam(ADStatus, ADStatusAcquire);
-            setShutter(1);
-            status |= PvCommandRun(this->PvHandle, "AcquisitionStart");
-        } else {
-            setIntegerParam(ADStatus, ADStatusIdle);
-            setShutter(0);
-            status |= PvCommandRun(this->PvHandle, "AcquisitionAbort");
-        }
-    } else if (function == ADTriggerMode) {
-        if ((value < 0) || (value > (NUM_TRIGGER_START_MODES-1))) {
+        setIntegerParam(ADStatus, ADStatusAcquire);
+        setShutter(1);
+        this->firstFramePending = 1;
+        requeueParkedFrames();
+        epicsTimeGetCurrent(&this->acquireStartTime);
+        startRoiSequence();
+        status |= commandRun("AcquisitionStart");
+        psMetricsSet(&this->metrics, PSMetricAcquiring, 1);
+    } else {
+        this->firstFramePending = 0;
+        setGateOpen(0);
+        setIntegerParam(ADStatus, ADStatusIdle);
+        psMetricsSet(&this->metrics, PSMetricAcquiring, 0);
+        setShutter(0);
+        status |= commandRun("AcquisitionAbort");
+        stopRoiSequence();
+    }
+    return((asynStatus)status);
+}
+
+
+/** Arms or disarms the camera; called with the lock held.
+  * Arming pushes the acquisition configuration to the camera and checks that the capture stream
+  * is running with an image buffer queued on every PvAPI frame.  While armed, starting and
+  * stopping acquisition sends a single command and does not read the parameters back.
+  * \param[in] value 1 to arm, 0 to disarm. */
+asynStatus prosilica::setArm(int value)
+{
+    int status = asynSuccess;
+    int acquire, imageMode, numImages, triggerMode, gateMode;
+    unsigned long isStarted = 0;
+    static const char *functionName = "setArm";
+
+    this->armed = 0;
+    if (value) {
+        getIntegerParam(ADAcquire, &acquire);
+        if (acquire || !this->PvHandle) {
+            asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+                "%s:%s: can not arm while acquiring or disconnected\n",
+                driverName, functionName);
+            status = asynError;
+        } else {
+            getIntegerParam(ADImageMode, &imageMode);
+            getIntegerParam(ADNumImages, &numImages);
+            getIntegerParam(ADTriggerMode, &triggerMode);
+            getIntegerParam(PSGateMode, &gateMode);
+            if (gateMode) imageMode = ADImageContinuous;
+            status |= setGeometry();
+            status |= setPixelFormat();
+            if ((imageMode >= 0) && (imageMode < 3))
+                status |= attrEnumSet("AcquisitionMode",
+                                      imageMode == ADImageSingle   ? "SingleFrame" :
+                                      imageMode == ADImageMultiple ? "MultiFrame" : "Continuous");
+            status |= attrUint32Set("AcquisitionFrameCount", numImages);
+            if ((triggerMode >= 0) && (triggerMode < NUM_TRIGGER_START_MODES))
+                status |= attrEnumSet("FrameStartTriggerMode",
+                                      PSTriggerStartModes[triggerMode]);
+            status |= PvCaptureQuery(this->PvHandle, &isStarted);
+            if (!isStarted) {
+                asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+                    "%s:%s: capture is not started\n",
+                    driverName, functionName);
+                status = asynError;
+            }
+            requeueParkedFrames();
+            if (this->numParkedFrames) {
+                asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+                    "%s:%s: %d frames are not queued, increase maxBuffers or maxMemory\n",
+                    driverName, functionName, this->numParkedFrames);
+                status = asynError;
+            }
+            if (!status) this->armed = 1;
+        }
+    }
+    setIntegerParam(PSArm, this->armed);
+    setIntegerParam(PSArmed, this->armed);
+    return((asynStatus)status);
+}
+
+
+/** Returns 1 if a write to this parameter leaves the camera armed.  These are commands which do
+  * not change the acquisition configuration. */
+int prosilica::keepsArmed(int function)
+{
+    return ((function == ADAcquire) ||
+            (function == PSArm) ||
+            (function == NDArrayCallbacks) ||
+            (function == PSRgbLayout) ||
+            (function == PSRoiSeqEnable) ||
+            (function == PSSoftBinX) ||
+            (function == PSSoftBinY) ||
+            (function == PSSoftBinMode) ||
+            (function == PSSoftBinType) ||
+            (function == ADShutterControl) ||
+            (function == PSGroupAcquire) ||
+            (function == PSReadStatistics) ||
+            (function == PSTriggerSoftware) ||
+            (function == PSResetTimer) ||
+            (function == PSSyncOut1Level) ||
+            (function == PSSyncOut2Level) ||
+            (function == PSSyncOut3Level) ||
+            (function == PSSyncOutGpoLevels) ||
+            (function == PSGpoPulse) ||
+            (function == PSGpoPulseWidth) ||
+            (function == PSGpoProgramRun) ||
+            (function == PSGpoProgramRepeats) ||
+            (function == PSGpoProgramPeriod) ||
+            (function == PSSyncInMonitor) ||
+            (function == PSSyncInPollPeriod) ||
+            (function == PSSyncInResetCounts));
+}
+
+
+/** Returns 1 if a frame should be delivered.  In gated mode these are the frames which the camera
+  * started after the gate was opened, up to the number of frames for the scan point.  Called with the
+  * lock held. */
+int prosilica::gateAccept(tPvFrame *pFrame)
+{
+    int gateMode;
+    epicsUInt64 frameTicks;
+
+    getIntegerParam(PSGateMode, &gateMode);
+    if (!gateMode) return 1;
+    if (this->gateRemaining <= 0) return 0;
+    /* A frame which was exposing while the gate opened belongs to the previous point.  Both times
+     * are camera clock ticks, so the comparison does not depend on the IOC clock. */
+    frameTicks = ((epicsUInt64)pFrame->TimestampHi << 32) | (epicsUInt32)pFrame->TimestampLo;
+    if (frameTicks < this->gateOpenTicks) return 0;
+    return 1;
+}
+
+
+/** Opens the gate for PSGateFrames frames, or closes it; called with the lock held.
+  * The camera clock is latched when the gate opens, so that gateAccept can compare it with the
+  * frame timestamps. */
+void prosilica::setGateOpen(int value)
+{
+    int gateFrames;
+    tPvUint32 hi=0, lo=0;
+    int status = 0;
+    static const char *functionName = "setGateOpen";
+
+    getIntegerParam(PSGateFrames, &gateFrames);
+    if (value && (gateFrames > 0)) {
+        if (this->PvHandle) {
+            status |= commandRun("TimeStampValueLatch");
+            status |= attrUint32Get("TimeStampValueHi", &hi);
+            status |= attrUint32Get("TimeStampValueLo", &lo);
+        }
+        if (status || !this->PvHandle) {
+            /* Without the camera clock every frame from now on is inside the gate */
+            asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+                "%s:%s: cannot latch the camera clock, status=%d\n",
+                driverName, functionName, status);
+            hi = lo = 0;
+        }
+        this->gateOpenTicks = ((epicsUInt64)hi << 32) | lo;
+        this->gateRemaining = gateFrames;
+        setIntegerParam(PSGateOpen, 1);
+    } else {
+        this->gateRemaining = 0;
+        setIntegerParam(PSGateOpen, 0);
+    }
+}
+
+
+/** Called when asyn clients call pasynInt32->write().
+  * This function performs actions for some parameters, including ADAcquire, ADBinX, etc.
+  * For all parameters it sets the value in the parameter library and calls any registered callbacks..
+  * \param[in] pasynUser pasynUser structure that encodes the reason and address.
+  * \param[in] value Value to write. */
+asynStatus prosilica::writeInt32(asynUser *pasynUser, epicsInt32 value)
+{
+    int function = pasynUser->reason;
+    int status = asynSuccess;
+    int addr;
+    static const char *functionName = "writeInt32";
+
+    /* The regions are on their own addresses and do not touch the camera */
+    if ((function >= FIRST_PS_REGION_PARAM) && (function <= LAST_PS_REGION_PARAM)) {
+        getAddress(pasynUser, &addr);
+        if ((addr < 1) || (addr > NUM_REGIONS) || (value < 0)) return asynError;
+        setIntegerParam(addr, function, value);
+        callParamCallbacks(addr);
+        return asynSuccess;
+    }
+
+    /* Set the parameter and readback in the parameter library.  This may be overwritten when we read back the
+     * status at the end, but that's OK */
+    status |= setIntegerParam(function, value);
+
+    /* The estimator parameters do not touch the camera */
+    if ((function >= FIRST_PS_EST_PARAM) && (function <= LAST_PS_EST_PARAM)) {
+        if (function == PSEstCopyCurrent) {
+            int ival, dataType, colorMode, bayerConvert;
+            double dval;
+            getIntegerParam(ADSizeX, &ival);   setIntegerParam(PSEstSizeX, ival);
+            getIntegerParam(ADSizeY, &ival);   setIntegerParam(PSEstSizeY, ival);
+            getIntegerParam(ADBinX, &ival);    setIntegerParam(PSEstBinX, ival);
+            getIntegerParam(ADBinY, &ival);    setIntegerParam(PSEstBinY, ival);
+            getIntegerParam(PSByteRate, &ival); setIntegerParam(PSEstByteRate, ival);
+            getDoubleParam(ADAcquireTime, &dval); setDoubleParam(PSEstAcquireTime, dval);
+            getIntegerParam(PSBayerConvert, &bayerConvert);
+            getIntegerParam(NDDataType, &dataType);
+            getIntegerParam(NDColorMode, &colorMode);
+            if (colorMode == NDColorModeRGB1) {
+                getIntegerParam(PSRgbLayout, &ival);
+                bayerConvert = rgbLayoutConversion(ival);
+            }
+            setIntegerParam(PSEstBayerConvert, bayerConvert);
+            if (colorMode == NDColorModeRGB1) ival = ePvFmtRgb24;
+            else if (colorMode == NDColorModeBayer) ival = ePvFmtBayer8;
+            else ival = ePvFmtMono8;
+            /* The 16-bit format follows each 8-bit format */
+            if (dataType == NDUInt16) ival++;
+            setIntegerParam(PSEstPixelFormat, ival);
+            setIntegerParam(PSEstCopyCurrent, 0);
+        }
+        computeEstimate();
+        callParamCallbacks();
+        return((asynStatus)status);
+    }
+
+    /* The NUMA placement does not touch the camera */
+    if (function == PSNumaEnable) {
+        applyNumaPlacement();
+        callParamCallbacks();
+        return((asynStatus)status);
+    }
+
+    /* The hardware counters are opened by the frame callback thread, so this only changes the state */
+    if (function == PSPerfEnable) {
+        psPerfClose(&this->perfCounters);
+        memset(this->perfSums, 0, sizeof(this->perfSums));
+        this->perfPixels = 0.;
+        this->perfFailed = 0;
+        setStringParam(PSPerfStatus, value ? "Waiting for frames" : "Off");
+        callParamCallbacks();
+        return((asynStatus)status);
+    }
+
+    /* The attribute latency counts do not touch the camera */
+    if ((function == PSAttrSort) || (function == PSAttrReset)) {
+        if (function == PSAttrReset) {
+            psAttrStatsReset(&this->attrStats);
+            setIntegerParam(PSAttrReset, 0);
+        }
+        publishAttrStats();
+        callParamCallbacks();
+        return((asynStatus)status);
+    }
+
+    /* The gate parameters only latch the camera clock, so a scan point costs no configuration access */
+    if ((function >= FIRST_PS_GATE_PARAM) && (function <= LAST_PS_GATE_PARAM)) {
+        if (function == PSGateOpen) setGateOpen(value);
+        callParamCallbacks();
+        return((asynStatus)status);
+    }
+
+    /* Changing the configuration disarms the camera */
+    if (this->armed && !keepsArmed(function)) setArm(0);
+
+    if ((function == ADBinX) ||
+        (function == ADBinY) ||
+        (function == ADMinX) ||
+        (function == ADSizeX) ||
+        (function == ADMinY) ||
+        (function == ADSizeY)) {
+        /* These commands change the chip readout geometry.  We need to cache them and apply them in the
+         * correct order */
+        status |= setGeometry();
+    } else if (function == ADNumImages) {
+        status |= attrUint32Set("AcquisitionFrameCount", value);
+    } else if (function == ADImageMode) {
+        status |= setImageMode(value);
+    } else if (function == ADAcquire) {
+        status |= setAcquire(value);
+        /* When armed the configuration has already been read back.  Only ADAcquire and
+         * ADStatus changed here, so the first frame does not wait for the readback. */
+        if (this->armed) {
+            callParamCallbacks();
+            if (status)
+                asynPrint(pasynUser, ASYN_TRACE_ERROR,
+                      "%s:%s: error, status=%d function=%d, value=%d\n",
+                      driverName, functionName, status, function, value);
+            return((asynStatus)status);
+        }
+    } else if (function == PSArm) {
+        status |= setArm(value);
+    } else if (function == PSGroupAcquire) {
+        if (!this->pGroup) {
+            status = asynError;
+        } else {
+            /* Starting the group takes the lock of every member in turn, including ours */
+            unlock();
+            status |= groupStart(this->pGroup, value);
+            lock();
+        }
+    } else if ((function == PSStreamHold) ||
+               (function == PSStreamHoldLinkRate)) {
+        if (!this->pGroup) {
+            status = asynError;
+        } else {
+            int enable, linkRate;
+            getIntegerParam(PSStreamHold, &enable);
+            getIntegerParam(PSStreamHoldLinkRate, &linkRate);
+            /* This sets the stream rate and hold state of every member, including us */
+            unlock();
+            status |= groupStreamHold(this->pGroup, enable, linkRate);
+            lock();
+        }
+    } else if (function == ADTriggerMode) {
+        if ((value < 0) || (value > (NUM_TRIGGER_START_MODES-1))) {
             status = asynError;
         } else {
-            status |= PvAttrEnumSet(this->PvHandle, "FrameStartTriggerMode", 
-                                    PSTriggerStartModes[value]);
+            status |= attrEnumSet("FrameStartTriggerMode", 
+                                  PSTriggerStartModes[value]);
+        }
+    } else if (function == PSByteRate) {
+            status |= attrUint32Set("StreamBytesPerSecond", value);
+    } else if (function == PSReadStatistics) {
+            readStats();
+    } else if (function == PSTriggerEvent) {
+            status |= attrEnumSet("FrameStartTriggerEvent", PSTriggerEventModes[value]);
+    } else if (function == PSTriggerOverlap) {
+            status |= attrEnumSet("FrameStartTriggerOverlap", PSTriggerOverlapModes[value]);
+    } else if (function == PSTriggerSoftware) {
+            status |= commandRun("FrameStartTriggerSoftware");
+    } else if (function == PSSyncOut1Mode) {
+            status |= attrEnumSet("SyncOut1Mode", PSSyncOutModes[value]);
+    } else if (function == PSSyncOut2Mode) {
+            status |= attrEnumSet("SyncOut2Mode", PSSyncOutModes[value]);
+    } else if (function == PSSyncOut3Mode) {
+            status |= attrEnumSet("SyncOut3Mode", PSSyncOutModes[value]);
+            if (status == ePvErrNotFound) status = 0;
+    } else if (function == PSSyncOut1Level) {
+            status |= setGpoLevels(0x01, value<<0);
+    } else if (function == PSSyncOut2Level) {
+            status |= setGpoLevels(0x02, value<<1);
+    } else if (function == PSSyncOut3Level) {
+            status |= setGpoLevels(0x04, value<<2);
+    } else if (function == PSSyncOutGpoLevels) {
+            /* All of the outputs change in a single write */
+            status |= setGpoLevels(GPO_LEVELS_MASK, value);
+    } else if (function == PSGpoPulse) {
+            double width;
+            epicsInt32 masks[2];
+            double times[2];
+            getDoubleParam(PSGpoPulseWidth, &width);
+            masks[0] = this->gpoLevels | (value & GPO_LEVELS_MASK);
+            masks[1] = this->gpoLevels & ~(value & GPO_LEVELS_MASK);
+            times[0] = 0.;
+            times[1] = width;
+            status |= startGpoProgram(masks, times, 2, 1, 0.);
+            if (!status) setIntegerParam(PSGpoProgramRun, 1);
+    } else if (function == PSGpoProgramRun) {
+        if (value) {
+            int repeats;
+            double period;
+            getIntegerParam(PSGpoProgramRepeats, &repeats);
+            getDoubleParam(PSGpoProgramPeriod, &period);
+            if (this->gpoProgramNumMasks != this->gpoProgramNumTimes) {
+                asynPrint(pasynUser, ASYN_TRACE_ERROR,
+                    "%s:%s: GPO program has %d masks but %d times\n",
+                    driverName, functionName, this->gpoProgramNumMasks, this->gpoProgramNumTimes);
+                status = asynError;
+            } else {
+                status |= startGpoProgram(this->gpoProgramMasks, this->gpoProgramTimes,
+                                          this->gpoProgramNumMasks, repeats, period);
+            }
+            if (status) setIntegerParam(PSGpoProgramRun, 0);
+        } else {
+            this->gpoRunAbort = 1;
+            epicsEventSignal(this->gpoProgramEvent);
+        }
+    } else if (function == PSSyncOut1Invert) {
+            status |= attrEnumSet("SyncOut1Invert", value ? "On":"Off");
+    } else if (function == PSSyncOut2Invert) {
+            status |= attrEnumSet("SyncOut2Invert", value ? "On":"Off");
+    } else if (function == PSSyncOut3Invert) {
+            status |= attrEnumSet("SyncOut3Invert", value ? "On":"Off");
+            if (status == ePvErrNotFound) status = 0;
+    } else if (function == PSStrobe1Mode) {
+            status |= attrEnumSet("Strobe1Mode", PSStrobeModes[value]);
+    } else if (function == PSStrobe1CtlDuration) {
+            status |= attrEnumSet("Strobe1ControlledDuration", value ? "On":"Off");
+    } else if ((function == NDDataType) ||
+               (function == NDColorMode)) {
+            status = setPixelFormat();
+    } else if (function == PSResetTimer) {
+            status = syncTimer();
+    } else if ( function == PSExposureMode ) {
+            status = attrEnumSet("ExposureMode", PSExposureModes[value]);
+    } else if ( function == PSGainMode ) {
+            status = attrEnumSet("GainMode", PSGainModes[value]);
+    } else if ( function == PSSyncInMonitor ) {
+            status = setSyncInMonitor();
+    } else if ( function == PSSyncInResetCounts ) {
+            setIntegerParam(PSSyncIn1Count, 0);
+            setIntegerParam(PSSyncIn2Count, 0);
+    } else if ( function == PSPtpMode ) {
+            if ((value < 0) || (value > (NUM_PTP_MODES-1))) {
+                status = asynError;
+            } else {
+                status = attrEnumSet("PtpMode", PSPtpModes[value]);
+                status |= readPtpStatus();
+            }
+    } else if ((function == PSSoftBinX) ||
+               (function == PSSoftBinY)) {
+            if ((value < 1) || (value > PS_BIN_MAX)) {
+                setIntegerParam(function, (value < 1) ? 1 : PS_BIN_MAX);
+                status = asynError;
+            }
+    } else if ( function == PSTimestampType ) {
+            /* The PTP clock may have a different frequency from the free running clock */
+            if (this->PvHandle) status = attrUint32Get("TimeStampFrequency", &this->timeStampFrequency);
+    } else {
+            /* If this is not a parameter we have handled call the base class */
+            if (function < FIRST_PS_PARAM) status = ADDriver::writeInt32(pasynUser, value);
+    }
+    
+    /* Read the camera parameters and do callbacks */
+    status |= readParameters();    
+    if (status) 
+        asynPrint(pasynUser, ASYN_TRACE_ERROR, 
+              "%s:%s: error, status=%d function=%d, value=%d\n", 
+              driverName, functionName, status, function, value);
+    else        
+        asynPrint(pasynUser, ASYN_TRACEIO_DRIVER, 
+              "%s:%s: function=%d, value=%d\n", 
+              driverName, functionName, function, value);
+    return((asynStatus)status);
+}
+
+/** Called when asyn clients call pasynFloat64->write().
+  * This function performs actions for some parameters, including ADAcquireTime, ADGain, etc.
+  * For all parameters it sets the value in the parameter library and calls any registered callbacks..
+  * \param[in] pasynUser pasynUser structure that encodes the reason and address.
+  * \param[in] value Value to write. */
+asynStatus prosilica::writeFloat64(asynUser *pasynUser, epicsFloat64 value)
+{
+    int function = pasynUser->reason;
+    int status = asynSuccess;
+    const char *paramName;
+    static const char *functionName = "writeFloat64";
+
+    getParamName(function, &paramName);
+    /* Set the parameter and readback in the parameter library.  This may be overwritten when we read back the
+     * status at the end, but that's OK */
+    status |= setDoubleParam(function, value);
+
+    /* The estimator parameters do not touch the camera */
+    if (function == PSEstAcquireTime) {
+        computeEstimate();
+        callParamCallbacks();
+        return((asynStatus)status);
+    }
+
+    /* The arrival offset is only used by the frame callback */
+    if (function == PSArrivalOffset) {
+        callParamCallbacks();
+        return((asynStatus)status);
+    }
+
+    /* Changing the configuration disarms the camera */
+    if (this->armed && !keepsArmed(function)) setArm(0);
+
+    if (function == ADAcquireTime) {
+        /* Prosilica uses integer microseconds */
+        status |= attrUint32Set("ExposureValue", (tPvUint32)(value * 1e6));
+    } else if (function == ADAcquirePeriod) {
+        /* Prosilica uses a frame rate in Hz */
+        if (value == 0.) value = .01;
+        status |= attrFloat32Set("FrameRate", (tPvFloat32)(1./value));
+    } else if (function == ADGain) {
+        /* Prosilica uses an integer value */
+        status |= attrUint32Set("GainValue", (tPvUint32)(value));
+    } else if (function == PSTriggerDelay) {
+        /* Prosilica uses integer microseconds */
+        status |= attrUint32Set("FrameStartTriggerDelay", (tPvUint32)(value*1e6));
+    } else if (function == PSStrobe1Delay) {
+        /* Prosilica uses integer microseconds */
+        status |= attrUint32Set("Strobe1Delay", (tPvUint32)(value*1e6));
+    } else if (function == PSStrobe1Duration) {
+        /* Prosilica uses integer microseconds */
+        status |= attrUint32Set("Strobe1Duration", (tPvUint32)(value*1e6));
+    } else if (function == PSSyncInPollPeriod) {
+        if (value < MIN_SYNC_IN_POLL_PERIOD) setDoubleParam(function, MIN_SYNC_IN_POLL_PERIOD);
+        /* Wake up the poller so the new period takes effect now */
+        epicsEventSignal(this->syncInPollEvent);
+    } else {
+        /* If this is not a parameter we have handled call the base class */
+        if (function < NUM_PS_PARAMS) status = ADDriver::writeFloat64(pasynUser, value);
+    }
+
+    /* Read the camera parameters and do callbacks */
+    status |= readParameters();
+    if (status) 
+        asynPrint(pasynUser, ASYN_TRACE_ERROR, 
+              "%s:%s: error, status=%d function=%d, name=%s, value=%f\n", 
+              driverName, functionName, status, function, paramName, value);
+    else        
+        asynPrint(pasynUser, ASYN_TRACEIO_DRIVER, 
+              "%s:%s: function=%d, name=%s, value=%f\n", 
+              driverName, functionName, function, paramName, value);
+    return((asynStatus)status);
+}
+
+/** Called when asyn clients call pasynInt32Array->write().
+  * Stores the level masks of the GPO program.
+  * \param[in] pasynUser pasynUser structure that encodes the reason and address.
+  * \param[in] value Pointer to the array to write.
+  * \param[in] nElements Number of elements to write. */
+asynStatus prosilica::writeInt32Array(asynUser *pasynUser, epicsInt32 *value, size_t nElements)
+{
+    int function = pasynUser->reason;
+    static const char *functionName = "writeInt32Array";
+
+    if (function != PSGpoProgramMasks) return ADDriver::writeInt32Array(pasynUser, value, nElements);
+    if (nElements > MAX_GPO_PROGRAM_STEPS) {
+        asynPrint(pasynUser, ASYN_TRACE_ERROR,
+              "%s:%s: too many GPO program steps %d, maximum is %d\n",
+              driverName, functionName, (int)nElements, MAX_GPO_PROGRAM_STEPS);
+        return asynError;
+    }
+    memcpy(this->gpoProgramMasks, value, nElements*sizeof(epicsInt32));
+    this->gpoProgramNumMasks = (int)nElements;
+    return asynSuccess;
+}
+
+/** Called when asyn clients call pasynFloat64Array->write().
+  * Stores the step times of the GPO program.
+  * \param[in] pasynUser pasynUser structure that encodes the reason and address.
+  * \param[in] value Pointer to the array to write.
+  * \param[in] nElements Number of elements to write. */
+asynStatus prosilica::writeFloat64Array(asynUser *pasynUser, epicsFloat64 *value, size_t nElements)
+{
+    int function = pasynUser->reason;
+    static const char *functionName = "writeFloat64Array";
+
+    if (function != PSGpoProgramTimes) return ADDriver::writeFloat64Array(pasynUser, value, nElements);
+    if (nElements > MAX_GPO_PROGRAM_STEPS) {
+        asynPrint(pasynUser, ASYN_TRACE_ERROR,
+              "%s:%s: too many GPO program steps %d, maximum is %d\n",
+              driverName, functionName, (int)nElements, MAX_GPO_PROGRAM_STEPS);
+        return asynError;
+    }
+    memcpy(this->gpoProgramTimes, value, nElements*sizeof(double));
+    this->gpoProgramNumTimes = (int)nElements;
+    return asynSuccess;
+}
+
+/** Called when asyn clients call pasynFloat64Array->read().
+  * Returns the timebase or a series of the stream health history, oldest sample first,
+  * or the latency of the slowest attributes.
+  * \param[in] pasynUser pasynUser structure that encodes the reason and address.
+  * \param[out] value Pointer to the array to read.
+  * \param[in] nElements Number of elements to read.
+  * \param[out] nIn Number of elements actually read. */
+asynStatus prosilica::readFloat64Array(asynUser *pasynUser, epicsFloat64 *value, size_t nElements, size_t *nIn)
+{
+    int function = pasynUser->reason;
+    int maxOut = (nElements > HISTORY_SIZE) ? HISTORY_SIZE : (int)nElements;
+
+    if ((function == PSAttrSlowMean) || (function == PSAttrSlowMax)) {
+        *nIn = (nElements > (size_t)this->numAttrSlow) ? this->numAttrSlow : nElements;
+        memcpy(value, (function == PSAttrSlowMean) ? this->attrSlowMean : this->attrSlowMax,
+               *nIn * sizeof(double));
+        return asynSuccess;
+    }
+    if ((function < FIRST_PS_HISTORY_PARAM) || (function > LAST_PS_HISTORY_PARAM))
+        return ADDriver::readFloat64Array(pasynUser, value, nElements, nIn);
+    if (function == PSHistoryTimebase) *nIn = psHistoryTimebase(&this->history, HISTORY_PERIOD, value, maxOut);
+    else *nIn = psHistoryRead(&this->history, function - PSHistoryFrameRate, value, maxOut);
+    return asynSuccess;
+}
+
+/** Report status of the driver.
+  * Prints details about the driver if details>0.
+  * It then calls the ADDriver::report() method.
+  * \param[in] fp File pointed passed by caller where the output is written to.
+  * \param[in] details If >0 then driver details are printed.
+  */
+void prosilica::report(FILE *fp, int details)
+{
+    tPvCameraInfoEx cameraInfo[20], *pInfo; 
+    int i;
+    unsigned long numReturned, numTotal, versionMajor, versionMinor;
+    
+    numReturned = PvCameraListEx(cameraInfo, 20, &numTotal, sizeof(tPvCameraInfoEx));
+
+    fprintf(fp, "Prosilica camera %s Unique ID=%d\n", 
+            this->portName, (int)this->uniqueId);
+    pInfo = &this->PvCameraInfo;
+    if (details > 0) {
+        PvVersion(&versionMajor, &versionMinor);
+        fprintf(fp, "  PvAPI version:     %ld.%ld\n", versionMajor, versionMinor);
+        fprintf(fp, "  ID:                %lu\n", pInfo->UniqueId);
+        fprintf(fp, "  IP address:        %s\n",  this->IPAddress);
+        fprintf(fp, "  Serial number:     %s\n",  pInfo->SerialNumber);
+        fprintf(fp, "  Camera name:       %s\n",  pInfo->CameraName);
+        fprintf(fp, "  Model:             %s\n",  pInfo->ModelName);
+        fprintf(fp, "  Firmware version:  %s\n",  pInfo->FirmwareVersion);
+        fprintf(fp, "  Access flags:      %lx\n", pInfo->PermittedAccess);
+        fprintf(fp, "  Sensor type:       %s\n",  this->sensorType);
+        fprintf(fp, "  Sensor bits:       %d\n",  (int)this->sensorBits);
+        fprintf(fp, "  Sensor width:      %d\n",  (int)this->sensorWidth);
+        fprintf(fp, "  Sensor height:     %d\n",  (int)this->sensorHeight);
+        fprintf(fp, "  Frame buffer size: %d\n",  (int)this->PvFrames[0].ImageBufferSize);
+        fprintf(fp, "  Time stamp freq:   %d\n",  (int)this->timeStampFrequency);
+        fprintf(fp, "  maxPvAPIFrames:    %d\n",  (int)this->maxPvAPIFrames_);
+        fprintf(fp, "\n");
+        reportThreads(fp);
+        fprintf(fp, "List of all Prosilica cameras found (total=%d):\n", (int)numReturned);
+        for (i=0; i<(int)numReturned; i++) {
+            pInfo = &cameraInfo[i];
+            fprintf(fp, "  ID:                %lu\n", pInfo->UniqueId);
+            fprintf(fp, "  Serial number:     %s\n",  pInfo->SerialNumber);
+            fprintf(fp, "  Camera name:       %s\n",  pInfo->CameraName);
+            fprintf(fp, "  Model:             %s\n",  pInfo->ModelName);
+            fprintf(fp, "  Firmware version:  %s\n",  pInfo->FirmwareVersion);
+            fprintf(fp, "  Access flags:      %lx\n", pInfo->PermittedAccess);
+            fprintf(fp, "\n");
+        }
+    }
+
+    /* Call the base class method */
+    ADDriver::report(fp, details);
+}
+
+
+/** Assigns a frame to the trigger set it belongs to and returns the sequence number of that set.
+  * A set is retired as incomplete as soon as every member still missing from it has delivered a
+  * later frame, so complete sets never wait for a timeout.
+  * \param[in] pGroup The acquisition group.
+  * \param[in] member Index of the camera which delivered the frame.
+  * \param[in] frameTime Frame time in seconds in the common group time base.
+  * \param[out] setsComplete Number of complete sets so far.
+  * \param[out] setsIncomplete Number of incomplete sets so far.
+  */
+static epicsInt32 groupMatchFrame(prosilicaGroup *pGroup, int member, double frameTime,
+                                  int *setsComplete, int *setsIncomplete)
+{
+    epicsUInt32 bit = 1 << member;
+    epicsUInt32 allMembers = (1 << pGroup->numMembers) - 1;
+    epicsUInt32 sequence;
+    groupSet *pSet = NULL;
+    double diff, bestDiff = pGroup->tolerance;
+    bool stale;
+    int i, j, k;
+
+    epicsMutexLock(pGroup->mutex);
+    pGroup->lastTime[member] = frameTime;
+
+    /* Find the closest open set which does not yet have a frame from this camera */
+    for (i=0; i<pGroup->numSets; i++) {
+        if (pGroup->sets[i].memberMask & bit) continue;
+        diff = fabs(pGroup->sets[i].time - frameTime);
+        if (diff <= bestDiff) {
+            bestDiff = diff;
+            pSet = &pGroup->sets[i];
+        }
+    }
+    if (!pSet) {
+        /* This is the first frame of a new trigger.  If too many sets are open the oldest
+         * one can no longer be completed. */
+        if (pGroup->numSets == MAX_GROUP_SETS) {
+            pGroup->setsIncomplete++;
+            for (i=1; i<pGroup->numSets; i++) pGroup->sets[i-1] = pGroup->sets[i];
+            pGroup->numSets--;
+        }
+        pSet = &pGroup->sets[pGroup->numSets++];
+        pSet->sequence = pGroup->nextSequence++;
+        pSet->time = frameTime;
+        pSet->memberMask = 0;
+    }
+    pSet->memberMask |= bit;
+    sequence = pSet->sequence;
+    if ((epicsInt32)sequence > pGroup->lastSequence[member]) pGroup->lastSequence[member] = sequence;
+
+    /* Retire complete sets, and sets where every missing camera has already moved past them */
+    for (i=0, j=0; i<pGroup->numSets; i++) {
+        pSet = &pGroup->sets[i];
+        if (pSet->memberMask == allMembers) {
+            pGroup->setsComplete++;
+            continue;
+        }
+        stale = true;
+        for (k=0; k<pGroup->numMembers; k++) {
+            if (pSet->memberMask & (1 << k)) continue;
+            if (pGroup->lastTime[k] <= pSet->time + pGroup->tolerance) {
+                stale = false;
+                break;
+            }
+        }
+        if (stale) {
+            pGroup->setsIncomplete++;
+            continue;
+        }
+        pGroup->sets[j++] = *pSet;
+    }
+    pGroup->numSets = j;
+    *setsComplete = pGroup->setsComplete;
+    *setsIncomplete = pGroup->setsIncomplete;
+    epicsMutexUnlock(pGroup->mutex);
+    return (epicsInt32)sequence;
+}
+
+
+/** Returns the estimated number of frames a member camera is holding in its memory.
+  * This is the number of triggers the group has seen from other members since the
+  * last frame this member delivered. */
+static int groupHeldFrames(prosilicaGroup *pGroup, int member)
+{
+    int held;
+
+    epicsMutexLock(pGroup->mutex);
+    held = (int)pGroup->nextSequence - 1 - pGroup->lastSequence[member];
+    epicsMutexUnlock(pGroup->mutex);
+    return (held > 0) ? held : 0;
+}
+
+
+/** Holds or releases frames in camera memory; called with the lock held */
+asynStatus prosilica::setStreamHold(int enable)
+{
+    if (!this->PvHandle) return asynError;
+    return((asynStatus)attrEnumSet("StreamHoldEnable", enable ? "On" : "Off"));
+}
+
+
+/** Enables or disables the StreamHold coordinator of an acquisition group.
+  * When enabled every member holds its frames and streams at the full link rate while it is
+  * released.  When disabled every member is released and gets its previous stream rate back.
+  * This must be called without holding the lock of any member.
+  * \param[in] pGroup The acquisition group.
+  * \param[in] enable 1 to enable the coordinator, 0 to disable it.
+  * \param[in] linkRate Bytes/second available on the link shared by the cameras.
+  */
+asynStatus prosilica::groupStreamHold(prosilicaGroup *pGroup, int enable, int linkRate)
+{
+    int status = asynSuccess;
+    prosilica *pCamera;
+    int capacity;
+    bool starting;
+    int i;
+
+    if (linkRate <= 0) linkRate = DEFAULT_LINK_RATE;
+    epicsMutexLock(pGroup->mutex);
+    starting = enable && !pGroup->holdEnable;
+    pGroup->holdEnable = enable;
+    pGroup->holdLinkRate = linkRate;
+    epicsMutexUnlock(pGroup->mutex);
+
+    for (i=0; i<pGroup->numMembers; i++) {
+        pCamera = pGroup->pMembers[i];
+        pCamera->lock();
+        pCamera->getIntegerParam(pCamera->PSStreamHoldCapacity, &capacity);
+        if (!capacity) {
+            asynPrint(pCamera->pasynUserSelf, ASYN_TRACE_ERROR,
+                "%s:groupStreamHold: camera %s does not support StreamHold\n",
+                driverName, pCamera->portName);
+            status |= asynError;
+        } else if (pCamera->PvHandle) {
+            if (starting) pCamera->attrUint32Get("StreamBytesPerSecond", &pCamera->savedByteRate);
+            if (enable) {
+                status |= pCamera->attrUint32Set("StreamBytesPerSecond", linkRate);
+            } else if (pCamera->savedByteRate) {
+                status |= pCamera->attrUint32Set("StreamBytesPerSecond", pCamera->savedByteRate);
+            }
+            status |= pCamera->setStreamHold(enable);
+        }
+        pCamera->setIntegerParam(pCamera->PSStreamHold, enable);
+        pCamera->setIntegerParam(pCamera->PSStreamHoldLinkRate, linkRate);
+        if (!enable) pCamera->setIntegerParam(pCamera->PSStreamHoldFrames, 0);
+        pCamera->callParamCallbacks();
+        pCamera->unlock();
+    }
+    epicsEventSignal(pGroup->holdEvent);
+    return((asynStatus)status);
+}
+
+
+static void streamHoldTaskC(void *drvPvt)
+{
+    prosilica::streamHoldTask((prosilicaGroup *)drvPvt);
+}
+
+
+/** The StreamHold coordinator of an acquisition group.
+  * While enabled the members hold their frames in camera memory, and are released one at a time
+  * in round-robin order.  Each member is released for long enough to drain the frames it holds
+  * at the link rate, so cameras triggered together never burst onto the link at the same time.
+  */
+void prosilica::streamHoldTask(prosilicaGroup *pGroup)
+{
+    prosilica *pCamera;
+    int member = 0;
+    int enable, linkRate, capacity, held;
+    tPvUint32 payload;
+    double slot;
+    int i;
+
+    while (1) {
+        epicsMutexLock(pGroup->mutex);
+        enable = pGroup->holdEnable;
+        linkRate = pGroup->holdLinkRate;
+        epicsMutexUnlock(pGroup->mutex);
+        if (!enable) {
+            epicsEventWait(pGroup->holdEvent);
+            continue;
+        }
+
+        /* Publish the estimated occupancy of every member */
+        for (i=0; i<pGroup->numMembers; i++) {
+            pCamera = pGroup->pMembers[i];
+            held = groupHeldFrames(pGroup, i);
+            pCamera->lock();
+            pCamera->getIntegerParam(pCamera->PSStreamHoldCapacity, &capacity);
+            if (held > capacity) held = capacity;
+            pCamera->setIntegerParam(pCamera->PSStreamHoldFrames, held);
+            pCamera->callParamCallbacks();
+            pCamera->unlock();
+        }
+
+        /* Release the next member for long enough to send what it holds plus one more frame */
+        pCamera = pGroup->pMembers[member];
+        held = groupHeldFrames(pGroup, member);
+        pCamera->lock();
+        /* The slot is sized from the camera payload, not the processed NDArraySize */
+        payload = pCamera->payloadSize;
+        pCamera->setStreamHold(0);
+        pCamera->unlock();
+        slot = (held + 1) * (double)payload / linkRate * STREAM_HOLD_MARGIN;
+        if (slot < STREAM_HOLD_MIN_SLOT) slot = STREAM_HOLD_MIN_SLOT;
+        epicsEventWaitWithTimeout(pGroup->holdEvent, slot);
+
+        /* Hold again, unless the coordinator was disabled while this member was released */
+        pCamera->lock();
+        epicsMutexLock(pGroup->mutex);
+        if (pGroup->holdEnable) pCamera->setStreamHold(1);
+        epicsMutexUnlock(pGroup->mutex);
+        pCamera->unlock();
+        member = (member + 1) % pGroup->numMembers;
+    }
+}
+
+
+/** Starts or stops acquisition on all cameras in an acquisition group.
+  * The camera timers are reset back to back before starting so that frame times from all cameras
+  * share a common origin.  This must be called without holding the lock of any member.
+  * \param[in] pGroup The acquisition group.
+  * \param[in] value 1 to start acquisition, 0 to stop it.
+  */
+asynStatus prosilica::groupStart(prosilicaGroup *pGroup, int value)
+{
+    int status = asynSuccess;
+    prosilica *pCamera;
+    int i;
+
+    if (value) {
+        /* Forget about frames from any previous acquisition */
+        epicsMutexLock(pGroup->mutex);
+        pGroup->numSets = 0;
+        pGroup->nextSequence = 0;
+        pGroup->setsComplete = 0;
+        pGroup->setsIncomplete = 0;
+        for (i=0; i<pGroup->numMembers; i++) {
+            pGroup->lastTime[i] = 0.;
+            pGroup->lastSequence[i] = -1;
+        }
+        epicsMutexUnlock(pGroup->mutex);
+
+        for (i=0; i<pGroup->numMembers; i++) {
+            pCamera = pGroup->pMembers[i];
+            pCamera->lock();
+            status |= pCamera->syncTimer();
+            pCamera->unlock();
+        }
+    }
+    for (i=0; i<pGroup->numMembers; i++) {
+        pCamera = pGroup->pMembers[i];
+        pCamera->lock();
+        status |= pCamera->setAcquire(value);
+        pCamera->setIntegerParam(pCamera->ADAcquire, value);
+        pCamera->setIntegerParam(pCamera->PSGroupAcquire, value);
+        pCamera->setIntegerParam(pCamera->PSGroupSequence, 0);
+        pCamera->callParamCallbacks();
+        pCamera->unlock();
+    }
+    return((asynStatus)status);
+}
+
+
+/** Returns the camera with the given asyn port name, or NULL if there is none */
+static prosilica *findCamera(const char *portName)
+{
+    cameraNode *pNode;
+
+    if (!cameraList || !portName) return NULL;
+    for (pNode = (cameraNode *)ellFirst(cameraList); pNode; pNode = (cameraNode *)ellNext(&pNode->node)) {
+        if (strcmp(pNode->pCamera->portName, portName) == 0) return pNode->pCamera;
+    }
+    return NULL;
+}
+
+
+/** Creates an acquisition group from cameras which have already been configured.
+  * \param[in] groupName The name of the group.
+  * \param[in] portNames Asyn port names of the member cameras, separated by spaces or commas.
+  * \param[in] tolerance Maximum difference in seconds between frame times of the same trigger.
+  */
+asynStatus prosilica::createGroup(const char *groupName, const char *portNames, double tolerance)
+{
+    prosilicaGroup *pGroup;
+    prosilica *pMembers[MAX_GROUP_CAMERAS];
+    prosilica *pCamera;
+    char *names, *name, *last;
+    int numMembers=0;
+    int i;
+    static const char *functionName = "createGroup";
+
+    if (!groupName || !portNames || !cameraList) {
+        printf("%s:%s: group name and camera port names must be given\n", driverName, functionName);
+        return asynError;
+    }
+    names = epicsStrDup(portNames);
+    for (name = epicsStrtok_r(names, " ,", &last); name; name = epicsStrtok_r(NULL, " ,", &last)) {
+        pCamera = findCamera(name);
+        if (!pCamera) {
+            printf("%s:%s: camera port %s not found\n", driverName, functionName, name);
+            free(names);
+            return asynError;
+        }
+        if (pCamera->pGroup) {
+            printf("%s:%s: camera port %s is already in group %s\n", 
+                   driverName, functionName, name, pCamera->pGroup->name);
+            free(names);
+            return asynError;
+        }
+        if (numMembers == MAX_GROUP_CAMERAS) {
+            printf("%s:%s: too many cameras, maximum=%d\n", driverName, functionName, MAX_GROUP_CAMERAS);
+            free(names);
+            return asynError;
+        }
+        pMembers[numMembers++] = pCamera;
+    }
+    free(names);
+    if (numMembers == 0) {
+        printf("%s:%s: no cameras given for group %s\n", driverName, functionName, groupName);
+        return asynError;
+    }
+
+    pGroup = (prosilicaGroup *)callocMustSucceed(1, sizeof(prosilicaGroup), functionName);
+    pGroup->name = epicsStrDup(groupName);
+    pGroup->tolerance = (tolerance > 0.) ? tolerance : DEFAULT_GROUP_TOLERANCE;
+    pGroup->mutex = epicsMutexMustCreate();
+    pGroup->holdEvent = epicsEventMustCreate(epicsEventEmpty);
+    pGroup->holdLinkRate = DEFAULT_LINK_RATE;
+    for (i=0; i<numMembers; i++) pGroup->lastSequence[i] = -1;
+    pGroup->numMembers = numMembers;
+    for (i=0; i<numMembers; i++) {
+        pCamera = pMembers[i];
+        pGroup->pMembers[i] = pCamera;
+        pCamera->lock();
+        pCamera->pGroup = pGroup;
+        pCamera->groupMember = i;
+        pCamera->setStringParam(pCamera->PSGroupName, pGroup->name);
+        pCamera->callParamCallbacks();
+        pCamera->unlock();
+    }
+    if (!groupList) {
+        groupList = new ELLLIST;
+        ellInit(groupList);
+    }
+    ellAdd(groupList, (ELLNODE *)pGroup);
+
+    /* The StreamHold coordinator waits until it is enabled */
+    if (!epicsThreadCreate("prosilicaHold", epicsThreadPriorityMedium,
+                           epicsThreadGetStackSize(epicsThreadStackMedium),
+                           (EPICSTHREADFUNC)streamHoldTaskC, pGroup)) {
+        printf("%s:%s: epicsThreadCreate failure for StreamHold task\n", driverName, functionName);
+        return asynError;
+    }
+    return asynSuccess;
+}
+
+
+static int compareDoubles(const void *p1, const void *p2)
+{
+    double d1 = *(const double *)p1, d2 = *(const double *)p2;
+
+    return (d1 < d2) ? -1 : ((d1 > d2) ? 1 : 0);
+}
+
+
+/** Returns a percentile of the recent frame latencies, or 0 if there are none; called with the lock held.
+  * \param[in] fraction The percentile as a fraction, e.g. 0.99. */
+double prosilica::latencyPercentile(double fraction, int maxFrames)
+{
+    double sorted[LATENCY_RING_SIZE];
+    int n = (this->numFrameLatency < LATENCY_RING_SIZE) ? (int)this->numFrameLatency : LATENCY_RING_SIZE;
+    int i;
+
+    if (n > maxFrames) n = maxFrames;
+    if (n <= 0) return 0.;
+    /* The newest n latencies */
+    for (i=0; i<n; i++) sorted[i] = this->frameLatency[(this->numFrameLatency - n + i) % LATENCY_RING_SIZE];
+    qsort(sorted, n, sizeof(double), compareDoubles);
+    return sorted[(int)(fraction*(n-1) + 0.5)];
+}
+
+
+/** One soak test cycle: change the geometry, the pixel format and the Bayer conversion,
+  * acquire for most of the cycle period, and drop the link every SOAK_LINK_DROP_CYCLES cycles.
+  * Called without the lock held. */
+void prosilica::soakCycle(int cycle)
+{
+    int dataType;
+
+    this->lock();
+    setIntegerParam(ADBinX, (cycle & 1) ? 2 : 1);
+    setIntegerParam(ADBinY, (cycle & 1) ? 2 : 1);
+    setGeometry();
+    getIntegerParam(NDDataType, &dataType);
+    setIntegerParam(NDDataType, (dataType == NDUInt8) ? NDUInt16 : NDUInt8);
+    setPixelFormat();
+    setIntegerParam(PSBayerConvert, cycle % NUM_BAYER_CONVERT_MODES);
+    readParameters();
+    setIntegerParam(ADAcquire, 1);
+    setAcquire(1);
+    callParamCallbacks();
+    this->unlock();
+
+    epicsThreadSleep(0.8 * this->soakCyclePeriod);
+
+    this->lock();
+    setIntegerParam(ADAcquire, 0);
+    setAcquire(0);
+    if ((cycle % SOAK_LINK_DROP_CYCLES) == SOAK_LINK_DROP_CYCLES-1) {
+        disconnectCamera();
+        connectCamera();
+    }
+    callParamCallbacks();
+    this->unlock();
+}
+
+
+static void soakTaskC(void *drvPvt)
+{
+    prosilica *pPvt = (prosilica *)drvPvt;
+
+    pPvt->soakTask();
+}
+
+
+typedef struct {
+    double time;
+    double value[5];
+} soakSample;
+
+static const char *soakMetricNames[] = {"RSS", "NDArrayPool memory", "threads", "latency p50", "latency p99"};
+#define NUM_SOAK_METRICS (int)(sizeof(soakMetricNames) / sizeof(soakMetricNames[0]))
+
+/** Runs the soak test.  Each cycle exercises the driver and then samples the RSS, the
+  * NDArrayPool memory, the number of threads and the frame latency percentiles.
+  * At the end a straight line is fitted to each metric after the warm-up, and the test
+  * fails if the fitted growth over the run is more than soakTolerance times the mean value. */
+void prosilica::soakTask()
+{
+    soakSample *pSamples = NULL;
+    int numSamples = 0, maxSamples = 0;
+    epicsTimeStamp start, now;
+    epicsUInt64 rss = 0;
+    int threads = 0;
+    int cycle, first, i, m;
+    int imageMode, binX, binY, dataType, bayerConvert;
+    double elapsed, sumT, sumY, sumTT, sumTY, n, slope, mean, growth, minGrowth;
+    char message[256];
+    int failed = 0;
+    static const char *functionName = "soakTask";
+
+    /* Save the settings which are changed by the cycles */
+    this->lock();
+    getIntegerParam(ADImageMode, &imageMode);
+    getIntegerParam(ADBinX, &binX);
+    getIntegerParam(ADBinY, &binY);
+    getIntegerParam(NDDataType, &dataType);
+    getIntegerParam(PSBayerConvert, &bayerConvert);
+    /* The camera mode is read back by every cycle, so it must be set in the camera */
+    setIntegerParam(ADImageMode, ADImageContinuous);
+    setImageMode(ADImageContinuous);
+    setIntegerParam(PSSoakState, PSSoakRunning);
+    setStringParam(PSSoakMessage, "Running");
+    callParamCallbacks();
+    this->unlock();
+
+    epicsTimeGetCurrent(&start);
+    for (cycle=0; !this->soakAbort; cycle++) {
+        soakCycle(cycle);
+        epicsTimeGetCurrent(&now);
+        elapsed = epicsTimeDiffInSeconds(&now, &start);
+        if (numSamples == maxSamples) {
+            soakSample *pNew;
+            maxSamples = maxSamples ? 2*maxSamples : 256;
+            pNew = (soakSample *)realloc(pSamples, maxSamples*sizeof(soakSample));
+            if (!pNew) break;
+            pSamples = pNew;
+        }
+        psHostReadProcessStatus(NULL, &rss, &threads);
+        this->lock();
+        pSamples[numSamples].time = elapsed;
+        pSamples[numSamples].value[0] = (double)rss;
+        pSamples[numSamples].value[1] = (double)this->pNDArrayPool->getMemorySize();
+        pSamples[numSamples].value[2] = threads;
+        pSamples[numSamples].value[3] = latencyPercentile(0.5);
+        pSamples[numSamples].value[4] = latencyPercentile(0.99);
+        numSamples++;
+        epicsSnprintf(message, sizeof(message), "Cycle %d, %.1f hours", cycle+1, elapsed/3600.);
+        setStringParam(PSSoakMessage, message);
+        callParamCallbacks();
+        this->unlock();
+        asynPrint(this->pasynUserSelf, ASYN_TRACE_FLOW,
+            "%s:%s: cycle %d RSS=%.0f pool=%.0f threads=%d p50=%f p99=%f\n",
+            driverName, functionName, cycle+1, pSamples[numSamples-1].value[0],
+            pSamples[numSamples-1].value[1], threads,
+            pSamples[numSamples-1].value[3], pSamples[numSamples-1].value[4]);
+        if (elapsed >= this->soakEndTime) break;
+    }
+
+    /* Fit the trends */
+    strcpy(message, "Passed");
+    first = (int)(numSamples * SOAK_WARMUP_FRACTION);
+    if (first < 1) first = 1;
+    if (numSamples - first < SOAK_MIN_SAMPLES) {
+        epicsSnprintf(message, sizeof(message), "Failed: too few samples to fit trends, %d", numSamples);
+        failed = 1;
+    }
+    for (m=0; (m<NUM_SOAK_METRICS) && !failed; m++) {
+        sumT = sumY = sumTT = sumTY = 0.;
+        n = numSamples - first;
+        for (i=first; i<numSamples; i++) {
+            sumT  += pSamples[i].time;
+            sumY  += pSamples[i].value[m];
+            sumTT += pSamples[i].time * pSamples[i].time;
+            sumTY += pSamples[i].time * pSamples[i].value[m];
+        }
+        slope = (n*sumTY - sumT*sumY) / (n*sumTT - sumT*sumT);
+        mean = sumY / n;
+        growth = slope * (pSamples[numSamples-1].time - pSamples[first].time);
+        switch (m) {
+            case 0:  minGrowth = SOAK_RSS_FLOOR; break;
+            case 1:  minGrowth = (double)this->maxFrameSize; break;
+            case 2:  minGrowth = 0.5; break;
+            default: minGrowth = SOAK_LATENCY_FLOOR; break;
+        }
+        if (growth > this->soakTolerance * mean + minGrowth) {
+            epicsSnprintf(message, sizeof(message), "Failed: %s grew by %g (mean %g)",
+                          soakMetricNames[m], growth, mean);
+            failed = 1;
+        }
+    }
+    free(pSamples);
+
+    /* Restore the settings */
+    this->lock();
+    setIntegerParam(ADImageMode, imageMode);
+    setImageMode(imageMode);
+    setIntegerParam(ADBinX, binX);
+    setIntegerParam(ADBinY, binY);
+    setGeometry();
+    setIntegerParam(NDDataType, dataType);
+    setPixelFormat();
+    setIntegerParam(PSBayerConvert, bayerConvert);
+    readParameters();
+    setIntegerParam(PSSoakState, failed ? PSSoakFailed : PSSoakPassed);
+    setStringParam(PSSoakMessage, message);
+    this->soakRunning = 0;
+    callParamCallbacks();
+    this->unlock();
+    printf("%s:%s: soak test on %s %s\n", driverName, functionName, this->portName, message);
+}
+
+
+/** Starts or stops a soak test on a camera.
+  * \param[in] portName The asyn port name of the camera.
+  * \param[in] hours Duration of the test; 0 stops a running test.
+  * \param[in] cyclePeriod Time in seconds for each cycle of the test.
+  * \param[in] tolerance Allowed growth of each metric over the test, as a fraction of its mean.
+  */
+asynStatus prosilica::startSoak(const char *portName, double hours, double cyclePeriod, double tolerance)
+{
+    prosilica *pCamera = findCamera(portName);
+    static const char *functionName = "startSoak";
+
+    if (!pCamera) {
+        printf("%s:%s: camera port %s not found\n", driverName, functionName, portName ? portName : "");
+        return asynError;
+    }
+    pCamera->lock();
+    if (hours <= 0.) {
+        pCamera->soakAbort = 1;
+        pCamera->unlock();
+        return asynSuccess;
+    }
+    if (pCamera->soakRunning) {
+        pCamera->unlock();
+        printf("%s:%s: a soak test is already running on %s\n", driverName, functionName, portName);
+        return asynError;
+    }
+    /* The soak test reads the metrics, which the synthetic frames would change */
+    if (pCamera->stressRunning || pCamera->headroomRunning) {
+        pCamera->unlock();
+        printf("%s:%s: a stress test or headroom benchmark is running on %s\n",
+               driverName, functionName, portName);
+        return asynError;
+    }
+    pCamera->soakEndTime = hours * 3600.;
+    pCamera->soakCyclePeriod = (cyclePeriod > 0.) ? cyclePeriod : 10.;
+    pCamera->soakTolerance = (tolerance > 0.) ? tolerance : 0.05;
+    pCamera->soakAbort = 0;
+    pCamera->soakRunning = 1;
+    pCamera->unlock();
+    if (!epicsThreadCreate("prosilicaSoak", epicsThreadPriorityLow,
+                           epicsThreadGetStackSize(epicsThreadStackMedium),
+                           (EPICSTHREADFUNC)soakTaskC, pCamera)) {
+        printf("%s:%s: epicsThreadCreate failure for soak test\n", driverName, functionName);
+        pCamera->soakRunning = 0;
+        return asynError;
+    }
+    return asynSuccess;
+}
+
+
+static void stressTaskC(void *drvPvt)
+{
+    prosilica *pPvt = (prosilica *)drvPvt;
+
+    pPvt->stressTask();
+}
+
+static void stressFrameTaskC(void *drvPvt)
+{
+    prosilica *pPvt = (prosilica *)drvPvt;
+
+    pPvt->stressFrameTask();
+}
+
+static void stressWriteTaskC(void *drvPvt)
+{
+    prosilica *pPvt = (prosilica *)drvPvt;
+
+    pPvt->stressWriteTask();
+}
+
+/** A write of the stress test, queued to the port thread like the write of a record */
+typedef struct stressWrite {
+    asynInt32 *pInt32;
+    void *int32Pvt;
+    epicsInt32 value;
+    epicsUInt64 queued;            /* epicsMonotonicGet() when the request was queued */
+    epicsUInt64 started;           /* epicsMonotonicGet() when the port thread took it */
+    epicsEventId done;
+} stressWrite;
+
+/* Called in the port thread by asynManager */
+static void stressWriteCallbackC(asynUser *pasynUser)
+{
+    stressWrite *pWrite = (stressWrite *)pasynUser->userPvt;
+
+    pWrite->started = epicsMonotonicGet();
+    pWrite->pInt32->write(pWrite->int32Pvt, pasynUser, pWrite->value);
+    epicsEventSignal(pWrite->done);
+}
+
+static void stressLinkTaskC(void *drvPvt)
+{
+    prosilica *pPvt = (prosilica *)drvPvt;
+
+    pPvt->stressLinkTask();
+}
+
+/** Called by each stress test thread as it finishes */
+void prosilica::stressThreadDone()
+{
+    if (epicsAtomicDecrIntT(&this->stressThreads) == 0) epicsEventSignal(this->stressDoneEvent);
+}
+
+/** Stress test thread which injects synthetic frames as fast as the frame callback takes them */
+void prosilica::stressFrameTask()
+{
+    while (!epicsAtomicGetIntT(&this->stressStop)) {
+        if (injectFrame(this->stressWidth, this->stressHeight, ePvFmtMono8)) {
+            epicsAtomicIncrSizeT(&this->stressNoFrame);
+            epicsThreadSleep(0.001);
+            continue;
+        }
+        epicsAtomicIncrSizeT(&this->stressFrames);
+    }
+    stressThreadDone();
+}
+
+/** Stress test thread which writes the parameters of a region through the asynInt32 interface.
+  * The writes are queued to the port thread and wait for it, as the writes of records do.
+  * The regions are used because they are read by every frame and alternate between the
+  * zero-copy arrays and copies, without touching the camera. */
+void prosilica::stressWriteTask()
+{
+    int index = epicsAtomicIncrIntT(&this->stressNextWriter) - 1;
+    int addr = 1 + index % NUM_REGIONS;
+    asynUser *pasynUser;
+    asynInterface *pInterface;
+    stressWrite write;
+    epicsInt32 value;
+    double wait;
+    int n;
+
+    pasynUser = pasynManager->createAsynUser(stressWriteCallbackC, 0);
+    pasynUser->userPvt = &write;
+    pasynUser->timeout = 1.0;
+    if ((pasynManager->connectDevice(pasynUser, this->portName, addr) != asynSuccess) ||
+        ((pInterface = pasynManager->findInterface(pasynUser, asynInt32Type, 1)) == NULL)) {
+        printf("%s:stressWriteTask: cannot connect to %s address %d\n", driverName, this->portName, addr);
+        pasynManager->disconnect(pasynUser);
+        pasynManager->freeAsynUser(pasynUser);
+        stressThreadDone();
+        return;
+    }
+    write.pInt32 = (asynInt32 *)pInterface->pinterface;
+    write.int32Pvt = pInterface->drvPvt;
+    write.done = epicsEventMustCreate(epicsEventEmpty);
+    for (n=0; !epicsAtomicGetIntT(&this->stressStop); n++) {
+        switch (n % 4) {
+            case 0:
+                pasynUser->reason = PSRegionEnable;
+                value = ((n/4) % 4) != 3;
+                break;
+            case 1:
+                pasynUser->reason = PSRegionMinX;
+                value = (n * 7) % 64;
+                break;
+            case 2:
+                pasynUser->reason = PSRegionSizeX;
+                value = 16 + (n * 13) % 64;
+                break;
+            default:
+                /* Single rows are zero-copy */
+                pasynUser->reason = PSRegionSizeY;
+                value = ((n/4) & 1) ? 1 : 32;
+                break;
+        }
+        write.value = value;
+        write.queued = epicsMonotonicGet();
+        if (pasynManager->queueRequest(pasynUser, asynQueuePriorityMedium, 0.) != asynSuccess) {
+            /* The region addresses stay connected, so this only happens if the port is disabled */
+            epicsThreadSleep(0.01);
+            continue;
+        }
+        epicsEventMustWait(write.done);
+        /* The wait in the queue includes the wait for the port lock of the port thread */
+        wait = (write.started - write.queued) * 1e-9;
+        this->lock();
+        this->stressWaitSum += wait;
+        if (wait > this->stressWaitMax) this->stressWaitMax = wait;
+        this->unlock();
+        epicsAtomicIncrSizeT(&this->stressWrites);
+    }
+    pasynManager->disconnect(pasynUser);
+    pasynManager->freeAsynUser(pasynUser);
+    epicsEventDestroy(write.done);
+    stressThreadDone();
+}
+
+/** Stress test thread which removes and adds the camera through the PvAPI link callback */
+void prosilica::stressLinkTask()
+{
+    double slept;
+
+    while (!epicsAtomicGetIntT(&this->stressStop)) {
+        for (slept=0.; (slept < this->stressLinkPeriod) && !epicsAtomicGetIntT(&this->stressStop); slept += 0.1)
+            epicsThreadSleep(0.1);
+        if (epicsAtomicGetIntT(&this->stressStop)) break;
+        cameraLinkCallback(NULL, ePvInterfaceEthernet, ePvLinkRemove, this->uniqueId);
+        /* Frames and writes carry on while the camera is away */
+        epicsThreadSleep(this->stressLinkPeriod / 4.);
+        cameraLinkCallback(NULL, ePvInterfaceEthernet, ePvLinkAdd, this->uniqueId);
+        epicsAtomicAddSizeT(&this->stressLinkEvents, 2);
+    }
+    stressThreadDone();
+}
+
+/** Counts the arrays which the driver holds: the last array of each address and the buffers of
+  * the PvAPI and synthetic frames.  Returns the arrays of the driver pool, including the frames
+  * which are only reserved by a held region view, and sets *pViews to the region views of
+  * pViewPool; called with the lock held */
+int prosilica::heldArrays(int *pViews)
+{
+    NDArray *parents[NUM_REGIONS];
+    NDArray *pParent;
+    int numParents = 0;
+    int held = 0;
+    int i, j;
+
+    *pViews = 0;
+    for (i=0; i<=NUM_REGIONS; i++) {
+        if (!this->pArrays[i]) continue;
+        if (this->pArrays[i]->pNDArrayPool != this->pViewPool) {
+            held++;
+            continue;
+        }
+        (*pViews)++;
+        /* Each frame is counted once, however many views reserve it */
+        pParent = ((psViewArray *)this->pArrays[i])->pParent;
+        if (!pParent || (pParent == this->pArrays[0])) continue;
+        for (j=0; (j<numParents) && (parents[j] != pParent); j++) ;
+        if (j == numParents) parents[numParents++] = pParent;
+    }
+    held += numParents;
+    for (i=0; i<maxPvAPIFrames_; i++) {
+        if (this->PvFrames[i].Context[1]) held++;
+    }
+    for (i=0; i<NUM_SYNTH_FRAMES; i++) {
+        if (this->synthFrames[i].Context[1]) held++;
+    }
+    return held;
+}
+
+/** Runs the stress test.  Synthetic frames, region writes and link events hammer the port lock
+  * together for stressSeconds.  The run ends like an IOC shutdown, with the camera removed while
+  * the other threads are still running.  The test then checks that no arrays were lost or
+  * released twice, and that every frame was counted once. */
+void prosilica::stressTask()
+{
+    int regionSave[NUM_REGIONS][4];
+    int counterStart, counterEnd, discardedStart, discardedEnd, badStart, badEnd;
+    int inUseStart, inUseEnd, heldStart, heldEnd, doubleStart, doubles;
+    int viewsStart, viewsEnd, heldViewsStart, heldViewsEnd;
+    size_t metricStart, metricEnd, frames, writes;
+    int sizeX, sizeY, binX, binY, inUse, stable, numThreads, addr, i;
+    double elapsed, waited;
+    epicsTimeStamp start, end;
+    char threadName[32];
+    int failed = 0;
+    static const char *functionName = "stressTask";
+
+    this->lock();
+    for (addr=1; addr<=NUM_REGIONS; addr++) {
+        getIntegerParam(addr, PSRegionEnable, &regionSave[addr-1][0]);
+        getIntegerParam(addr, PSRegionMinX,   &regionSave[addr-1][1]);
+        getIntegerParam(addr, PSRegionSizeX,  &regionSave[addr-1][2]);
+        getIntegerParam(addr, PSRegionSizeY,  &regionSave[addr-1][3]);
+    }
+    getIntegerParam(ADSizeX, &sizeX);
+    getIntegerParam(ADSizeY, &sizeY);
+    getIntegerParam(ADBinX, &binX);
+    getIntegerParam(ADBinY, &binY);
+    this->stressWidth  = ((sizeX > 0) && (binX > 0)) ? sizeX/binX : 640;
+    this->stressHeight = ((sizeY > 0) && (binY > 0)) ? sizeY/binY : 480;
+    getIntegerParam(NDArrayCounter, &counterStart);
+    getIntegerParam(PSGateDiscarded, &discardedStart);
+    getIntegerParam(PSBadFrameCounter, &badStart);
+    metricStart = epicsAtomicGetSizeT(&this->metrics.values[PSMetricFrames]);
+    inUseStart = this->pNDArrayPool->getNumBuffers() - this->pNDArrayPool->getNumFree();
+    viewsStart = this->pViewPool->getNumBuffers() - this->pViewPool->getNumFree();
+    heldStart = heldArrays(&heldViewsStart);
+    doubleStart = epicsAtomicGetIntT(&this->pNumaPool->doubleReleases);
+    this->stressFrames = this->stressWrites = this->stressLinkEvents = this->stressNoFrame = 0;
+    this->stressWaitSum = this->stressWaitMax = 0.;
+    this->stressNextWriter = 0;
+    this->unlock();
+
+    numThreads = STRESS_FRAME_THREADS + this->stressWriters + ((this->stressLinkPeriod > 0.) ? 1 : 0);
+    epicsAtomicSetIntT(&this->stressThreads, numThreads);
+    epicsTimeGetCurrent(&start);
+    for (i=0; i<numThreads; i++) {
+        EPICSTHREADFUNC pFunc;
+        if (i < STRESS_FRAME_THREADS) {
+            epicsSnprintf(threadName, sizeof(threadName), "prosilicaStressF%d", i);
+            pFunc = (EPICSTHREADFUNC)stressFrameTaskC;
+        } else if (i < STRESS_FRAME_THREADS + this->stressWriters) {
+            epicsSnprintf(threadName, sizeof(threadName), "prosilicaStressW%d", i - STRESS_FRAME_THREADS);
+            pFunc = (EPICSTHREADFUNC)stressWriteTaskC;
+        } else {
+            epicsSnprintf(threadName, sizeof(threadName), "prosilicaStressL");
+            pFunc = (EPICSTHREADFUNC)stressLinkTaskC;
+        }
+        if (!epicsThreadCreate(threadName, epicsThreadPriorityMedium,
+                               epicsThreadGetStackSize(epicsThreadStackMedium), pFunc, this)) {
+            printf("%s:%s: epicsThreadCreate failure for %s\n", driverName, functionName, threadName);
+            failed = 1;
+            stressThreadDone();
+        }
+    }
+
+    for (elapsed=0.; (elapsed < this->stressSeconds) && !epicsAtomicGetIntT(&this->stressStop); elapsed += 0.1)
+        epicsThreadSleep(0.1);
+    if (this->stressLinkPeriod > 0.) {
+        cameraLinkCallback(NULL, ePvInterfaceEthernet, ePvLinkRemove, this->uniqueId);
+        epicsAtomicIncrSizeT(&this->stressLinkEvents);
+    }
+    epicsAtomicSetIntT(&this->stressStop, 1);
+    epicsEventWait(this->stressDoneEvent);
+    epicsTimeGetCurrent(&end);
+    elapsed = epicsTimeDiffInSeconds(&end, &start);
+    if (this->stressLinkPeriod > 0.) {
+        cameraLinkCallback(NULL, ePvInterfaceEthernet, ePvLinkAdd, this->uniqueId);
+        epicsAtomicIncrSizeT(&this->stressLinkEvents);
+    }
+
+    /* Restore the regions and give back the synthetic frame buffers */
+    this->lock();
+    for (addr=1; addr<=NUM_REGIONS; addr++) {
+        setIntegerParam(addr, PSRegionEnable, regionSave[addr-1][0]);
+        setIntegerParam(addr, PSRegionMinX,   regionSave[addr-1][1]);
+        setIntegerParam(addr, PSRegionSizeX,  regionSave[addr-1][2]);
+        setIntegerParam(addr, PSRegionSizeY,  regionSave[addr-1][3]);
+        callParamCallbacks(addr);
+    }
+    if (this->numSynthFree != NUM_SYNTH_FRAMES) {
+        printf("%s:%s: %d synthetic frames were not returned\n", driverName, functionName,
+               NUM_SYNTH_FRAMES - this->numSynthFree);
+        failed = 1;
+    }
+    freeSynthFrames();
+    this->unlock();
+
+    /* Wait until the plugins have processed their queues, i.e. the pool is steady for a second */
+    inUseEnd = -1;
+    stable = 0;
+    for (waited=0.; (waited < STRESS_DRAIN_TIMEOUT) && (stable < 10); waited += 0.1) {
+        epicsThreadSleep(0.1);
+        inUse = this->pNDArrayPool->getNumBuffers() - this->pNDArrayPool->getNumFree();
+        stable = (inUse == inUseEnd) ? stable+1 : 0;
+        inUseEnd = inUse;
+    }
+
+    this->lock();
+    getIntegerParam(NDArrayCounter, &counterEnd);
+    getIntegerParam(PSGateDiscarded, &discardedEnd);
+    getIntegerParam(PSBadFrameCounter, &badEnd);
+    metricEnd = epicsAtomicGetSizeT(&this->metrics.values[PSMetricFrames]);
+    inUseEnd = this->pNDArrayPool->getNumBuffers() - this->pNDArrayPool->getNumFree();
+    viewsEnd = this->pViewPool->getNumBuffers() - this->pViewPool->getNumFree();
+    heldEnd = heldArrays(&heldViewsEnd);
+    this->stressRunning = 0;
+    this->unlock();
+    doubles = epicsAtomicGetIntT(&this->pNumaPool->doubleReleases) - doubleStart;
+    frames = epicsAtomicGetSizeT(&this->stressFrames);
+    writes = epicsAtomicGetSizeT(&this->stressWrites);
+
+    /* Check the invariants */
+    /* The arrays which are in use and not held by the driver must be back where they started */
+    if (inUseEnd - heldEnd != inUseStart - heldStart) {
+        printf("%s:%s: %d NDArrays of the driver pool are in use outside the driver, %d at the start\n",
+               driverName, functionName, inUseEnd - heldEnd, inUseStart - heldStart);
+        failed = 1;
+    }
+    if (viewsEnd - heldViewsEnd != viewsStart - heldViewsStart) {
+        printf("%s:%s: %d region views are in use outside the driver, %d at the start\n",
+               driverName, functionName, viewsEnd - heldViewsEnd, viewsStart - heldViewsStart);
+        failed = 1;
+    }
+    if (doubles > 0) {
+        printf("%s:%s: %d NDArrays were released more than once\n", driverName, functionName, doubles);
+        failed = 1;
+    }
+    if ((size_t)((counterEnd - counterStart) + (discardedEnd - discardedStart) + (badEnd - badStart)) != frames) {
+        printf("%s:%s: %lu frames injected but %d delivered, %d discarded and %d bad\n",
+               driverName, functionName, (unsigned long)frames, counterEnd - counterStart,
+               discardedEnd - discardedStart, badEnd - badStart);
+        failed = 1;
+    }
+    if (metricEnd - metricStart != (size_t)(counterEnd - counterStart)) {
+        printf("%s:%s: %lu frames in the metrics but ArrayCounter went up by %d\n",
+               driverName, functionName, (unsigned long)(metricEnd - metricStart), counterEnd - counterStart);
+        failed = 1;
+    }
+
+    printf("%s:%s: stress test on %s %s after %.1f s\n", driverName, functionName, this->portName,
+           failed ? "failed" : "passed", elapsed);
+    printf("  %.0f frames/s of %dx%d, %.0f writes/s from %d threads, %lu link events\n",
+           frames / elapsed, this->stressWidth, this->stressHeight, writes / elapsed, this->stressWriters,
+           (unsigned long)epicsAtomicGetSizeT(&this->stressLinkEvents));
+    printf("  Writer queue wait mean %.1f us, max %.1f us; %lu waits for a free frame\n",
+           writes ? 1e6 * this->stressWaitSum / writes : 0., 1e6 * this->stressWaitMax,
+           (unsigned long)epicsAtomicGetSizeT(&this->stressNoFrame));
+}
+
+
+/** Starts or stops a stress test of the frame and control paths.  The camera must be idle.
+  * \param[in] portName The asyn port name of the camera.
+  * \param[in] seconds Duration of the test; 0 stops a running test.
+  * \param[in] writers Number of threads writing region parameters.
+  * \param[in] linkPeriod Seconds between the link events which remove and add the camera, 0 for none.
+  */
+asynStatus prosilica::startStress(const char *portName, double seconds, int writers, double linkPeriod)
+{
+    prosilica *pCamera = findCamera(portName);
+    int acquire;
+    static const char *functionName = "startStress";
+
+    if (!pCamera) {
+        printf("%s:%s: camera port %s not found\n", driverName, functionName, portName ? portName : "");
+        return asynError;
+    }
+    pCamera->lock();
+    if (seconds <= 0.) {
+        epicsAtomicSetIntT(&pCamera->stressStop, 1);
+        pCamera->unlock();
+        return asynSuccess;
+    }
+    if (pCamera->stressRunning) {
+        pCamera->unlock();
+        printf("%s:%s: a stress test is already running on %s\n", driverName, functionName, portName);
+        return asynError;
+    }
+    pCamera->getIntegerParam(pCamera->ADAcquire, &acquire);
+    if (acquire || pCamera->soakRunning || pCamera->headroomRunning) {
+        pCamera->unlock();
+        printf("%s:%s: %s must be idle for a stress test\n", driverName, functionName, portName);
+        return asynError;
+    }
+    if ((linkPeriod > 0.) && !pCamera->uniqueId) {
+        printf("%s:%s: the unique ID of %s is not known, no link events\n", driverName, functionName, portName);
+        linkPeriod = 0.;
+    }
+    pCamera->stressSeconds = seconds;
+    pCamera->stressWriters = (writers > 0) ? writers : 4;
+    pCamera->stressLinkPeriod = linkPeriod;
+    epicsAtomicSetIntT(&pCamera->stressStop, 0);
+    pCamera->stressRunning = 1;
+    pCamera->unlock();
+    if (!epicsThreadCreate("prosilicaStress", epicsThreadPriorityLow,
+                           epicsThreadGetStackSize(epicsThreadStackMedium),
+                           (EPICSTHREADFUNC)stressTaskC, pCamera)) {
+        printf("%s:%s: epicsThreadCreate failure for stress test\n", driverName, functionName);
+        pCamera->stressRunning = 0;
+        return asynError;
+    }
+    return asynSuccess;
+}
+
+
+/** A plugin watched by the headroom benchmark */
+typedef struct headroomPlugin {
+    asynPortDriver *pPort;
+    const char *name;
+    int droppedParam;              /* Indices of the NDPluginDriver parameters, -1 if the port has none */
+    int queueSizeParam;
+    int queueFreeParam;
+    int timeParam;
+    int dropped;                   /* DroppedArrays at the start of the step */
+    int queueMid;                  /* Arrays queued half way through the step */
+} headroomPlugin;
+
+/** Reads an integer parameter of a plugin, or returns 0 if the plugin does not have it */
+static int headroomInt(headroomPlugin *pPlugin, int param)
+{
+    int value = 0;
+
+    if (param < 0) return 0;
+    pPlugin->pPort->lock();
+    pPlugin->pPort->getIntegerParam(param, &value);
+    pPlugin->pPort->unlock();
+    return value;
+}
+
+/** Reads a double parameter of a plugin, or returns 0 if the plugin does not have it */
+static double headroomDouble(headroomPlugin *pPlugin, int param)
+{
+    double value = 0.;
+
+    if (param < 0) return 0.;
+    pPlugin->pPort->lock();
+    pPlugin->pPort->getDoubleParam(param, &value);
+    pPlugin->pPort->unlock();
+    return value;
+}
+
+static int headroomQueued(headroomPlugin *pPlugin)
+{
+    return headroomInt(pPlugin, pPlugin->queueSizeParam) - headroomInt(pPlugin, pPlugin->queueFreeParam);
+}
+
+static void headroomTaskC(void *drvPvt)
+{
+    prosilica *pPvt = (prosilica *)drvPvt;
+
+    pPvt->headroomTask();
+}
+
+/** Runs one step of the headroom benchmark, injecting frames at rate frames/s for
+  * HEADROOM_STEP_TIME seconds.  Returns 0 if the rate was sustained, or 1 with the bottleneck
+  * in reason.  Called without the lock held. */
+int prosilica::headroomStep(double rate, headroomPlugin *pPlugins, int numPlugins,
+                            double *pAchieved, char *reason, size_t size)
+{
+    epicsUInt64 start, now, next, callStart;
+    epicsUInt64 stepTime = (epicsUInt64)(HEADROOM_STEP_TIME * 1e9);
+    double callTime = 0., elapsed;
+    int frames = 0, noFrame = 0, midDone = 0;
+    int poolMid = 0, poolEnd, dropped, queued, i;
+
+    for (i=0; i<numPlugins; i++) pPlugins[i].dropped = headroomInt(&pPlugins[i], pPlugins[i].droppedParam);
+    start = epicsMonotonicGet();
+    while (1) {
+        now = epicsMonotonicGet();
+        if (now - start >= stepTime) break;
+        if (!midDone && (now - start >= stepTime/2)) {
+            for (i=0; i<numPlugins; i++) pPlugins[i].queueMid = headroomQueued(&pPlugins[i]);
+            poolMid = this->pNDArrayPool->getNumBuffers() - this->pNDArrayPool->getNumFree();
+            midDone = 1;
+        }
+        next = start + (epicsUInt64)(frames / rate * 1e9);
+        if (next > now) {
+            /* Sleep for most of a long wait, and spin for the part the sleep can not resolve */
+            if (next - now > 2000000) epicsThreadSleep((next - now - 1000000) * 1e-9);
+            continue;
+        }
+        callStart = now;
+        if (injectFrame(this->headroomWidth, this->headroomHeight, this->headroomFormat)) {
+            noFrame = 1;
+            break;
+        }
+        callTime += (epicsMonotonicGet() - callStart) * 1e-9;
+        frames++;
+    }
+    elapsed = (epicsMonotonicGet() - start) * 1e-9;
+    *pAchieved = frames / elapsed;
+    poolEnd = this->pNDArrayPool->getNumBuffers() - this->pNDArrayPool->getNumFree();
+
+    if (noFrame) {
+        epicsSnprintf(reason, size, "NDArrayPool out of memory with %d arrays in use", poolEnd);
+        return 1;
+    }
+    for (i=0; i<numPlugins; i++) {
+        dropped = headroomInt(&pPlugins[i], pPlugins[i].droppedParam) - pPlugins[i].dropped;
+        if (dropped > 0) {
+            epicsSnprintf(reason, size, "plugin %s dropped %d arrays, queue size %d, execution time %.3f ms",
+                          pPlugins[i].name, dropped, headroomInt(&pPlugins[i], pPlugins[i].queueSizeParam),
+                          headroomDouble(&pPlugins[i], pPlugins[i].timeParam));
+            return 1;
+        }
+    }
+    for (i=0; i<numPlugins; i++) {
+        queued = headroomQueued(&pPlugins[i]);
+        if (queued - pPlugins[i].queueMid >= HEADROOM_QUEUE_GROWTH) {
+            epicsSnprintf(reason, size, "queue of plugin %s grew from %d to %d of %d",
+                          pPlugins[i].name, pPlugins[i].queueMid, queued,
+                          headroomInt(&pPlugins[i], pPlugins[i].queueSizeParam));
+            return 1;
+        }
+    }
+    if (poolEnd - poolMid >= HEADROOM_QUEUE_GROWTH) {
+        epicsSnprintf(reason, size, "arrays in use grew from %d to %d, in a plugin which is not watched",
+                      poolMid, poolEnd);
+        return 1;
+    }
+    if (*pAchieved < HEADROOM_RATE_TOLERANCE * rate) {
+        epicsSnprintf(reason, size, "frame callback, including the blocking plugins, took %.3f ms per frame",
+                      frames ? 1e3 * callTime / frames : 0.);
+        return 1;
+    }
+    return 0;
+}
+
+/** Waits until the watched plugins have emptied their queues and the arrays in use have been
+  * steady for half a second, or until STRESS_DRAIN_TIMEOUT */
+void prosilica::headroomDrain(headroomPlugin *pPlugins, int numPlugins)
+{
+    double waited;
+    int inUse, lastInUse = -1, stable = 0, busy, i;
+
+    for (waited=0.; (waited < STRESS_DRAIN_TIMEOUT) && (stable < 5); waited += 0.1) {
+        epicsThreadSleep(0.1);
+        inUse = this->pNDArrayPool->getNumBuffers() - this->pNDArrayPool->getNumFree();
+        busy = (inUse != lastInUse);
+        lastInUse = inUse;
+        for (i=0; i<numPlugins; i++) {
+            if (headroomQueued(&pPlugins[i]) > 0) busy = 1;
+        }
+        stable = busy ? 0 : stable+1;
+    }
+}
+
+/** Runs the headroom benchmark.  Synthetic frames go through the frame callback and the
+  * plugin chain at rates increasing by HEADROOM_RATE_STEP, until a step drops frames, lets a
+  * queue grow or can not inject at its rate.  The highest rate sustained and the bottleneck are printed. */
+void prosilica::headroomTask()
+{
+    headroomPlugin plugins[MAX_HEADROOM_PLUGINS];
+    int numPlugins = 0;
+    char *names, *name, *last;
+    char reason[256];
+    double rate, achieved, sustained = 0.;
+    int failed = 0;
+    size_t frameBytes;
+    static const char *functionName = "headroomTask";
+
+    /* Find the plugins, which are asynPortDrivers with the NDPluginDriver parameters */
+    names = epicsStrDup(this->headroomPluginNames);
+    for (name = epicsStrtok_r(names, " ,", &last); name && (numPlugins < MAX_HEADROOM_PLUGINS);
+         name = epicsStrtok_r(NULL, " ,", &last)) {
+        headroomPlugin *pPlugin = &plugins[numPlugins];
+        pPlugin->pPort = (asynPortDriver *)findAsynPortDriver(name);
+        if (!pPlugin->pPort) {
+            printf("%s:%s: plugin port %s not found\n", driverName, functionName, name);
+            continue;
+        }
+        pPlugin->name = pPlugin->pPort->portName;
+        if (pPlugin->pPort->findParam("DROPPED_ARRAYS", &pPlugin->droppedParam)) pPlugin->droppedParam = -1;
+        if (pPlugin->pPort->findParam("QUEUE_SIZE", &pPlugin->queueSizeParam)) pPlugin->queueSizeParam = -1;
+        if (pPlugin->pPort->findParam("QUEUE_FREE", &pPlugin->queueFreeParam)) pPlugin->queueFreeParam = -1;
+        if (pPlugin->pPort->findParam("EXECUTION_TIME", &pPlugin->timeParam)) pPlugin->timeParam = -1;
+        if ((pPlugin->droppedParam < 0) && (pPlugin->queueFreeParam < 0)) {
+            printf("%s:%s: %s is not a plugin\n", driverName, functionName, name);
+            continue;
         }
-    } else if (function == PSByteRate) {
-            status |= PvAttrUint32Set(this->PvHandle, "StreamBytesPerSecond", value);
-    } else if (function == PSReadStatistics) {
-            readStats();
-    } else if (function == PSTriggerEvent) {
-            status |= PvAttrEnumSet(this->PvHandle, "FrameStartTriggerEvent", PSTriggerEventModes[value]);
-    } else if (function == PSTriggerOverlap) {
-            status |= PvAttrEnumSet(this->PvHandle, "FrameStartTriggerOverlap", PSTriggerOverlapModes[value]);
-    } else if (function == PSTriggerSoftware) {
-            status |= PvCommandRun(this->PvHandle, "FrameStartTriggerSoftware");
-    } else if (function == PSSyncOut1Mode) {
-            status |= PvAttrEnumSet(this->PvHandle, "SyncOut1Mode", PSSyncOutModes[value]);
-    } else if (function == PSSyncOut2Mode) {
-            status |= PvAttrEnumSet(this->PvHandle, "SyncOut2Mode", PSSyncOutModes[value]);
-    } else if (function == PSSyncOut3Mode) {
-            status |= PvAttrEnumSet(this->PvHandle, "SyncOut3Mode", PSSyncOutModes[value]);
-            if (status == ePvErrNotFound) status = 0;
-    } else if (function == PSSyncOut1Level) {
-            status |= PvAttrUint32Get(this->PvHandle, "SyncOutGpoLevels", &syncs);
-            syncs = (syncs & ~0x01) | ((value<<0) & 0x01);
-            status |= PvAttrUint32Set(this->PvHandle, "SyncOutGpoLevels", syncs);
-    } else if (function == PSSyncOut2Level) {
-            status |= PvAttrUint32Get(this->PvHandle, "SyncOutGpoLevels", &syncs);
-            syncs = (syncs & ~0x02) | ((value<<1) & 0x02);
-            status |= PvAttrUint32Set(this->PvHandle, "SyncOutGpoLevels", syncs);
-    } else if (function == PSSyncOut3Level) {
-            status |= PvAttrUint32Get(this->PvHandle, "SyncOutGpoLevels", &syncs);
-            syncs = (syncs & ~0x04) | ((value<<2) & 0x04);
-            status |= PvAttrUint32Set(this->PvHandle, "SyncOutGpoLevels", syncs);
-    } else if (function == PSSyncOut1Invert) {
-            status |= PvAttrEnumSet(this->PvHandle, "SyncOut1Invert", value ? "On":"Off");
-    } else if (function == PSSyncOut2Invert) {
-            status |= PvAttrEnumSet(this->PvHandle, "SyncOut2Invert", value ? "On":"Off");
-    } else if (function == PSSyncOut3Invert) {
-            status |= PvAttrEnumSet(this->PvHandle, "SyncOut3Invert", value ? "On":"Off");
-            if (status == ePvErrNotFound) status = 0;
-    } else if (function == PSStrobe1Mode) {
-            status |= PvAttrEnumSet(this->PvHandle, "Strobe1Mode", PSStrobeModes[value]);
-    } else if (function == PSStrobe1CtlDuration) {
-            status |= PvAttrEnumSet(this->PvHandle, "Strobe1ControlledDuration", value ? "On":"Off");
-    } else if ((function == NDDataType) ||
-               (function == NDColorMode)) {
-            status = setPixelFormat();
-    } else if (function == PSResetTimer) {
-            status = syncTimer();
-    } else if ( function == PSExposureMode ) {
-            status = PvAttrEnumSet(this->PvHandle, "ExposureMode", PSExposureModes[value]);
-    } else if ( function == PSGainMode ) {
-            status = PvAttrEnumSet(this->PvHandle, "GainMode", PSGainModes[value]);
-    } else {
-            /* If this is not a parameter we have handled call the base class */
-            if (function < FIRST_PS_PARAM) status = ADDriver::writeInt32(pasynUser, value);
+        numPlugins++;
     }
-    
-    /* Read the camera parameters and do callbacks */
-    status |= readParameters();    
-    if (status) 
-        asynPrint(pasynUser, ASYN_TRACE_ERROR, 
-              "%s:%s: error, status=%d function=%d, value=%d\n", 
-              driverName, functionName, status, function, value);
-    else        
-        asynPrint(pasynUser, ASYN_TRACEIO_DRIVER, 
-              "%s:%s: function=%d, value=%d\n", 
-              driverName, functionName, function, value);
-    return((asynStatus)status);
+    free(names);
+
+    frameBytes = (size_t)this->headroomWidth * this->headroomHeight * PSEstBytesPerPixel[this->headroomFormat];
+    printf("%s:%s: %s, %dx%d %s, watching %d plugins\n", driverName, functionName, this->portName,
+           this->headroomWidth, this->headroomHeight, PSEstPixelFormats[this->headroomFormat], numPlugins);
+    headroomDrain(plugins, numPlugins);
+    for (rate = HEADROOM_START_RATE; rate <= HEADROOM_MAX_RATE; rate *= HEADROOM_RATE_STEP) {
+        if (epicsAtomicGetIntT(&this->headroomAbort)) break;
+        failed = headroomStep(rate, plugins, numPlugins, &achieved, reason, sizeof(reason));
+        printf("  %9.1f frames/s: %9.1f injected, %s\n", rate, achieved, failed ? reason : "sustained");
+        if (failed) break;
+        sustained = rate;
+        headroomDrain(plugins, numPlugins);
+    }
+
+    this->lock();
+    freeSynthFrames();
+    this->headroomRunning = 0;
+    this->unlock();
+    free(this->headroomPluginNames);
+    this->headroomPluginNames = NULL;
+
+    printf("%s:%s: %s sustained %.1f frames/s, %.1f MB/s\n", driverName, functionName, this->portName,
+           sustained, sustained * frameBytes / 1e6);
+    if (failed) printf("  Bottleneck at %.1f frames/s: %s\n", rate, reason);
+    else printf("  No bottleneck up to %.1f frames/s\n", sustained);
 }
 
-/** Called when asyn clients call pasynFloat64->write().
-  * This function performs actions for some parameters, including ADAcquireTime, ADGain, etc.
-  * For all parameters it sets the value in the parameter library and calls any registered callbacks..
-  * \param[in] pasynUser pasynUser structure that encodes the reason and address.
-  * \param[in] value Value to write. */
-asynStatus prosilica::writeFloat64(asynUser *pasynUser, epicsFloat64 value)
+
+/** Starts or stops the headroom benchmark.  The camera must be idle.
+  * \param[in] portName The asyn port name of the camera.
+  * \param[in] sizeX Width of the injected frames; 0 for the current binned ROI, negative to stop a running benchmark.
+  * \param[in] sizeY Height of the injected frames; 0 for the current binned ROI, negative to stop a running benchmark.
+  * \param[in] pixelFormat Mono8, Mono16, Bayer8, Bayer16, Rgb24 or Rgb48; default Mono8.
+  * \param[in] plugins Port names of the plugins to watch for drops and queue growth.
+  */
+asynStatus prosilica::startHeadroom(const char *portName, int sizeX, int sizeY, const char *pixelFormat,
+                                    const char *plugins)
 {
-    int function = pasynUser->reason;
-    int status = asynSuccess;
-    const char *paramName;
-    static const char *functionName = "writeFloat64";
+    prosilica *pCamera = findCamera(portName);
+    int acquire, format, binX, binY;
+    static const char *functionName = "startHeadroom";
 
-    getParamName(function, &paramName);
-    /* Set the parameter and readback in the parameter library.  This may be overwritten when we read back the
-     * status at the end, but that's OK */
-    status |= setDoubleParam(function, value);
+    if (!pCamera) {
+        printf("%s:%s: camera port %s not found\n", driverName, functionName, portName ? portName : "");
+        return asynError;
+    }
+    if ((sizeX < 0) || (sizeY < 0)) {
+        epicsAtomicSetIntT(&pCamera->headroomAbort, 1);
+        return asynSuccess;
+    }
+    format = 0;
+    if (pixelFormat && pixelFormat[0]) {
+        for (format=0; format<NUM_EST_PIXEL_FORMATS; format++) {
+            if (epicsStrCaseCmp(pixelFormat, PSEstPixelFormats[format]) == 0) break;
+        }
+        if (format == NUM_EST_PIXEL_FORMATS) {
+            printf("%s:%s: unknown pixel format %s\n", driverName, functionName, pixelFormat);
+            return asynError;
+        }
+    }
+    pCamera->lock();
+    if (pCamera->headroomRunning) {
+        pCamera->unlock();
+        printf("%s:%s: a headroom benchmark is already running on %s\n", driverName, functionName, portName);
+        return asynError;
+    }
+    pCamera->getIntegerParam(pCamera->ADAcquire, &acquire);
+    if (acquire || pCamera->soakRunning || pCamera->stressRunning) {
+        pCamera->unlock();
+        printf("%s:%s: %s must be idle for the headroom benchmark\n", driverName, functionName, portName);
+        return asynError;
+    }
+    if ((sizeX == 0) || (sizeY == 0)) {
+        pCamera->getIntegerParam(pCamera->ADBinX, &binX);
+        pCamera->getIntegerParam(pCamera->ADBinY, &binY);
+        if (sizeX == 0) pCamera->getIntegerParam(pCamera->ADSizeX, &sizeX);
+        else binX = 1;
+        if (sizeY == 0) pCamera->getIntegerParam(pCamera->ADSizeY, &sizeY);
+        else binY = 1;
+        if (binX > 0) sizeX /= binX;
+        if (binY > 0) sizeY /= binY;
+    }
+    if ((sizeX <= 0) || (sizeY <= 0)) {
+        pCamera->unlock();
+        printf("%s:%s: the frame size must be given when the ROI is not known\n", driverName, functionName);
+        return asynError;
+    }
+    pCamera->headroomWidth = sizeX;
+    pCamera->headroomHeight = sizeY;
+    pCamera->headroomFormat = format;
+    pCamera->headroomPluginNames = epicsStrDup(plugins ? plugins : "");
+    epicsAtomicSetIntT(&pCamera->headroomAbort, 0);
+    pCamera->headroomRunning = 1;
+    pCamera->unlock();
+    if (!epicsThreadCreate("prosilicaHeadroom", epicsThreadPriorityMedium,
+                           epicsThreadGetStackSize(epicsThreadStackMedium),
+                           (EPICSTHREADFUNC)headroomTaskC, pCamera)) {
+        printf("%s:%s: epicsThreadCreate failure for headroom benchmark\n", driverName, functionName);
+        pCamera->headroomRunning = 0;
+        return asynError;
+    }
+    return asynSuccess;
+}
 
-    if (function == ADAcquireTime) {
-        /* Prosilica uses integer microseconds */
-        status |= PvAttrUint32Set(this->PvHandle, "ExposureValue", (tPvUint32)(value * 1e6));
-    } else if (function == ADAcquirePeriod) {
-        /* Prosilica uses a frame rate in Hz */
-        if (value == 0.) value = .01;
-        status |= PvAttrFloat32Set(this->PvHandle, "FrameRate", (tPvFloat32)(1./value));
-    } else if (function == ADGain) {
-        /* Prosilica uses an integer value */
-        status |= PvAttrUint32Set(this->PvHandle, "GainValue", (tPvUint32)(value));
-    } else if (function == PSTriggerDelay) {
-        /* Prosilica uses integer microseconds */
-        status |= PvAttrUint32Set(this->PvHandle, "FrameStartTriggerDelay", (tPvUint32)(value*1e6));
-    } else if (function == PSStrobe1Delay) {
-        /* Prosilica uses integer microseconds */
-        status |= PvAttrUint32Set(this->PvHandle, "Strobe1Delay", (tPvUint32)(value*1e6));
-    } else if (function == PSStrobe1Duration) {
-        /* Prosilica uses integer microseconds */
-        status |= PvAttrUint32Set(this->PvHandle, "Strobe1Duration", (tPvUint32)(value*1e6));
-    } else {
-        /* If this is not a parameter we have handled call the base class */
-        if (function < NUM_PS_PARAMS) status = ADDriver::writeFloat64(pasynUser, value);
+
+/** Prints the latency histogram and error count of each attribute call of a camera.
+  * \param[in] portName The asyn port name of the camera.
+  * \param[in] sort The order of the attributes, slowest first: 0 by the mean, 1 by the maximum, 2 by the total time.
+  * \param[in] reset Clears the counts after printing them if not 0.
+  */
+asynStatus prosilica::attrReport(const char *portName, int sort, int reset)
+{
+    prosilica *pCamera = findCamera(portName);
+    static const char *functionName = "attrReport";
+
+    if (!pCamera) {
+        printf("%s:%s: camera port %s not found\n", driverName, functionName, portName ? portName : "");
+        return asynError;
     }
+    if ((sort < PSAttrSortMean) || (sort > PSAttrSortTotal)) sort = PSAttrSortMean;
+    printf("Attribute calls of %s, slowest first\n", pCamera->portName);
+    psAttrStatsReport(&pCamera->attrStats, (PSAttrSort_t)sort, stdout);
+    if (reset) {
+        pCamera->lock();
+        psAttrStatsReset(&pCamera->attrStats);
+        pCamera->publishAttrStats();
+        pCamera->callParamCallbacks();
+        pCamera->unlock();
+    }
+    return asynSuccess;
+}
 
-    /* Read the camera parameters and do callbacks */
-    status |= readParameters();
-    if (status) 
-        asynPrint(pasynUser, ASYN_TRACE_ERROR, 
-              "%s:%s: error, status=%d function=%d, name=%s, value=%f\n", 
-              driverName, functionName, status, function, paramName, value);
-    else        
-        asynPrint(pasynUser, ASYN_TRACEIO_DRIVER, 
-              "%s:%s: function=%d, name=%s, value=%f\n", 
-              driverName, functionName, function, paramName, value);
-    return((asynStatus)status);
+
+extern "C" int prosilicaSoak(const char *portName, /* Port name of the camera */
+                             double hours,         /* Duration of the test, 0 to stop it */
+                             double cyclePeriod,   /* Seconds per cycle, default 10 */
+                             double tolerance)     /* Allowed relative growth, default 0.05 */
+{
+    return prosilica::startSoak(portName, hours, cyclePeriod, tolerance);
 }
 
-/** Report status of the driver.
-  * Prints details about the driver if details>0.
-  * It then calls the ADDriver::report() method.
-  * \param[in] fp File pointed passed by caller where the output is written to.
-  * \param[in] details If >0 then driver details are printed.
+
+extern "C" int prosilicaStress(const char *portName, /* Port name of the camera */
+                               double seconds,       /* Duration of the test, 0 to stop it */
+                               int writers,          /* Parameter writer threads, default 4 */
+                               double linkPeriod)    /* Seconds between link events, 0 for none */
+{
+    return prosilica::startStress(portName, seconds, writers, linkPeriod);
+}
+
+
+extern "C" int prosilicaHeadroom(const char *portName,    /* Port name of the camera */
+                                 int sizeX,               /* Frame width, 0 for the ROI, -1 to stop */
+                                 int sizeY,               /* Frame height, 0 for the ROI, -1 to stop */
+                                 const char *pixelFormat, /* Mono8 to Rgb48, default Mono8 */
+                                 const char *plugins)     /* Plugin port names to watch */
+{
+    return prosilica::startHeadroom(portName, sizeX, sizeY, pixelFormat, plugins);
+}
+
+
+extern "C" int prosilicaAttrReport(const char *portName, /* Port name of the camera */
+                                   int sort,             /* 0 by mean, 1 by maximum, 2 by total time */
+                                   int reset)            /* Clear the counts after printing */
+{
+    return prosilica::attrReport(portName, sort, reset);
+}
+
+
+extern "C" int prosilicaGroupConfig(const char *groupName,  /* Name of the acquisition group */
+                                    const char *portNames,  /* Port names of the member cameras */
+                                    double tolerance)       /* Frame matching tolerance in seconds */
+{
+    return prosilica::createGroup(groupName, portNames, tolerance);
+}
+
+
+/** Prints the host network counters for a camera IP address.
+  * \param[in] ipAddress IP address of the camera.
+  * \param[in] root Root directory of the /proc and /sys files, NULL or "" for the live system.
+  *            Directories with fixture files can be used to check the readers.
   */
-void prosilica::report(FILE *fp, int details)
+extern "C" int prosilicaHostStatsReport(const char *ipAddress, const char *root)
 {
-    tPvCameraInfoEx cameraInfo[20], *pInfo; 
-    int i;
-    unsigned long numReturned, numTotal, versionMajor, versionMinor;
-    
-    numReturned = PvCameraListEx(cameraInfo, 20, &numTotal, sizeof(tPvCameraInfoEx));
+    psHostNetStats stats;
 
-    fprintf(fp, "Prosilica camera %s Unique ID=%d\n", 
-            this->portName, (int)this->uniqueId);
-    pInfo = &this->PvCameraInfo;
-    if (details > 0) {
-        PvVersion(&versionMajor, &versionMinor);
-        fprintf(fp, "  PvAPI version:     %ld.%ld\n", versionMajor, versionMinor);
-        fprintf(fp, "  ID:                %lu\n", pInfo->UniqueId);
-        fprintf(fp, "  IP address:        %s\n",  this->IPAddress);
-        fprintf(fp, "  Serial number:     %s\n",  pInfo->SerialNumber);
-        fprintf(fp, "  Camera name:       %s\n",  pInfo->CameraName);
-        fprintf(fp, "  Model:             %s\n",  pInfo->ModelName);
-        fprintf(fp, "  Firmware version:  %s\n",  pInfo->FirmwareVersion);
-        fprintf(fp, "  Access flags:      %lx\n", pInfo->PermittedAccess);
-        fprintf(fp, "  Sensor type:       %s\n",  this->sensorType);
-        fprintf(fp, "  Sensor bits:       %d\n",  (int)this->sensorBits);
-        fprintf(fp, "  Sensor width:      %d\n",  (int)this->sensorWidth);
-        fprintf(fp, "  Sensor height:     %d\n",  (int)this->sensorHeight);
-        fprintf(fp, "  Frame buffer size: %d\n",  (int)this->PvFrames[0].ImageBufferSize);
-        fprintf(fp, "  Time stamp freq:   %d\n",  (int)this->timeStampFrequency);
-        fprintf(fp, "  maxPvAPIFrames:    %d\n",  (int)this->maxPvAPIFrames_);
-        fprintf(fp, "\n");
-        fprintf(fp, "List of all Prosilica cameras found (total=%d):\n", (int)numReturned);
-        for (i=0; i<(int)numReturned; i++) {
-            pInfo = &cameraInfo[i];
-            fprintf(fp, "  ID:                %lu\n", pInfo->UniqueId);
-            fprintf(fp, "  Serial number:     %s\n",  pInfo->SerialNumber);
-            fprintf(fp, "  Camera name:       %s\n",  pInfo->CameraName);
-            fprintf(fp, "  Model:             %s\n",  pInfo->ModelName);
-            fprintf(fp, "  Firmware version:  %s\n",  pInfo->FirmwareVersion);
-            fprintf(fp, "  Access flags:      %lx\n", pInfo->PermittedAccess);
-            fprintf(fp, "\n");
-        }
+    if (!ipAddress) {
+        printf("Usage: prosilicaHostStatsReport ipAddress [root]\n");
+        return asynError;
+    }
+    if (psHostFindInterface(root, ipAddress, stats.ifName, sizeof(stats.ifName))) {
+        printf("No route to %s\n", ipAddress);
+        stats.ifName[0] = 0;
     }
+    if (psHostReadNetStats(root, &stats)) {
+        printf("Host network counters are not available\n");
+        return asynError;
+    }
+    printf("Camera %s interface %s\n", ipAddress, stats.ifName);
+    printf("  UDP socket drops:    %llu\n", (unsigned long long)stats.udpDrops);
+    printf("  UDP RcvbufErrors:    %llu\n", (unsigned long long)stats.udpRcvbufErrors);
+    printf("  NIC rx_missed:       %llu\n", (unsigned long long)stats.nicRxMissed);
+    printf("  NIC rx_dropped:      %llu\n", (unsigned long long)stats.nicRxDropped);
+    printf("  rmem_max:            %llu\n", (unsigned long long)stats.rmemMax);
+    return asynSuccess;
+}
 
-    /* Call the base class method */
-    ADDriver::report(fp, details);
+
+/** Configures how the PvAPI library finds cameras.  This must be called before the first prosilicaConfig.
+  * \param[in] noDiscovery 1 to initialize PvAPI without broadcast discovery.  Cameras must then be
+  *            configured by IP address, or by a unique ID which is in the camera cache.
+  * \param[in] cacheFile File which maps unique IDs to IP addresses, NULL or "" for no file.
+  * \param[in] refreshPeriod Seconds between background refreshes of the cache, 0 for none.
+  */
+extern "C" int prosilicaDiscoveryConfig(int noDiscovery, const char *cacheFile, double refreshPeriod)
+{
+    int numCameras;
+
+    if (PvApiInitialized) {
+        printf("prosilicaDiscoveryConfig must be called before prosilicaConfig\n");
+        return asynError;
+    }
+    PvApiNoDiscovery = noDiscovery;
+    discoveryRefreshPeriod = refreshPeriod;
+    if (cacheFile && cacheFile[0]) {
+        numCameras = psCacheLoad(cacheFile);
+        if (numCameras < 0)
+            printf("Camera cache %s does not exist yet, it will be created\n", cacheFile);
+        else
+            printf("Read %d cameras from camera cache %s\n", numCameras, cacheFile);
+    }
+    return asynSuccess;
 }
 
-
+
+/** Writes the counters of all cameras in the OpenMetrics text format.
+  * \param[in] fileName File to write, which is replaced atomically.  NULL or "" prints to stdout.
+  * \param[in] period If greater than 0, a thread writes the file with this period in seconds.
+  *            A period of 0 with a file name writes once and stops the thread.
+  */
+extern "C" int prosilicaMetrics(const char *fileName, double period)
+{
+    if (!fileName || !fileName[0]) {
+        psMetricsWrite(stdout);
+        return asynSuccess;
+    }
+    if (period > 0.) return psMetricsStartWriter(fileName, period) ? asynError : asynSuccess;
+    psMetricsStartWriter(fileName, 0.);
+    if (psMetricsWriteFile(fileName)) {
+        printf("Cannot write %s\n", fileName);
+        return asynError;
+    }
+    return asynSuccess;
+}
+
+
 extern "C" int prosilicaConfig(char *portName, /* Port name */
                                const char *cameraId,   /* Unique ID #, or IP address or IP name of this camera. */
                                int maxBuffers, size_t maxMemory,
@@ -1834,14 +6366,33 @@ extern "C" int prosilicaConfig(char *portName, /* Port name */
   */
 prosilica::prosilica(const char *portName, const char *cameraId, int maxBuffers, size_t maxMemory,
                      int priority, int stackSize, int maxPvAPIFrames)
-    : ADDriver(portName, 1, NUM_PS_PARAMS, maxBuffers, maxMemory, 
+    : ADDriver(portName, 1 + NUM_REGIONS, NUM_PS_PARAMS, maxBuffers, maxMemory, 
                0, 0,               /* No interfaces beyond those set in ADDriver.cpp */
-               ASYN_CANBLOCK, 0,   /* ASYN_CANBLOCK=1, ASYN_MULTIDEVICE=0, autoConnect=1 */
+               ASYN_CANBLOCK | ASYN_MULTIDEVICE, 0, /* ASYN_CANBLOCK=1, ASYN_MULTIDEVICE=1, autoConnect=0 */
                priority, stackSize), 
-      PvHandle(NULL), maxPvAPIFrames_(maxPvAPIFrames), framesRemaining(0) 
+      PvHandle(NULL), numParkedFrames(0), maxPvAPIFrames_(maxPvAPIFrames), framesRemaining(0),
+      pGroup(NULL), groupMember(0),
+      savedByteRate(0), payloadSize(0), syncInLevels(0), gpoHandle(NULL), gpoLevels(0), gpoProgramNumMasks(0), gpoProgramNumTimes(0),
+      gpoRunSteps(0), gpoRunRepeats(0), gpoRunPeriod(0.), gpoRunStart(0), gpoRunning(0), gpoRunAbort(0),
+      hostStatsValid(0), frameThreadId(0), portThreadId(0), numThreadStats(0), perfFailed(0), perfPixels(0.),
+      numFrameLatency(0), soakEndTime(0.), soakCyclePeriod(0.), soakTolerance(0.), soakRunning(0),
+      soakAbort(0), rowReadoutTime(0.), armed(0), firstFramePending(0), gateRemaining(0), gateOpenTicks(0),
+      roiSeqHandle(NULL), roiSeqError(0), roiSeqCount(0), roiSeqNext(0), roiSeqActive(0),
+      roiSeqHomeX(0), roiSeqHomeY(0), roiSeqRestore(0), numaNode(-1), numaBound(0), historyErroneous(0),
+      historyValid(0), historyBytes(0), historyLastBytes(0), historyLatencyFrames(0), numSynthFree(0),
+      synthFrameCount(0), stressRunning(0), stressStop(0),
+      stressSeconds(0.), stressWriters(0), stressLinkPeriod(0.), stressWidth(0), stressHeight(0),
+      stressNextWriter(0), stressThreads(0), stressFrames(0), stressWrites(0), stressLinkEvents(0),
+      stressNoFrame(0), stressWaitSum(0.), stressWaitMax(0.), headroomRunning(0), headroomAbort(0),
+      headroomWidth(0), headroomHeight(0), headroomFormat(0), headroomPluginNames(NULL)
 
 {
     int status = asynSuccess;
+    char cachedAddress[PS_CACHE_ADDRESS_SIZE];
+    tPvCameraInfoEx cameraInfo;
+    double waited;
+    asynUser *pasynUser;
+    int addr;
     static const char *functionName = "prosilica";
     cameraNode *pNode = new cameraNode;
 
@@ -1854,9 +6405,15 @@ prosilica::prosilica(const char *portName, const char *cameraId, int maxBuffers,
     }
     pNode->pCamera = this;
     ellAdd(cameraList, (ELLNODE *)pNode);
+    psMetricsRegister(&this->metrics, portName);
  
     createParam(PSReadStatisticsString,      asynParamInt32,    &PSReadStatistics);
     createParam(PSBayerConvertString,        asynParamInt32,    &PSBayerConvert);
+    createParam(PSRgbLayoutString,           asynParamInt32,    &PSRgbLayout);
+    createParam(PSSoftBinXString,            asynParamInt32,    &PSSoftBinX);
+    createParam(PSSoftBinYString,            asynParamInt32,    &PSSoftBinY);
+    createParam(PSSoftBinModeString,         asynParamInt32,    &PSSoftBinMode);
+    createParam(PSSoftBinTypeString,         asynParamInt32,    &PSSoftBinType);
     createParam(PSGainModeString,            asynParamInt32,    &PSGainMode);
     createParam(PSExposureModeString,        asynParamInt32,    &PSExposureMode);
     createParam(PSDriverTypeString,          asynParamOctet,    &PSDriverType);
@@ -1894,23 +6451,292 @@ prosilica::prosilica(const char *portName, const char *cameraId, int maxBuffers,
     createParam(PSStrobe1CtlDurationString,  asynParamInt32,    &PSStrobe1CtlDuration);
     createParam(PSStrobe1DurationString,     asynParamFloat64,  &PSStrobe1Duration);
     createParam(PSTemperatureMainboardString,asynParamFloat64,  &PSTemperatureMainboard);
+    createParam(PSGroupNameString,           asynParamOctet,    &PSGroupName);
+    createParam(PSGroupAcquireString,        asynParamInt32,    &PSGroupAcquire);
+    createParam(PSGroupSequenceString,       asynParamInt32,    &PSGroupSequence);
+    createParam(PSGroupSetsCompleteString,   asynParamInt32,    &PSGroupSetsComplete);
+    createParam(PSGroupSetsIncompleteString, asynParamInt32,    &PSGroupSetsIncomplete);
+    createParam(PSStreamHoldString,          asynParamInt32,    &PSStreamHold);
+    createParam(PSStreamHoldLinkRateString,  asynParamInt32,    &PSStreamHoldLinkRate);
+    createParam(PSStreamHoldCapacityString,  asynParamInt32,    &PSStreamHoldCapacity);
+    createParam(PSStreamHoldFramesString,    asynParamInt32,    &PSStreamHoldFrames);
+    setStringParam(PSGroupName, "");
+    setIntegerParam(PSRgbLayout, PSRgbLayoutRGB1);
+    setIntegerParam(PSSoftBinX, 1);
+    setIntegerParam(PSSoftBinY, 1);
+    setIntegerParam(PSSoftBinMode, PSSoftBinSum);
+    setIntegerParam(PSSoftBinType, PSSoftBinUInt16);
+    createParam(PSPtpModeString,             asynParamInt32,    &PSPtpMode);
+    createParam(PSPtpStatusString,           asynParamInt32,    &PSPtpStatus);
+    createParam(PSPtpLockedString,           asynParamInt32,    &PSPtpLocked);
+    createParam(PSPtpOffsetString,           asynParamFloat64,  &PSPtpOffset);
+    createParam(PSSyncInMonitorString,       asynParamInt32,    &PSSyncInMonitor);
+    createParam(PSSyncInPollPeriodString,    asynParamFloat64,  &PSSyncInPollPeriod);
+    createParam(PSSyncInResetCountsString,   asynParamInt32,    &PSSyncInResetCounts);
+    createParam(PSSyncIn1CountString,        asynParamInt32,    &PSSyncIn1Count);
+    createParam(PSSyncIn2CountString,        asynParamInt32,    &PSSyncIn2Count);
+    createParam(PSSyncIn1EdgeTimeString,     asynParamFloat64,  &PSSyncIn1EdgeTime);
+    createParam(PSSyncIn2EdgeTimeString,     asynParamFloat64,  &PSSyncIn2EdgeTime);
+    setIntegerParam(PSStreamHoldLinkRate, DEFAULT_LINK_RATE);
+    setIntegerParam(PSSyncInMonitor, PSSyncInMonitorOff);
+    setDoubleParam(PSSyncInPollPeriod, DEFAULT_SYNC_IN_POLL_PERIOD);
+    setIntegerParam(PSSyncIn1Count, 0);
+    setIntegerParam(PSSyncIn2Count, 0);
+    createParam(PSSyncOutGpoLevelsString,    asynParamInt32,    &PSSyncOutGpoLevels);
+    createParam(PSGpoPulseString,            asynParamInt32,    &PSGpoPulse);
+    createParam(PSGpoPulseWidthString,       asynParamFloat64,  &PSGpoPulseWidth);
+    createParam(PSGpoProgramMasksString,     asynParamInt32Array,   &PSGpoProgramMasks);
+    createParam(PSGpoProgramTimesString,     asynParamFloat64Array, &PSGpoProgramTimes);
+    createParam(PSGpoProgramRepeatsString,   asynParamInt32,    &PSGpoProgramRepeats);
+    createParam(PSGpoProgramPeriodString,    asynParamFloat64,  &PSGpoProgramPeriod);
+    createParam(PSGpoProgramRunString,       asynParamInt32,    &PSGpoProgramRun);
+    createParam(PSGpoProgramStepString,      asynParamInt32,    &PSGpoProgramStep);
+    createParam(PSGpoTimingErrorString,      asynParamFloat64,  &PSGpoTimingError);
+    createParam(PSGpoTimingErrorMaxString,   asynParamFloat64,  &PSGpoTimingErrorMax);
+    createParam(PSGpoTimingErrorMeanString,  asynParamFloat64,  &PSGpoTimingErrorMean);
+    setIntegerParam(PSGpoProgramRun, 0);
+    setIntegerParam(PSGpoProgramStep, 0);
+    setDoubleParam(PSGpoTimingError, 0.);
+    setDoubleParam(PSGpoTimingErrorMax, 0.);
+    setDoubleParam(PSGpoTimingErrorMean, 0.);
+    createParam(PSHostInterfaceString,       asynParamOctet,    &PSHostInterface);
+    createParam(PSHostUdpDropsString,        asynParamInt32,    &PSHostUdpDrops);
+    createParam(PSHostUdpRcvbufErrorsString, asynParamInt32,    &PSHostUdpRcvbufErrors);
+    createParam(PSHostNicRxMissedString,     asynParamInt32,    &PSHostNicRxMissed);
+    createParam(PSHostNicRxDroppedString,    asynParamInt32,    &PSHostNicRxDropped);
+    createParam(PSHostRmemMaxString,         asynParamInt32,    &PSHostRmemMax);
+    setStringParam(PSHostInterface, "");
+    setIntegerParam(PSHostUdpDrops, 0);
+    setIntegerParam(PSHostUdpRcvbufErrors, 0);
+    setIntegerParam(PSHostNicRxMissed, 0);
+    setIntegerParam(PSHostNicRxDropped, 0);
+    setIntegerParam(PSHostRmemMax, 0);
+    this->hostStats.ifName[0] = 0;
+    createParam(PSSoakStateString,           asynParamInt32,    &PSSoakState);
+    createParam(PSSoakMessageString,         asynParamOctet,    &PSSoakMessage);
+    setIntegerParam(PSSoakState, PSSoakIdle);
+    setStringParam(PSSoakMessage, "");
+    createParam(PSEstSizeXString,            asynParamInt32,    &PSEstSizeX);
+    createParam(PSEstSizeYString,            asynParamInt32,    &PSEstSizeY);
+    createParam(PSEstBinXString,             asynParamInt32,    &PSEstBinX);
+    createParam(PSEstBinYString,             asynParamInt32,    &PSEstBinY);
+    createParam(PSEstPixelFormatString,      asynParamInt32,    &PSEstPixelFormat);
+    createParam(PSEstBayerConvertString,     asynParamInt32,    &PSEstBayerConvert);
+    createParam(PSEstAcquireTimeString,      asynParamFloat64,  &PSEstAcquireTime);
+    createParam(PSEstByteRateString,         asynParamInt32,    &PSEstByteRate);
+    createParam(PSEstCopyCurrentString,      asynParamInt32,    &PSEstCopyCurrent);
+    createParam(PSEstFrameRateString,        asynParamFloat64,  &PSEstFrameRate);
+    createParam(PSEstBytesPerSecondString,   asynParamFloat64,  &PSEstBytesPerSecond);
+    createParam(PSEstPacketsPerSecondString, asynParamFloat64,  &PSEstPacketsPerSecond);
+    createParam(PSEstCpuLoadString,          asynParamFloat64,  &PSEstCpuLoad);
+    createParam(PSEstReadoutTimeString,      asynParamFloat64,  &PSEstReadoutTime);
+    createParam(PSEstLimitString,            asynParamInt32,    &PSEstLimit);
+    setIntegerParam(PSEstSizeX, 0);
+    setIntegerParam(PSEstSizeY, 0);
+    setIntegerParam(PSEstBinX, 1);
+    setIntegerParam(PSEstBinY, 1);
+    setIntegerParam(PSEstPixelFormat, ePvFmtMono8);
+    setIntegerParam(PSEstBayerConvert, PSBayerConvertNone);
+    setDoubleParam(PSEstAcquireTime, 0.);
+    setIntegerParam(PSEstByteRate, 0);
+    memset(this->processCost, 0, sizeof(this->processCost));
+    createParam(PSArmString,                 asynParamInt32,    &PSArm);
+    createParam(PSArmedString,               asynParamInt32,    &PSArmed);
+    createParam(PSFirstFrameLatencyString,   asynParamFloat64,  &PSFirstFrameLatency);
+    setIntegerParam(PSArm, 0);
+    setIntegerParam(PSArmed, 0);
+    setDoubleParam(PSFirstFrameLatency, 0.);
+    createParam(PSGateModeString,            asynParamInt32,    &PSGateMode);
+    createParam(PSGateFramesString,          asynParamInt32,    &PSGateFrames);
+    createParam(PSGateOpenString,            asynParamInt32,    &PSGateOpen);
+    createParam(PSGatePointString,           asynParamInt32,    &PSGatePoint);
+    createParam(PSGateDiscardedString,       asynParamInt32,    &PSGateDiscarded);
+    setIntegerParam(PSGateMode, 0);
+    setIntegerParam(PSGateFrames, 1);
+    setIntegerParam(PSGateOpen, 0);
+    setIntegerParam(PSGatePoint, 0);
+    setIntegerParam(PSGateDiscarded, 0);
+    createParam(PSThreadFrameCpuString,      asynParamFloat64,  &PSThreadFrameCpu);
+    createParam(PSThreadFrameVoluntaryString, asynParamInt32,   &PSThreadFrameVoluntary);
+    createParam(PSThreadFrameInvoluntaryString, asynParamInt32, &PSThreadFrameInvoluntary);
+    createParam(PSThreadFrameLastCpuString,  asynParamInt32,    &PSThreadFrameLastCpu);
+    createParam(PSThreadPortCpuString,       asynParamFloat64,  &PSThreadPortCpu);
+    createParam(PSThreadPortVoluntaryString, asynParamInt32,    &PSThreadPortVoluntary);
+    createParam(PSThreadPortInvoluntaryString, asynParamInt32,  &PSThreadPortInvoluntary);
+    createParam(PSThreadPortLastCpuString,   asynParamInt32,    &PSThreadPortLastCpu);
+    createParam(PSThreadBusiestNameString,   asynParamOctet,    &PSThreadBusiestName);
+    createParam(PSThreadBusiestCpuString,    asynParamFloat64,  &PSThreadBusiestCpu);
+    setDoubleParam(PSThreadFrameCpu, 0.);
+    setIntegerParam(PSThreadFrameVoluntary, 0);
+    setIntegerParam(PSThreadFrameInvoluntary, 0);
+    setIntegerParam(PSThreadFrameLastCpu, -1);
+    setDoubleParam(PSThreadPortCpu, 0.);
+    setIntegerParam(PSThreadPortVoluntary, 0);
+    setIntegerParam(PSThreadPortInvoluntary, 0);
+    setIntegerParam(PSThreadPortLastCpu, -1);
+    setStringParam(PSThreadBusiestName, "");
+    setDoubleParam(PSThreadBusiestCpu, 0.);
+    this->threadStats = (psHostThreadStats *)calloc(MAX_THREAD_STATS, sizeof(psHostThreadStats));
+    this->newThreadStats = (psHostThreadStats *)calloc(MAX_THREAD_STATS, sizeof(psHostThreadStats));
+    createParam(PSPerfEnableString,          asynParamInt32,    &PSPerfEnable);
+    createParam(PSPerfStatusString,          asynParamOctet,    &PSPerfStatus);
+    createParam(PSPerfConvertIpcString,      asynParamFloat64,  &PSPerfConvertIpc);
+    createParam(PSPerfConvertCyclesString,   asynParamFloat64,  &PSPerfConvertCycles);
+    createParam(PSPerfConvertLlcString,      asynParamFloat64,  &PSPerfConvertLlc);
+    createParam(PSPerfConvertDtlbString,     asynParamFloat64,  &PSPerfConvertDtlb);
+    createParam(PSPerfAttributesIpcString,   asynParamFloat64,  &PSPerfAttributesIpc);
+    createParam(PSPerfAttributesCyclesString, asynParamFloat64, &PSPerfAttributesCycles);
+    createParam(PSPerfAttributesLlcString,   asynParamFloat64,  &PSPerfAttributesLlc);
+    createParam(PSPerfAttributesDtlbString,  asynParamFloat64,  &PSPerfAttributesDtlb);
+    createParam(PSPerfCallbacksIpcString,    asynParamFloat64,  &PSPerfCallbacksIpc);
+    createParam(PSPerfCallbacksCyclesString, asynParamFloat64,  &PSPerfCallbacksCycles);
+    createParam(PSPerfCallbacksLlcString,    asynParamFloat64,  &PSPerfCallbacksLlc);
+    createParam(PSPerfCallbacksDtlbString,   asynParamFloat64,  &PSPerfCallbacksDtlb);
+    setIntegerParam(PSPerfEnable, 0);
+    setStringParam(PSPerfStatus, "Off");
+    for (int i=PSPerfConvertIpc; i<=PSPerfCallbacksDtlb; i++) setDoubleParam(i, 0.);
+    psPerfInit(&this->perfCounters);
+    memset(this->perfSums, 0, sizeof(this->perfSums));
+    createParam(PSRegionEnableString,        asynParamInt32,    &PSRegionEnable);
+    createParam(PSRegionMinXString,          asynParamInt32,    &PSRegionMinX);
+    createParam(PSRegionMinYString,          asynParamInt32,    &PSRegionMinY);
+    createParam(PSRegionSizeXString,         asynParamInt32,    &PSRegionSizeX);
+    createParam(PSRegionSizeYString,         asynParamInt32,    &PSRegionSizeY);
+    createParam(PSRegionZeroCopyString,      asynParamInt32,    &PSRegionZeroCopy);
+    createParam(PSRoiSeqEnableString,        asynParamInt32,    &PSRoiSeqEnable);
+    createParam(PSRoiSeqStatusString,        asynParamOctet,    &PSRoiSeqStatus);
+    createParam(PSRoiSeqUnmatchedString,     asynParamInt32,    &PSRoiSeqUnmatched);
+    setIntegerParam(PSRoiSeqEnable, 0);
+    setStringParam(PSRoiSeqStatus, "Off");
+    setIntegerParam(PSRoiSeqUnmatched, 0);
+    createParam(PSNumaEnableString,          asynParamInt32,    &PSNumaEnable);
+    createParam(PSNumaStatusString,          asynParamOctet,    &PSNumaStatus);
+    createParam(PSNumaNodeString,            asynParamInt32,    &PSNumaNode);
+    createParam(PSNumaBufferNodeString,      asynParamInt32,    &PSNumaBufferNode);
+    createParam(PSNumaRemoteFramesString,    asynParamInt32,    &PSNumaRemoteFrames);
+    createParam(PSNumaFrameThreadNodeString, asynParamInt32,    &PSNumaFrameThreadNode);
+    createParam(PSNumaPortThreadNodeString,  asynParamInt32,    &PSNumaPortThreadNode);
+    setIntegerParam(PSNumaEnable, 0);
+    setStringParam(PSNumaStatus, "Off");
+    setIntegerParam(PSNumaNode, -1);
+    setIntegerParam(PSNumaBufferNode, -1);
+    setIntegerParam(PSNumaRemoteFrames, 0);
+    setIntegerParam(PSNumaFrameThreadNode, -1);
+    setIntegerParam(PSNumaPortThreadNode, -1);
+    createParam(PSHistoryTimebaseString,     asynParamFloat64Array, &PSHistoryTimebase);
+    createParam(PSHistoryFrameRateString,    asynParamFloat64Array, &PSHistoryFrameRate);
+    createParam(PSHistoryByteRateString,     asynParamFloat64Array, &PSHistoryByteRate);
+    createParam(PSHistoryMissedRateString,   asynParamFloat64Array, &PSHistoryMissedRate);
+    createParam(PSHistoryResentRateString,   asynParamFloat64Array, &PSHistoryResentRate);
+    createParam(PSHistoryErroneousRateString, asynParamFloat64Array, &PSHistoryErroneousRate);
+    createParam(PSHistoryDropRateString,     asynParamFloat64Array, &PSHistoryDropRate);
+    createParam(PSHistoryLatencyP99String,   asynParamFloat64Array, &PSHistoryLatencyP99);
+    createParam(PSHistoryTemperatureSensorString,    asynParamFloat64Array, &PSHistoryTemperatureSensor);
+    createParam(PSHistoryTemperatureMainboardString, asynParamFloat64Array, &PSHistoryTemperatureMainboard);
+    createParam(PSArrivalOffsetString,       asynParamFloat64,  &PSArrivalOffset);
+    createParam(PSArrivalModelDelayString,   asynParamFloat64,  &PSArrivalModelDelay);
+    createParam(PSArrivalLatencyString,      asynParamFloat64,  &PSArrivalLatency);
+    setDoubleParam(PSArrivalOffset, 0.);
+    setDoubleParam(PSArrivalModelDelay, 0.);
+    setDoubleParam(PSArrivalLatency, 0.);
+    createParam(PSAttrSortString,            asynParamInt32,    &PSAttrSort);
+    createParam(PSAttrResetString,           asynParamInt32,    &PSAttrReset);
+    createParam(PSAttrCallsString,           asynParamInt32,    &PSAttrCalls);
+    createParam(PSAttrErrorsString,          asynParamInt32,    &PSAttrErrors);
+    createParam(PSAttrTimeString,            asynParamFloat64,  &PSAttrTime);
+    createParam(PSAttrSlowestString,         asynParamOctet,    &PSAttrSlowest);
+    createParam(PSAttrSlowMeanString,        asynParamFloat64Array, &PSAttrSlowMean);
+    createParam(PSAttrSlowMaxString,         asynParamFloat64Array, &PSAttrSlowMax);
+    setIntegerParam(PSAttrSort, PSAttrSortMean);
+    setIntegerParam(PSAttrReset, 0);
+    setIntegerParam(PSAttrCalls, 0);
+    setIntegerParam(PSAttrErrors, 0);
+    setDoubleParam(PSAttrTime, 0.);
+    setStringParam(PSAttrSlowest, "");
+    psAttrStatsInit(&this->attrStats);
+    this->numAttrSlow = 0;
+    memset(this->historyCounters, 0, sizeof(this->historyCounters));
+    psHistoryCreate(&this->history, NUM_HISTORY_SERIES, HISTORY_SIZE);
+    for (int addr=1; addr<=NUM_REGIONS; addr++) {
+        setIntegerParam(addr, PSRegionEnable, 0);
+        setIntegerParam(addr, PSRegionMinX, 0);
+        setIntegerParam(addr, PSRegionMinY, 0);
+        setIntegerParam(addr, PSRegionSizeX, 0);
+        setIntegerParam(addr, PSRegionSizeY, 0);
+        setIntegerParam(addr, PSRegionZeroCopy, 0);
+        setIntegerParam(addr, NDArrayCounter, 0);
+        callParamCallbacks(addr);
+    }
+    this->pViewPool = new psViewPool(this);
+    /* Use our pool instead of the one of asynNDArrayDriver, which has not allocated anything yet.
+     * asynNDArrayDriver keeps its own pointer to that pool and deletes it, so it is not deleted
+     * here; it is put back in the destructor, which deletes our pools. */
+    this->pBasePool = this->pNDArrayPool;
+    this->pNumaPool = new psNumaPool(this, maxMemory);
+    this->pNDArrayPool = this->pNumaPool;
+
+    /* The synthetic frames get their buffers when they are first injected */
+    memset(this->synthFrames, 0, sizeof(this->synthFrames));
+    for (int i=0; i<NUM_SYNTH_FRAMES; i++) this->synthFree[this->numSynthFree++] = &this->synthFrames[i];
+    this->stressDoneEvent = epicsEventMustCreate(epicsEventEmpty);
 
     /* There is a conflict with readline use of signals, don't use readline signal handlers */
 #ifdef linux
     rl_catch_signals = 0;
 #endif
 
+    /* Create the ROI sequence task, it waits until a frame arrives during a sequence */
+    this->roiSeqMutex = epicsMutexMustCreate();
+    this->roiSeqEvent = epicsEventMustCreate(epicsEventEmpty);
+    if (!epicsThreadCreate("prosilicaRoiSeq", epicsThreadPriorityHigh,
+                           epicsThreadGetStackSize(epicsThreadStackMedium),
+                           (EPICSTHREADFUNC)roiSeqTaskC, this)) {
+        printf("%s:%s: epicsThreadCreate failure for ROI sequence task\n", driverName, functionName);
+        return;
+    }
+
+    /* Create the sync input poller, it waits until the monitor is in Poll mode */
+    this->syncInPollEvent = epicsEventMustCreate(epicsEventEmpty);
+    if (!epicsThreadCreate("prosilicaSyncIn", epicsThreadPriorityHigh,
+                           epicsThreadGetStackSize(epicsThreadStackMedium),
+                           (EPICSTHREADFUNC)syncInPollTaskC, this)) {
+        printf("%s:%s: epicsThreadCreate failure for sync input poller\n", driverName, functionName);
+        return;
+    }
+
+    /* Create the GPO program thread.  It runs at the highest priority to meet its deadlines. */
+    this->gpoProgramEvent = epicsEventMustCreate(epicsEventEmpty);
+    this->gpoMutex = epicsMutexMustCreate();
+    if (!epicsThreadCreate("prosilicaGpo", epicsThreadPriorityMax,
+                           epicsThreadGetStackSize(epicsThreadStackMedium),
+                           (EPICSTHREADFUNC)gpoProgramTaskC, this)) {
+        printf("%s:%s: epicsThreadCreate failure for GPO program thread\n", driverName, functionName);
+        return;
+    }
+
+    /* Create the stream health history thread */
+    if (!epicsThreadCreate("prosilicaHistory", epicsThreadPriorityLow,
+                           epicsThreadGetStackSize(epicsThreadStackMedium),
+                           (EPICSTHREADFUNC)historyTaskC, this)) {
+        printf("%s:%s: epicsThreadCreate failure for history thread\n", driverName, functionName);
+        return;
+    }
+
     /* Set default value of maxPvAPIFrames_ if it is zero */
     if (maxPvAPIFrames_ == 0) maxPvAPIFrames_ = MAX_PVAPI_FRAMES;
     /* Create the PvFrames buffer.  Note that these structures must be set to 0! */
     PvFrames = (tPvFrame *)calloc(maxPvAPIFrames_, sizeof(tPvFrame));
+    parkedFrames = (tPvFrame **)calloc(maxPvAPIFrames_, sizeof(tPvFrame *));
     
 
     /* Initialize the Prosilica PvAPI library 
      * We get an error if we call this twice, so we need a global flag to see if 
      * it's already been done.*/
     if (!PvApiInitialized) {
-        status = PvInitialize();
+        if (PvApiNoDiscovery)
+            status = PvInitializeNoDiscovery();
+        else
+            status = PvInitialize();
         if (status) {
             printf("%s:%s: ERROR: PvInitialize failed, status=%d\n", 
             driverName, functionName, status);
@@ -1927,11 +6753,26 @@ prosilica::prosilica(const char *portName, const char *cameraId, int maxBuffers,
            printf("PvLinkCallbackRegister err: %u\n", errCode);
 
         PvApiInitialized = 1;
+
+        if ((discoveryRefreshPeriod > 0) &&
+            !epicsThreadCreate("prosilicaDiscovery", epicsThreadPriorityLow,
+                               epicsThreadGetStackSize(epicsThreadStackMedium),
+                               (EPICSTHREADFUNC)discoveryRefreshTask, NULL)) {
+            printf("%s:%s: epicsThreadCreate failure for camera cache refresh\n", driverName, functionName);
+        }
     }
 
     /* Need to wait a short while for the PvAPI library to find the cameras */
     /* (0.2 seconds is not long enough in 1.24) */
-    epicsThreadSleep(1.0);
+    /* A camera which is opened by its address does not need to be found, and the wait for
+     * one which is opened by its UniqueId ends as soon as the library has found it */
+    if (!PvApiNoDiscovery && isUniqueIdString(cameraId) &&
+        (psCacheLookup(atoi(cameraId), cachedAddress, sizeof(cachedAddress)) != 0)) {
+        for (waited=0.; waited<1.0; waited+=0.05) {
+            if (PvCameraInfoEx(atoi(cameraId), &cameraInfo, sizeof(cameraInfo)) == ePvErrSuccess) break;
+            epicsThreadSleep(0.05);
+        }
+    }
  
     if ( this->PvHandle == NULL ) {
         /* Try to connect to the camera.  
@@ -1946,6 +6787,29 @@ prosilica::prosilica(const char *portName, const char *cameraId, int maxBuffers,
         }
     }
  
+    /* The region addresses do not depend on the camera, so they are connected now.  The port
+     * is not autoConnect, since address 0 is only connected when the camera is. */
+    for (addr=1; addr<=NUM_REGIONS; addr++) {
+        pasynUser = pasynManager->createAsynUser(0, 0);
+        if ((pasynManager->connectDevice(pasynUser, portName, addr) != asynSuccess) ||
+            (pasynManager->exceptionConnect(pasynUser) != asynSuccess)) {
+            printf("%s:%s: cannot connect address %d\n", driverName, functionName, addr);
+        }
+        pasynManager->disconnect(pasynUser);
+        pasynManager->freeAsynUser(pasynUser);
+    }
+
+    /* Find the Linux thread ID of the port thread.  A connect priority request runs even
+     * when the port is not connected. */
+    pasynUser = pasynManager->createAsynUser(portThreadStartC, 0);
+    pasynUser->userPvt = this;
+    if ((pasynManager->connectDevice(pasynUser, portName, 0) != asynSuccess) ||
+        (pasynManager->queueRequest(pasynUser, asynQueuePriorityConnect, 0.) != asynSuccess)) {
+        printf("%s:%s: cannot queue the port thread request\n", driverName, functionName);
+        pasynManager->disconnect(pasynUser);
+        pasynManager->freeAsynUser(pasynUser);
+    }
+
     /* Register the shutdown function for epicsAtExit */
     epicsAtExit(shutdown, (void*)this);
 }
@@ -1973,10 +6837,126 @@ static void configprosilicaCallFunc(const iocshArgBuf *args)
 }
 
 
+static const iocshArg prosilicaGroupConfigArg0 = {"Group name", iocshArgString};
+static const iocshArg prosilicaGroupConfigArg1 = {"Camera port names", iocshArgString};
+static const iocshArg prosilicaGroupConfigArg2 = {"Tolerance (seconds)", iocshArgDouble};
+static const iocshArg * const prosilicaGroupConfigArgs[] = {&prosilicaGroupConfigArg0,
+                                                            &prosilicaGroupConfigArg1,
+                                                            &prosilicaGroupConfigArg2};
+static const iocshFuncDef configprosilicaGroup = {"prosilicaGroupConfig", 3, prosilicaGroupConfigArgs};
+static void configprosilicaGroupCallFunc(const iocshArgBuf *args)
+{
+    prosilicaGroupConfig(args[0].sval, args[1].sval, args[2].dval);
+}
+
+
+static const iocshArg prosilicaHostStatsReportArg0 = {"Camera IP address", iocshArgString};
+static const iocshArg prosilicaHostStatsReportArg1 = {"Root directory", iocshArgString};
+static const iocshArg * const prosilicaHostStatsReportArgs[] = {&prosilicaHostStatsReportArg0,
+                                                                &prosilicaHostStatsReportArg1};
+static const iocshFuncDef reportprosilicaHostStats = {"prosilicaHostStatsReport", 2, prosilicaHostStatsReportArgs};
+static void reportprosilicaHostStatsCallFunc(const iocshArgBuf *args)
+{
+    prosilicaHostStatsReport(args[0].sval, args[1].sval);
+}
+
+
+static const iocshArg prosilicaSoakArg0 = {"Port name", iocshArgString};
+static const iocshArg prosilicaSoakArg1 = {"Hours (0 to stop)", iocshArgDouble};
+static const iocshArg prosilicaSoakArg2 = {"Cycle period (seconds)", iocshArgDouble};
+static const iocshArg prosilicaSoakArg3 = {"Tolerance", iocshArgDouble};
+static const iocshArg * const prosilicaSoakArgs[] = {&prosilicaSoakArg0,
+                                                     &prosilicaSoakArg1,
+                                                     &prosilicaSoakArg2,
+                                                     &prosilicaSoakArg3};
+static const iocshFuncDef soakprosilica = {"prosilicaSoak", 4, prosilicaSoakArgs};
+static void soakprosilicaCallFunc(const iocshArgBuf *args)
+{
+    prosilicaSoak(args[0].sval, args[1].dval, args[2].dval, args[3].dval);
+}
+
+
+static const iocshArg prosilicaStressArg0 = {"Port name", iocshArgString};
+static const iocshArg prosilicaStressArg1 = {"Seconds (0 to stop)", iocshArgDouble};
+static const iocshArg prosilicaStressArg2 = {"Writer threads", iocshArgInt};
+static const iocshArg prosilicaStressArg3 = {"Link event period (seconds)", iocshArgDouble};
+static const iocshArg * const prosilicaStressArgs[] = {&prosilicaStressArg0,
+                                                       &prosilicaStressArg1,
+                                                       &prosilicaStressArg2,
+                                                       &prosilicaStressArg3};
+static const iocshFuncDef stressprosilica = {"prosilicaStress", 4, prosilicaStressArgs};
+static void stressprosilicaCallFunc(const iocshArgBuf *args)
+{
+    prosilicaStress(args[0].sval, args[1].dval, args[2].ival, args[3].dval);
+}
+
+
+static const iocshArg prosilicaHeadroomArg0 = {"Port name", iocshArgString};
+static const iocshArg prosilicaHeadroomArg1 = {"SizeX (0 for the ROI, -1 to stop)", iocshArgInt};
+static const iocshArg prosilicaHeadroomArg2 = {"SizeY (0 for the ROI, -1 to stop)", iocshArgInt};
+static const iocshArg prosilicaHeadroomArg3 = {"Pixel format", iocshArgString};
+static const iocshArg prosilicaHeadroomArg4 = {"Plugin port names", iocshArgString};
+static const iocshArg * const prosilicaHeadroomArgs[] = {&prosilicaHeadroomArg0,
+                                                         &prosilicaHeadroomArg1,
+                                                         &prosilicaHeadroomArg2,
+                                                         &prosilicaHeadroomArg3,
+                                                         &prosilicaHeadroomArg4};
+static const iocshFuncDef headroomprosilica = {"prosilicaHeadroom", 5, prosilicaHeadroomArgs};
+static void headroomprosilicaCallFunc(const iocshArgBuf *args)
+{
+    prosilicaHeadroom(args[0].sval, args[1].ival, args[2].ival, args[3].sval, args[4].sval);
+}
+
+
+static const iocshArg prosilicaAttrReportArg0 = {"Port name", iocshArgString};
+static const iocshArg prosilicaAttrReportArg1 = {"Sort (0=mean, 1=max, 2=total)", iocshArgInt};
+static const iocshArg prosilicaAttrReportArg2 = {"Reset (0 or 1)", iocshArgInt};
+static const iocshArg * const prosilicaAttrReportArgs[] = {&prosilicaAttrReportArg0,
+                                                           &prosilicaAttrReportArg1,
+                                                           &prosilicaAttrReportArg2};
+static const iocshFuncDef attrReportprosilica = {"prosilicaAttrReport", 3, prosilicaAttrReportArgs};
+static void attrReportprosilicaCallFunc(const iocshArgBuf *args)
+{
+    prosilicaAttrReport(args[0].sval, args[1].ival, args[2].ival);
+}
+
+
+static const iocshArg prosilicaDiscoveryConfigArg0 = {"No discovery (0 or 1)", iocshArgInt};
+static const iocshArg prosilicaDiscoveryConfigArg1 = {"Cache file", iocshArgString};
+static const iocshArg prosilicaDiscoveryConfigArg2 = {"Refresh period (seconds)", iocshArgDouble};
+static const iocshArg * const prosilicaDiscoveryConfigArgs[] = {&prosilicaDiscoveryConfigArg0,
+                                                                &prosilicaDiscoveryConfigArg1,
+                                                                &prosilicaDiscoveryConfigArg2};
+static const iocshFuncDef configprosilicaDiscovery = {"prosilicaDiscoveryConfig", 3, prosilicaDiscoveryConfigArgs};
+static void configprosilicaDiscoveryCallFunc(const iocshArgBuf *args)
+{
+    prosilicaDiscoveryConfig(args[0].ival, args[1].sval, args[2].dval);
+}
+
+
+static const iocshArg prosilicaMetricsArg0 = {"File name", iocshArgString};
+static const iocshArg prosilicaMetricsArg1 = {"Period (seconds)", iocshArgDouble};
+static const iocshArg * const prosilicaMetricsArgs[] = {&prosilicaMetricsArg0,
+                                                        &prosilicaMetricsArg1};
+static const iocshFuncDef metricsprosilica = {"prosilicaMetrics", 2, prosilicaMetricsArgs};
+static void metricsprosilicaCallFunc(const iocshArgBuf *args)
+{
+    prosilicaMetrics(args[0].sval, args[1].dval);
+}
+
+
 static void prosilicaRegister(void)
 {
 
     iocshRegister(&configprosilica, configprosilicaCallFunc);
+    iocshRegister(&configprosilicaGroup, configprosilicaGroupCallFunc);
+    iocshRegister(&reportprosilicaHostStats, reportprosilicaHostStatsCallFunc);
+    iocshRegister(&soakprosilica, soakprosilicaCallFunc);
+    iocshRegister(&stressprosilica, stressprosilicaCallFunc);
+    iocshRegister(&headroomprosilica, headroomprosilicaCallFunc);
+    iocshRegister(&attrReportprosilica, attrReportprosilicaCallFunc);
+    iocshRegister(&configprosilicaDiscovery, configprosilicaDiscoveryCallFunc);
+    iocshRegister(&metricsprosilica, metricsprosilicaCallFunc);
 }
 
 extern "C" {
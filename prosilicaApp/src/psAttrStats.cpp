@@ -0,0 +1,174 @@
+/* psAttrStats.cpp
+ *
+ * Latency accounting of the PvAPI attribute calls, see psAttrStats.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "psAttrStats.h"
+
+/* Upper bounds of the latency histogram buckets in seconds */
+static const double latencyBounds[PS_ATTR_LATENCY_BUCKETS] = {
+    0.0005, 0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5
+};
+
+static const char *opNames[PSAttrNumOps] = {"get", "set", "command"};
+
+const char *psAttrOpName(PSAttrOp_t op)
+{
+    if ((op < 0) || (op >= PSAttrNumOps)) return "";
+    return opNames[op];
+}
+
+int psAttrStatsInit(psAttrStats *pStats)
+{
+    memset(pStats, 0, sizeof(*pStats));
+    pStats->mutex = epicsMutexCreate();
+    return pStats->mutex ? 0 : -1;
+}
+
+/* FNV-1a hash of the operation and the name */
+static unsigned int hashEntry(PSAttrOp_t op, const char *name)
+{
+    unsigned int hash = 2166136261u ^ (unsigned int)op;
+
+    for (; *name; name++) {
+        hash ^= (unsigned char)*name;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void psAttrStatsAdd(psAttrStats *pStats, PSAttrOp_t op, const char *name, double seconds, int error)
+{
+    psAttrEntry *pEntry = NULL;
+    unsigned int slot;
+    int i, bucket;
+
+    if (seconds < 0.) seconds = 0.;
+    for (bucket=0; bucket<PS_ATTR_LATENCY_BUCKETS; bucket++) {
+        if (seconds <= latencyBounds[bucket]) break;
+    }
+    epicsMutexLock(pStats->mutex);
+    pStats->calls++;
+    if (error) pStats->errors++;
+    pStats->totalTime += seconds;
+    /* Open addressing; the table is never filled beyond 3/4 so the probe ends quickly */
+    slot = hashEntry(op, name) & (PS_ATTR_MAX_ENTRIES - 1);
+    for (i=0; i<PS_ATTR_MAX_ENTRIES; i++, slot = (slot + 1) & (PS_ATTR_MAX_ENTRIES - 1)) {
+        psAttrEntry *pSlot = &pStats->entries[slot];
+        if (pSlot->name[0] == 0) {
+            if (pStats->numEntries >= PS_ATTR_MAX_ENTRIES * 3 / 4) break;
+            strncpy(pSlot->name, name, PS_ATTR_NAME_SIZE-1);
+            pSlot->op = op;
+            pStats->numEntries++;
+            pEntry = pSlot;
+            break;
+        }
+        if ((pSlot->op == op) && (strncmp(pSlot->name, name, PS_ATTR_NAME_SIZE-1) == 0)) {
+            pEntry = pSlot;
+            break;
+        }
+    }
+    if (pEntry) {
+        pEntry->calls++;
+        if (error) pEntry->errors++;
+        pEntry->counts[bucket]++;
+        pEntry->totalTime += seconds;
+        if (seconds > pEntry->maxTime) pEntry->maxTime = seconds;
+    }
+    epicsMutexUnlock(pStats->mutex);
+}
+
+void psAttrStatsReset(psAttrStats *pStats)
+{
+    epicsMutexLock(pStats->mutex);
+    memset(pStats->entries, 0, sizeof(pStats->entries));
+    pStats->numEntries = 0;
+    pStats->calls = 0;
+    pStats->errors = 0;
+    pStats->totalTime = 0.;
+    epicsMutexUnlock(pStats->mutex);
+}
+
+void psAttrStatsTotals(psAttrStats *pStats, epicsUInt32 *pCalls, epicsUInt32 *pErrors, double *pTotalTime)
+{
+    epicsMutexLock(pStats->mutex);
+    *pCalls = pStats->calls;
+    *pErrors = pStats->errors;
+    *pTotalTime = pStats->totalTime;
+    epicsMutexUnlock(pStats->mutex);
+}
+
+static double meanTime(const psAttrEntry *pEntry)
+{
+    return pEntry->calls ? pEntry->totalTime / pEntry->calls : 0.;
+}
+
+static int compareMean(const void *p1, const void *p2)
+{
+    double t1 = meanTime((const psAttrEntry *)p1), t2 = meanTime((const psAttrEntry *)p2);
+
+    return (t1 < t2) - (t1 > t2);
+}
+
+static int compareMax(const void *p1, const void *p2)
+{
+    double t1 = ((const psAttrEntry *)p1)->maxTime, t2 = ((const psAttrEntry *)p2)->maxTime;
+
+    return (t1 < t2) - (t1 > t2);
+}
+
+static int compareTotal(const void *p1, const void *p2)
+{
+    double t1 = ((const psAttrEntry *)p1)->totalTime, t2 = ((const psAttrEntry *)p2)->totalTime;
+
+    return (t1 < t2) - (t1 > t2);
+}
+
+int psAttrStatsSorted(psAttrStats *pStats, PSAttrSort_t sort, psAttrEntry *pOut, int maxOut)
+{
+    psAttrEntry *pAll;
+    int i, n = 0;
+
+    pAll = (psAttrEntry *)malloc(PS_ATTR_MAX_ENTRIES * sizeof(psAttrEntry));
+    if (!pAll) return 0;
+    epicsMutexLock(pStats->mutex);
+    for (i=0; i<PS_ATTR_MAX_ENTRIES; i++) {
+        if (pStats->entries[i].name[0]) pAll[n++] = pStats->entries[i];
+    }
+    epicsMutexUnlock(pStats->mutex);
+    qsort(pAll, n, sizeof(psAttrEntry),
+          (sort == PSAttrSortMax) ? compareMax : (sort == PSAttrSortTotal) ? compareTotal : compareMean);
+    if (n > maxOut) n = maxOut;
+    memcpy(pOut, pAll, n * sizeof(psAttrEntry));
+    free(pAll);
+    return n;
+}
+
+void psAttrStatsReport(psAttrStats *pStats, PSAttrSort_t sort, FILE *fp)
+{
+    psAttrEntry *pEntries;
+    epicsUInt32 calls, errors;
+    double totalTime;
+    int i, j, n;
+
+    pEntries = (psAttrEntry *)malloc(PS_ATTR_MAX_ENTRIES * sizeof(psAttrEntry));
+    if (!pEntries) return;
+    n = psAttrStatsSorted(pStats, sort, pEntries, PS_ATTR_MAX_ENTRIES);
+    psAttrStatsTotals(pStats, &calls, &errors, &totalTime);
+    fprintf(fp, "%-32s %-7s %8s %6s %9s %9s %9s  Calls to ms", "Attribute", "Op", "Calls", "Errors",
+            "Mean ms", "Max ms", "Total s");
+    for (j=0; j<PS_ATTR_LATENCY_BUCKETS; j++) fprintf(fp, " %6g", latencyBounds[j]*1e3);
+    fprintf(fp, " %6s\n", "longer");
+    for (i=0; i<n; i++) {
+        fprintf(fp, "%-32s %-7s %8u %6u %9.3f %9.3f %9.3f             ", pEntries[i].name,
+                psAttrOpName(pEntries[i].op), pEntries[i].calls, pEntries[i].errors,
+                meanTime(&pEntries[i]) * 1e3, pEntries[i].maxTime * 1e3, pEntries[i].totalTime);
+        for (j=0; j<=PS_ATTR_LATENCY_BUCKETS; j++) fprintf(fp, " %6u", pEntries[i].counts[j]);
+        fprintf(fp, "\n");
+    }
+    fprintf(fp, "%u calls, %u errors, %.3f s in total\n", calls, errors, totalTime);
+    free(pEntries);
+}
@@ -0,0 +1,70 @@
+/* psAttrStats.h
+ *
+ * Latency and error counts of the PvAPI attribute accesses and commands of a camera,
+ * kept for each attribute name.
+ *
+ * Each operation (get, set or command) on an attribute has its own entry, with a histogram
+ * of the call time, the total and maximum time, and the number of calls which failed.  The
+ * entries are found by a hash of the name, so counting a call costs far less than the call
+ * over the GigE control channel.  The functions take a mutex, so any thread can call them.
+ */
+
+#ifndef PS_ATTR_STATS_H
+#define PS_ATTR_STATS_H
+
+#include <stdio.h>
+#include <epicsTypes.h>
+#include <epicsMutex.h>
+
+#define PS_ATTR_MAX_ENTRIES      256  /* Size of the hash table, a power of 2 */
+#define PS_ATTR_NAME_SIZE         40
+#define PS_ATTR_LATENCY_BUCKETS   10  /* Buckets with an upper bound, plus one for longer calls */
+
+typedef enum {
+    PSAttrGet,
+    PSAttrSet,
+    PSAttrCommand,
+    PSAttrNumOps
+} PSAttrOp_t;
+
+/* The orders of psAttrStatsSorted, slowest first */
+typedef enum {
+    PSAttrSortMean,
+    PSAttrSortMax,
+    PSAttrSortTotal
+} PSAttrSort_t;
+
+typedef struct psAttrEntry {
+    char name[PS_ATTR_NAME_SIZE];  /* Empty for an unused entry */
+    PSAttrOp_t op;
+    epicsUInt32 calls;
+    epicsUInt32 errors;
+    epicsUInt32 counts[PS_ATTR_LATENCY_BUCKETS+1];
+    double totalTime;              /* Seconds */
+    double maxTime;
+} psAttrEntry;
+
+typedef struct psAttrStats {
+    epicsMutexId mutex;            /* Protects everything below */
+    psAttrEntry entries[PS_ATTR_MAX_ENTRIES];
+    int numEntries;
+    epicsUInt32 calls;             /* All calls, including those not in a full table */
+    epicsUInt32 errors;
+    double totalTime;
+} psAttrStats;
+
+/* Creates the mutex and clears the counts.  Returns 0 on success. */
+int psAttrStatsInit(psAttrStats *pStats);
+/* Counts one call of op on the attribute name which took seconds, and failed if error is not 0 */
+void psAttrStatsAdd(psAttrStats *pStats, PSAttrOp_t op, const char *name, double seconds, int error);
+void psAttrStatsReset(psAttrStats *pStats);
+/* Copies the totals of all calls */
+void psAttrStatsTotals(psAttrStats *pStats, epicsUInt32 *pCalls, epicsUInt32 *pErrors, double *pTotalTime);
+/* Copies up to maxOut entries in the order sort, slowest first.  Returns the number copied. */
+int psAttrStatsSorted(psAttrStats *pStats, PSAttrSort_t sort, psAttrEntry *pOut, int maxOut);
+/* Prints all of the entries with their histograms, in the order sort */
+void psAttrStatsReport(psAttrStats *pStats, PSAttrSort_t sort, FILE *fp);
+/* Returns "get", "set" or "command" */
+const char *psAttrOpName(PSAttrOp_t op);
+
+#endif /* PS_ATTR_STATS_H */
@@ -0,0 +1,59 @@
+/* psBayerKernels.cpp
+ *
+ * Pixel kernels for the Bayer frames of the prosilica driver, see psBayerKernels.h.
+ */
+
+#include <string.h>
+
+#include "psBayerKernels.h"
+
+/* Columns processed at a time, so the column sums of a tile stay in the L1 cache */
+#define LUMINANCE_TILE 512
+
+/* T is the pixel type and S a type which holds 16 times the largest pixel value */
+template <typename T, typename S>
+static void bayerLuminance(const T *pIn, T *pOut, int width, int height)
+{
+    S sums[LUMINANCE_TILE + 2];
+    const T *pAbove, *pRow, *pBelow;
+    T *pDest;
+    int x0, n, i, col, y;
+
+    if ((width < 2) || (height < 2)) {
+        memcpy(pOut, pIn, (size_t)width * height * sizeof(T));
+        return;
+    }
+    for (y=0; y<height; y++) {
+        /* Row -1 is row 1 and row height is row height-2, so the colours keep their weights */
+        pAbove = pIn + (size_t)(y > 0 ? y-1 : 1) * width;
+        pRow   = pIn + (size_t)y * width;
+        pBelow = pIn + (size_t)(y < height-1 ? y+1 : height-2) * width;
+        pDest  = pOut + (size_t)y * width;
+        for (x0=0; x0<width; x0+=LUMINANCE_TILE) {
+            n = width - x0;
+            if (n > LUMINANCE_TILE) n = LUMINANCE_TILE;
+            /* Vertical [1 2 1] sums of columns x0-1 to x0+n, mirrored at the edges */
+            col = (x0 > 0) ? x0-1 : 1;
+            sums[0] = (S)(pAbove[col] + 2*pRow[col] + pBelow[col]);
+            for (i=0; i<n; i++) {
+                sums[i+1] = (S)(pAbove[x0+i] + 2*pRow[x0+i] + pBelow[x0+i]);
+            }
+            col = (x0+n < width) ? x0+n : width-2;
+            sums[n+1] = (S)(pAbove[col] + 2*pRow[col] + pBelow[col]);
+            /* Horizontal [1 2 1] and the rounded division by 16 */
+            for (i=0; i<n; i++) {
+                pDest[x0+i] = (T)((sums[i] + 2*sums[i+1] + sums[i+2] + 8) >> 4);
+            }
+        }
+    }
+}
+
+void psBayerLuminance8(const epicsUInt8 *pIn, epicsUInt8 *pOut, int width, int height)
+{
+    bayerLuminance<epicsUInt8, epicsUInt16>(pIn, pOut, width, height);
+}
+
+void psBayerLuminance16(const epicsUInt16 *pIn, epicsUInt16 *pOut, int width, int height)
+{
+    bayerLuminance<epicsUInt16, epicsUInt32>(pIn, pOut, width, height);
+}
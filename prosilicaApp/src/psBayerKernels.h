@@ -0,0 +1,22 @@
+/* psBayerKernels.h
+ *
+ * Pixel kernels for the Bayer frames of the prosilica driver.
+ *
+ * The kernels are written as simple loops over contiguous rows with no branches in the
+ * inner loops, so that the compiler vectorizes them for the SIMD instructions of the target.
+ */
+
+#ifndef PS_BAYER_KERNELS_H
+#define PS_BAYER_KERNELS_H
+
+#include <epicsTypes.h>
+
+/* Computes the luminance of every pixel of a Bayer mosaic, without reconstructing the colours.
+ * Each output pixel is the mosaic filtered with the 3x3 kernel [1 2 1]x[1 2 1]/16, which weights
+ * red, green and blue 1:2:1 whatever the position in the pattern, so the result does not depend on
+ * the Bayer pattern.  The edges are mirrored, which keeps the pattern phase.  pIn and pOut must not
+ * overlap.  Images less than 2 pixels wide or high are copied. */
+void psBayerLuminance8(const epicsUInt8 *pIn, epicsUInt8 *pOut, int width, int height);
+void psBayerLuminance16(const epicsUInt16 *pIn, epicsUInt16 *pOut, int width, int height);
+
+#endif /* PS_BAYER_KERNELS_H */
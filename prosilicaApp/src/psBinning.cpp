@@ -0,0 +1,79 @@
+/* psBinning.cpp
+ *
+ * Software binning of the frames of the prosilica driver, see psBinning.h.
+ */
+
+#include <stddef.h>
+
+#include "psBinning.h"
+
+/* Input columns summed at a time, rounded down to whole output cells by binImage.  The column
+ * sums of a tile stay in the L1 cache. */
+#define BIN_TILE 2048
+
+int psBinSize(int size, int bin, int cell)
+{
+    if ((bin < 1) || (cell < 1)) return 0;
+    return (size / (cell * bin)) * cell;
+}
+
+template <typename TI, typename TO>
+static void binImage(const TI *pIn, int width, int height, TO *pOut,
+                     int binX, int binY, int cell, int average)
+{
+    epicsUInt32 sums[BIN_TILE];
+    epicsUInt32 maxOut = (epicsUInt32)(TO)~0;
+    double scale = 1. / (binX * binY);
+    int outWidth = psBinSize(width, binX, cell);
+    int outHeight = psBinSize(height, binY, cell);
+    int group = cell * binX;       /* Input columns of one output cell */
+    int tile = (BIN_TILE / group) * group;
+    int usedWidth = outWidth * binX;
+    const TI *pRow;
+    TO *pDest;
+    epicsUInt32 sum;
+    int oy, y, j, x0, n, i, g, p, k;
+
+    for (oy=0; oy<outHeight; oy++) {
+        /* First input row of this output row, and the rows of the same colour below it */
+        y = cell * binY * (oy / cell) + (oy % cell);
+        pDest = pOut + (size_t)oy * outWidth;
+        for (x0=0; x0<usedWidth; x0+=tile) {
+            n = usedWidth - x0;
+            if (n > tile) n = tile;
+            for (i=0; i<n; i++) sums[i] = 0;
+            for (j=0; j<binY; j++) {
+                pRow = pIn + (size_t)(y + cell*j) * width + x0;
+                for (i=0; i<n; i++) sums[i] += pRow[i];
+            }
+            /* Add the columns of the same colour in each cell */
+            for (g=0; g<n; g+=group) {
+                for (p=0; p<cell; p++) {
+                    sum = 0;
+                    for (k=0; k<binX; k++) sum += sums[g + p + cell*k];
+                    if (average) sum = (epicsUInt32)(sum * scale + 0.5);
+                    else if (sum > maxOut) sum = maxOut;
+                    pDest[x0/binX + g/binX + p] = (TO)sum;
+                }
+            }
+        }
+    }
+}
+
+int psBinImage(const void *pIn, int inBytes, int width, int height, void *pOut, int outBytes,
+               int binX, int binY, int cell, int average)
+{
+    if ((binX < 1) || (binX > PS_BIN_MAX) || (binY < 1) || (binY > PS_BIN_MAX) ||
+        (cell < 1) || (cell > 2)) return -1;
+    if ((inBytes == 1) && (outBytes == 2))
+        binImage((const epicsUInt8 *)pIn, width, height, (epicsUInt16 *)pOut, binX, binY, cell, average);
+    else if ((inBytes == 1) && (outBytes == 4))
+        binImage((const epicsUInt8 *)pIn, width, height, (epicsUInt32 *)pOut, binX, binY, cell, average);
+    else if ((inBytes == 2) && (outBytes == 2))
+        binImage((const epicsUInt16 *)pIn, width, height, (epicsUInt16 *)pOut, binX, binY, cell, average);
+    else if ((inBytes == 2) && (outBytes == 4))
+        binImage((const epicsUInt16 *)pIn, width, height, (epicsUInt32 *)pOut, binX, binY, cell, average);
+    else
+        return -1;
+    return 0;
+}
@@ -0,0 +1,28 @@
+/* psBinning.h
+ *
+ * Software binning of the frames of the prosilica driver.
+ *
+ * A frame is binned binX by binY pixels into an UInt16 or UInt32 image, summing or averaging.
+ * A Bayer mosaic is binned with a cell of 2, so that only the sites of the same colour are added
+ * and the output is a mosaic with the same pattern.  The input rows are accumulated into 32-bit
+ * column sums a tile at a time, in loops which the compiler vectorizes.
+ */
+
+#ifndef PS_BINNING_H
+#define PS_BINNING_H
+
+#include <epicsTypes.h>
+
+#define PS_BIN_MAX 64 /* Largest binning factor in each direction */
+
+/* Returns the binned size of a dimension.  cell is 1 for Mono images and 2 for Bayer mosaics,
+ * for which the size is rounded down to whole 2x2 cells. */
+int psBinSize(int size, int bin, int cell);
+
+/* Bins an image.  inBytes is 1 or 2 (UInt8 or UInt16 pixels) and outBytes is 2 or 4 (UInt16 or
+ * UInt32).  Sums which do not fit in the output are clipped.  The pixels left over at the right
+ * and bottom edges are dropped.  Returns 0 on success, -1 if the arguments are not supported. */
+int psBinImage(const void *pIn, int inBytes, int width, int height, void *pOut, int outBytes,
+               int binX, int binY, int cell, int average);
+
+#endif /* PS_BINNING_H */
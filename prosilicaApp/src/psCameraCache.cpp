@@ -0,0 +1,180 @@
+/* psCameraCache.cpp
+ *
+ * Cache of camera IP addresses, see psCameraCache.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <epicsMutex.h>
+#include <epicsThread.h>
+#include <epicsString.h>
+#include <epicsStdio.h>
+
+#include "psCameraCache.h"
+
+#define MAX_CACHE_CAMERAS 256
+#define MAX_LINE 256
+
+typedef struct psCacheEntry {
+    unsigned long uniqueId;
+    char ipAddress[PS_CACHE_ADDRESS_SIZE];
+} psCacheEntry;
+
+static psCacheEntry cacheEntries[MAX_CACHE_CAMERAS];
+static int numCacheEntries;
+static int cacheChanged;
+static char *cacheFileName;
+static epicsMutexId cacheMutex;
+static epicsThreadOnceId cacheOnce = EPICS_THREAD_ONCE_INIT;
+
+static void cacheInit(void *)
+{
+    cacheMutex = epicsMutexMustCreate();
+}
+
+static void cacheLock(void)
+{
+    epicsThreadOnce(&cacheOnce, cacheInit, NULL);
+    epicsMutexMustLock(cacheMutex);
+}
+
+static void cacheUnlock(void)
+{
+    epicsMutexUnlock(cacheMutex);
+}
+
+/* Sets an entry; called with the mutex held */
+static int updateEntry(unsigned long uniqueId, const char *ipAddress)
+{
+    int i, found = -1, changed = 0;
+
+    for (i=0; i<numCacheEntries; i++) {
+        if (cacheEntries[i].uniqueId == uniqueId) {
+            found = i;
+        } else if (strcmp(cacheEntries[i].ipAddress, ipAddress) == 0) {
+            /* The address now belongs to another camera */
+            cacheEntries[i] = cacheEntries[--numCacheEntries];
+            i--;
+            changed = 1;
+        }
+    }
+    if (found < 0) {
+        if (numCacheEntries == MAX_CACHE_CAMERAS) return changed;
+        found = numCacheEntries++;
+        cacheEntries[found].uniqueId = uniqueId;
+        cacheEntries[found].ipAddress[0] = 0;
+    }
+    if (strcmp(cacheEntries[found].ipAddress, ipAddress) != 0) {
+        strncpy(cacheEntries[found].ipAddress, ipAddress, PS_CACHE_ADDRESS_SIZE-1);
+        cacheEntries[found].ipAddress[PS_CACHE_ADDRESS_SIZE-1] = 0;
+        changed = 1;
+    }
+    return changed;
+}
+
+int psCacheLoad(const char *fileName)
+{
+    FILE *fp;
+    char line[MAX_LINE];
+    char ipAddress[PS_CACHE_ADDRESS_SIZE];
+    unsigned long uniqueId;
+    int numRead = 0;
+
+    cacheLock();
+    free(cacheFileName);
+    cacheFileName = epicsStrDup(fileName);
+    fp = fopen(fileName, "r");
+    if (!fp) {
+        cacheChanged = 1;
+        cacheUnlock();
+        return -1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%lu %31s", &uniqueId, ipAddress) != 2) continue;
+        updateEntry(uniqueId, ipAddress);
+        numRead++;
+    }
+    fclose(fp);
+    cacheChanged = 0;
+    cacheUnlock();
+    return numRead;
+}
+
+int psCacheSave(void)
+{
+    FILE *fp;
+    char tempName[256];
+    int i;
+    int status = 0;
+
+    cacheLock();
+    if (!cacheFileName || !cacheChanged) {
+        cacheUnlock();
+        return 0;
+    }
+    /* Write a temporary file and rename it, so a reader never sees a partial file */
+    epicsSnprintf(tempName, sizeof(tempName), "%s.tmp", cacheFileName);
+    fp = fopen(tempName, "w");
+    if (!fp) {
+        cacheUnlock();
+        return -1;
+    }
+    fprintf(fp, "# Prosilica camera cache: UniqueId IPAddress\n");
+    for (i=0; i<numCacheEntries; i++) {
+        fprintf(fp, "%lu %s\n", cacheEntries[i].uniqueId, cacheEntries[i].ipAddress);
+    }
+    if (fclose(fp) != 0) status = -1;
+    if (!status && (rename(tempName, cacheFileName) != 0)) status = -1;
+    if (status) remove(tempName);
+    else cacheChanged = 0;
+    cacheUnlock();
+    return status;
+}
+
+int psCacheLookup(unsigned long uniqueId, char *ipAddress, size_t size)
+{
+    int i;
+    int status = -1;
+
+    cacheLock();
+    for (i=0; i<numCacheEntries; i++) {
+        if (cacheEntries[i].uniqueId == uniqueId) {
+            strncpy(ipAddress, cacheEntries[i].ipAddress, size-1);
+            ipAddress[size-1] = 0;
+            status = 0;
+            break;
+        }
+    }
+    cacheUnlock();
+    return status;
+}
+
+int psCacheUpdate(unsigned long uniqueId, const char *ipAddress)
+{
+    int changed;
+
+    if (!ipAddress || !ipAddress[0]) return 0;
+    cacheLock();
+    changed = updateEntry(uniqueId, ipAddress);
+    if (changed) cacheChanged = 1;
+    cacheUnlock();
+    return changed;
+}
+
+int psCacheGetEntry(int index, unsigned long *pUniqueId, char *ipAddress, size_t size)
+{
+    int status = -1;
+
+    cacheLock();
+    if ((index >= 0) && (index < numCacheEntries)) {
+        *pUniqueId = cacheEntries[index].uniqueId;
+        strncpy(ipAddress, cacheEntries[index].ipAddress, size-1);
+        ipAddress[size-1] = 0;
+        status = 0;
+    }
+    cacheUnlock();
+    return status;
+}
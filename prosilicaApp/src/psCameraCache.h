@@ -0,0 +1,32 @@
+/* psCameraCache.h
+ *
+ * Cache of the IP addresses of cameras, keyed by UniqueId.  It lets a camera which is
+ * configured by its UniqueId be opened directly by its address, without waiting for the
+ * PvAPI library to discover it.  The cache can be kept in a text file with one camera per
+ * line, "UniqueId IPAddress"; lines starting with # are comments.
+ *
+ * All of the functions are thread safe.
+ */
+
+#ifndef PS_CAMERA_CACHE_H
+#define PS_CAMERA_CACHE_H
+
+#include <stddef.h>
+
+#define PS_CACHE_ADDRESS_SIZE 32
+
+/* Sets the cache file and reads it.  Returns the number of cameras read, or -1 if the file
+ * could not be read, in which case it will be created when the cache is saved. */
+int psCacheLoad(const char *fileName);
+/* Writes the cache file if the cache has changed since it was read or last written.
+ * The file is replaced atomically.  Returns 0 on success or if there is nothing to write. */
+int psCacheSave(void);
+/* Copies the address of a camera.  Returns 0 if the camera is in the cache. */
+int psCacheLookup(unsigned long uniqueId, char *ipAddress, size_t size);
+/* Sets the address of a camera, and removes any other camera with the same address.
+ * Returns 1 if the cache changed. */
+int psCacheUpdate(unsigned long uniqueId, const char *ipAddress);
+/* Copies entry index of the cache.  Returns -1 if index is past the end. */
+int psCacheGetEntry(int index, unsigned long *pUniqueId, char *ipAddress, size_t size);
+
+#endif /* PS_CAMERA_CACHE_H */
@@ -0,0 +1,59 @@
+/* psHistory.cpp
+ *
+ * Ring buffers of sampled values, see psHistory.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "psHistory.h"
+
+int psHistoryCreate(psHistory *pHistory, int numSeries, int size)
+{
+    memset(pHistory, 0, sizeof(*pHistory));
+    if ((numSeries <= 0) || (size <= 0)) return -1;
+    pHistory->pData = (double *)calloc((size_t)numSeries * size, sizeof(double));
+    if (!pHistory->pData) return -1;
+    pHistory->numSeries = numSeries;
+    pHistory->size = size;
+    return 0;
+}
+
+void psHistoryAdd(psHistory *pHistory, const double *values)
+{
+    int series;
+
+    if (!pHistory->pData) return;
+    for (series=0; series<pHistory->numSeries; series++) {
+        pHistory->pData[series * pHistory->size + pHistory->next] = values[series];
+    }
+    pHistory->next = (pHistory->next + 1) % pHistory->size;
+    if (pHistory->count < pHistory->size) pHistory->count++;
+}
+
+int psHistoryRead(const psHistory *pHistory, int series, double *pOut, int maxOut)
+{
+    const double *pRing;
+    int n, first, part;
+
+    if (!pHistory->pData || (series < 0) || (series >= pHistory->numSeries)) return 0;
+    n = (pHistory->count < maxOut) ? pHistory->count : maxOut;
+    if (n <= 0) return 0;
+    pRing = pHistory->pData + series * pHistory->size;
+    /* The newest n samples, which may wrap around the end of the ring */
+    first = (pHistory->next - n + pHistory->size) % pHistory->size;
+    part = pHistory->size - first;
+    if (part > n) part = n;
+    memcpy(pOut, pRing + first, part * sizeof(double));
+    memcpy(pOut + part, pRing, (n - part) * sizeof(double));
+    return n;
+}
+
+int psHistoryTimebase(const psHistory *pHistory, double period, double *pOut, int maxOut)
+{
+    int n, i;
+
+    n = (pHistory->count < maxOut) ? pHistory->count : maxOut;
+    for (i=0; i<n; i++) pOut[i] = (i - (n - 1)) * period;
+    return (n > 0) ? n : 0;
+}
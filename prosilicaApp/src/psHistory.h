@@ -0,0 +1,31 @@
+/* psHistory.h
+ *
+ * Fixed size time series of several values sampled together, kept in one ring buffer.
+ *
+ * The memory is allocated once by psHistoryCreate, so adding a sample never allocates.
+ * The series are read oldest sample first, for waveform records.  The functions do no
+ * locking; the caller serializes them.
+ */
+
+#ifndef PS_HISTORY_H
+#define PS_HISTORY_H
+
+typedef struct psHistory {
+    int numSeries;
+    int size;                    /* Samples kept of each series */
+    int count;                   /* Samples added, up to size */
+    int next;                    /* Position of the next sample in the ring */
+    double *pData;               /* numSeries rings of size samples */
+} psHistory;
+
+/* Allocates the rings.  Returns 0 on success. */
+int psHistoryCreate(psHistory *pHistory, int numSeries, int size);
+/* Adds one sample of every series, replacing the oldest once the rings are full */
+void psHistoryAdd(psHistory *pHistory, const double *values);
+/* Copies up to maxOut samples of a series, oldest first.  Returns the number copied. */
+int psHistoryRead(const psHistory *pHistory, int series, double *pOut, int maxOut);
+/* Writes the time of each sample relative to the newest one, -(n-1)*period to 0, for the
+ * samples which psHistoryRead returns.  Returns the number written. */
+int psHistoryTimebase(const psHistory *pHistory, double period, double *pOut, int maxOut);
+
+#endif /* PS_HISTORY_H */
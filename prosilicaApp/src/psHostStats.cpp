@@ -0,0 +1,412 @@
+/* psHostStats.cpp
+ *
+ * Readers for the Linux host network counters, see psHostStats.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(linux) || defined(__linux__)
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/prctl.h>
+#endif
+
+#include <epicsString.h>
+#include <epicsStdio.h>
+
+#include "psHostStats.h"
+
+#define MAX_LINE 512
+
+#if defined(linux) || defined(__linux__)
+
+/* Opens root/path for reading */
+static FILE *openFile(const char *root, const char *path)
+{
+    char fileName[256];
+
+    epicsSnprintf(fileName, sizeof(fileName), "%s%s", root ? root : "", path);
+    return fopen(fileName, "r");
+}
+
+/* Reads a file which contains a single number */
+static int readNumber(const char *root, const char *path, epicsUInt64 *pValue)
+{
+    FILE *fp;
+    unsigned long long value;
+    int n;
+
+    fp = openFile(root, path);
+    if (!fp) return -1;
+    n = fscanf(fp, "%llu", &value);
+    fclose(fp);
+    if (n != 1) return -1;
+    *pValue = value;
+    return 0;
+}
+
+/* Converts a dotted IPv4 address to the value which /proc/net/route prints for it,
+ * which is the address in network byte order read as a host integer */
+static int parseIPAddress(const char *ipAddress, epicsUInt32 *pAddress)
+{
+    unsigned int b[4];
+    unsigned char bytes[4];
+    int i;
+
+    if (sscanf(ipAddress, "%u.%u.%u.%u", &b[0], &b[1], &b[2], &b[3]) != 4) return -1;
+    for (i=0; i<4; i++) {
+        if (b[i] > 255) return -1;
+        bytes[i] = (unsigned char)b[i];
+    }
+    memcpy(pAddress, bytes, sizeof(*pAddress));
+    return 0;
+}
+
+static int countBits(epicsUInt32 value)
+{
+    int n = 0;
+
+    for (; value; value >>= 1) n += value & 1;
+    return n;
+}
+
+int psHostFindInterface(const char *root, const char *ipAddress, char *ifName, size_t size)
+{
+    FILE *fp;
+    char line[MAX_LINE];
+    char name[PS_HOST_IFNAME_SIZE];
+    unsigned long destination, gateway, mask;
+    unsigned int flags;
+    epicsUInt32 address;
+    int bits, bestBits = -1;
+
+    if (parseIPAddress(ipAddress, &address)) return -1;
+    fp = openFile(root, "/proc/net/route");
+    if (!fp) return -1;
+    /* The first line is the header */
+    if (!fgets(line, sizeof(line), fp)) {
+        fclose(fp);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "%31s %lx %lx %x %*d %*d %*d %lx",
+                   name, &destination, &gateway, &flags, &mask) != 5) continue;
+        /* RTF_UP */
+        if (!(flags & 0x1)) continue;
+        if ((address & (epicsUInt32)mask) != (epicsUInt32)destination) continue;
+        /* Prefer the most specific route, and a direct route over one through a gateway */
+        bits = 2*countBits((epicsUInt32)mask) + (gateway == 0);
+        if (bits > bestBits) {
+            bestBits = bits;
+            strncpy(ifName, name, size-1);
+            ifName[size-1] = 0;
+        }
+    }
+    fclose(fp);
+    return (bestBits < 0) ? -1 : 0;
+}
+
+/* Reads the inodes of the sockets which are open in this process */
+static int readSocketInodes(const char *root, unsigned long **ppInodes)
+{
+    char dirName[256];
+    char path[512];
+    char link[64];
+    DIR *pDir;
+    struct dirent *pEntry;
+    unsigned long inode;
+    unsigned long *pInodes = 0;
+    int numInodes = 0, maxInodes = 0;
+    ssize_t len;
+
+    epicsSnprintf(dirName, sizeof(dirName), "%s/proc/self/fd", root ? root : "");
+    pDir = opendir(dirName);
+    if (!pDir) return -1;
+    while ((pEntry = readdir(pDir)) != 0) {
+        if (pEntry->d_name[0] == '.') continue;
+        epicsSnprintf(path, sizeof(path), "%s/%s", dirName, pEntry->d_name);
+        len = readlink(path, link, sizeof(link)-1);
+        if (len <= 0) continue;
+        link[len] = 0;
+        if (sscanf(link, "socket:[%lu]", &inode) != 1) continue;
+        if (numInodes == maxInodes) {
+            unsigned long *pNew;
+            maxInodes = maxInodes ? 2*maxInodes : 64;
+            pNew = (unsigned long *)realloc(pInodes, maxInodes*sizeof(*pInodes));
+            if (!pNew) break;
+            pInodes = pNew;
+        }
+        pInodes[numInodes++] = inode;
+    }
+    closedir(pDir);
+    *ppInodes = pInodes;
+    return numInodes;
+}
+
+int psHostReadUdpDrops(const char *root, epicsUInt64 *pDrops)
+{
+    FILE *fp;
+    char line[MAX_LINE];
+    unsigned long inode, drops;
+    unsigned long *pInodes = 0;
+    int numInodes;
+    epicsUInt64 sum = 0;
+    int i;
+
+    fp = openFile(root, "/proc/net/udp");
+    if (!fp) return -1;
+    numInodes = readSocketInodes(root, &pInodes);
+    /* The first line is the header */
+    if (!fgets(line, sizeof(line), fp)) {
+        fclose(fp);
+        free(pInodes);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        /* sl local_address rem_address st tx_queue:rx_queue tr:tm->when retrnsmt uid timeout inode ref pointer drops */
+        if (sscanf(line, " %*d: %*x:%*x %*x:%*x %*x %*x:%*x %*x:%*x %*x %*u %*u %lu %*d %*x %lu",
+                   &inode, &drops) != 2) continue;
+        if (numInodes >= 0) {
+            for (i=0; i<numInodes; i++) {
+                if (pInodes[i] == inode) break;
+            }
+            if (i == numInodes) continue;
+        }
+        sum += drops;
+    }
+    fclose(fp);
+    free(pInodes);
+    *pDrops = sum;
+    return 0;
+}
+
+int psHostReadSnmpUdp(const char *root, const char *counter, epicsUInt64 *pValue)
+{
+    FILE *fp;
+    char header[MAX_LINE];
+    char values[MAX_LINE];
+    char *pName, *pValueStr, *saveName, *saveValue;
+    int status = -1;
+
+    fp = openFile(root, "/proc/net/snmp");
+    if (!fp) return -1;
+    /* Each protocol has a line with the counter names followed by a line with the values */
+    while (fgets(header, sizeof(header), fp)) {
+        if (strncmp(header, "Udp:", 4) != 0) continue;
+        if (!fgets(values, sizeof(values), fp)) break;
+        pName = epicsStrtok_r(header, " \n", &saveName);
+        pValueStr = epicsStrtok_r(values, " \n", &saveValue);
+        while (pName && pValueStr) {
+            if (strcmp(pName, counter) == 0) {
+                *pValue = strtoull(pValueStr, 0, 10);
+                status = 0;
+                break;
+            }
+            pName = epicsStrtok_r(0, " \n", &saveName);
+            pValueStr = epicsStrtok_r(0, " \n", &saveValue);
+        }
+        break;
+    }
+    fclose(fp);
+    return status;
+}
+
+int psHostReadNicCounter(const char *root, const char *ifName, const char *counter, epicsUInt64 *pValue)
+{
+    char path[256];
+
+    if (!ifName || !ifName[0]) return -1;
+    epicsSnprintf(path, sizeof(path), "/sys/class/net/%s/statistics/%s", ifName, counter);
+    return readNumber(root, path, pValue);
+}
+
+int psHostReadRmemMax(const char *root, epicsUInt64 *pValue)
+{
+    return readNumber(root, "/proc/sys/net/core/rmem_max", pValue);
+}
+
+int psHostReadProcessStatus(const char *root, epicsUInt64 *pRssBytes, int *pThreads)
+{
+    FILE *fp;
+    char line[MAX_LINE];
+    unsigned long long rss;
+    int threads;
+    int numRead = 0;
+
+    fp = openFile(root, "/proc/self/status");
+    if (!fp) return -1;
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "VmRSS: %llu kB", &rss) == 1) {
+            *pRssBytes = rss * 1024;
+            numRead++;
+        } else if (sscanf(line, "Threads: %d", &threads) == 1) {
+            *pThreads = threads;
+            numRead++;
+        }
+    }
+    fclose(fp);
+    return (numRead == 2) ? 0 : -1;
+}
+
+int psHostReadThreadStats(const char *root, int tid, psHostThreadStats *pStats)
+{
+    FILE *fp;
+    char path[64];
+    char line[MAX_LINE];
+    char *pStart, *pEnd;
+    unsigned long long utime, stime, value;
+    int lastCpu;
+    size_t len;
+
+    epicsSnprintf(path, sizeof(path), "/proc/self/task/%d/stat", tid);
+    fp = openFile(root, path);
+    if (!fp) return -1;
+    if (!fgets(line, sizeof(line), fp)) {
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    /* The name is in parentheses and can contain spaces and parentheses */
+    pStart = strchr(line, '(');
+    pEnd = strrchr(line, ')');
+    if (!pStart || !pEnd || (pEnd < pStart)) return -1;
+    len = pEnd - pStart - 1;
+    if (len > PS_HOST_THREAD_NAME_SIZE-1) len = PS_HOST_THREAD_NAME_SIZE-1;
+    memcpy(pStats->name, pStart+1, len);
+    pStats->name[len] = 0;
+    /* The fields after the name start with the state, field 3.  utime and stime are
+     * fields 14 and 15, and processor is field 39. */
+    if (sscanf(pEnd+1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu"
+                       " %*d %*d %*d %*d %*d %*d %*u %*u %*d %*u %*u %*u %*u %*u %*u"
+                       " %*u %*u %*u %*u %*u %*u %*u %*d %d",
+               &utime, &stime, &lastCpu) != 3) return -1;
+    pStats->tid = tid;
+    pStats->cpuTicks = utime + stime;
+    pStats->lastCpu = lastCpu;
+    pStats->voluntarySwitches = 0;
+    pStats->involuntarySwitches = 0;
+
+    epicsSnprintf(path, sizeof(path), "/proc/self/task/%d/status", tid);
+    fp = openFile(root, path);
+    if (!fp) return 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "voluntary_ctxt_switches: %llu", &value) == 1)
+            pStats->voluntarySwitches = value;
+        else if (sscanf(line, "nonvoluntary_ctxt_switches: %llu", &value) == 1)
+            pStats->involuntarySwitches = value;
+    }
+    fclose(fp);
+    return 0;
+}
+
+int psHostReadAllThreadStats(const char *root, psHostThreadStats *pStats, int maxThreads)
+{
+    char dirName[256];
+    DIR *pDir;
+    struct dirent *pEntry;
+    int numThreads = 0;
+
+    epicsSnprintf(dirName, sizeof(dirName), "%s/proc/self/task", root ? root : "");
+    pDir = opendir(dirName);
+    if (!pDir) return -1;
+    while (((pEntry = readdir(pDir)) != 0) && (numThreads < maxThreads)) {
+        if (pEntry->d_name[0] == '.') continue;
+        if (psHostReadThreadStats(root, atoi(pEntry->d_name), &pStats[numThreads]) == 0) numThreads++;
+    }
+    closedir(pDir);
+    return numThreads;
+}
+
+long psHostClockTicks(void)
+{
+    return sysconf(_SC_CLK_TCK);
+}
+
+int psHostGetThreadId(void)
+{
+    return (int)syscall(SYS_gettid);
+}
+
+int psHostSetThreadName(const char *name)
+{
+    return prctl(PR_SET_NAME, name, 0, 0, 0) ? -1 : 0;
+}
+
+#else /* Not Linux */
+
+int psHostFindInterface(const char *root, const char *ipAddress, char *ifName, size_t size)
+{
+    return -1;
+}
+
+int psHostReadUdpDrops(const char *root, epicsUInt64 *pDrops)
+{
+    return -1;
+}
+
+int psHostReadSnmpUdp(const char *root, const char *counter, epicsUInt64 *pValue)
+{
+    return -1;
+}
+
+int psHostReadNicCounter(const char *root, const char *ifName, const char *counter, epicsUInt64 *pValue)
+{
+    return -1;
+}
+
+int psHostReadRmemMax(const char *root, epicsUInt64 *pValue)
+{
+    return -1;
+}
+
+int psHostReadProcessStatus(const char *root, epicsUInt64 *pRssBytes, int *pThreads)
+{
+    return -1;
+}
+
+int psHostReadThreadStats(const char *root, int tid, psHostThreadStats *pStats)
+{
+    return -1;
+}
+
+int psHostReadAllThreadStats(const char *root, psHostThreadStats *pStats, int maxThreads)
+{
+    return -1;
+}
+
+long psHostClockTicks(void)
+{
+    return 100;
+}
+
+int psHostGetThreadId(void)
+{
+    return -1;
+}
+
+int psHostSetThreadName(const char *name)
+{
+    return -1;
+}
+
+#endif
+
+int psHostReadNetStats(const char *root, psHostNetStats *pStats)
+{
+    int numRead = 0;
+
+    pStats->udpDrops = 0;
+    pStats->udpRcvbufErrors = 0;
+    pStats->nicRxMissed = 0;
+    pStats->nicRxDropped = 0;
+    pStats->rmemMax = 0;
+    if (psHostReadUdpDrops(root, &pStats->udpDrops) == 0) numRead++;
+    if (psHostReadSnmpUdp(root, "RcvbufErrors", &pStats->udpRcvbufErrors) == 0) numRead++;
+    if (psHostReadNicCounter(root, pStats->ifName, "rx_missed_errors", &pStats->nicRxMissed) == 0) numRead++;
+    if (psHostReadNicCounter(root, pStats->ifName, "rx_dropped", &pStats->nicRxDropped) == 0) numRead++;
+    if (psHostReadRmemMax(root, &pStats->rmemMax) == 0) numRead++;
+    return numRead ? 0 : -1;
+}
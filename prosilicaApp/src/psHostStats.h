@@ -0,0 +1,69 @@
+/* psHostStats.h
+ *
+ * Readers for the Linux host counters which show where packets from a camera
+ * were lost: in the NIC, in the kernel UDP receive buffers, or in the sockets,
+ * and for the memory, threads and per-thread CPU use of the IOC process.
+ *
+ * Every reader takes the root of the file system, so it can be run against fixture
+ * files as well as the live system.  Pass NULL or "" as the root for the live system.
+ * The readers return 0 on success and -1 if the counter is not available, which is
+ * always the case on systems other than Linux.
+ */
+
+#ifndef PS_HOST_STATS_H
+#define PS_HOST_STATS_H
+
+#include <stddef.h>
+#include <epicsTypes.h>
+
+#define PS_HOST_IFNAME_SIZE 32
+
+typedef struct psHostNetStats {
+    char ifName[PS_HOST_IFNAME_SIZE]; /* Interface with the route to the camera */
+    epicsUInt64 udpDrops;             /* Drops on the UDP sockets of this process, from /proc/net/udp */
+    epicsUInt64 udpRcvbufErrors;      /* UDP RcvbufErrors of the host, from /proc/net/snmp */
+    epicsUInt64 nicRxMissed;          /* rx_missed_errors of the interface */
+    epicsUInt64 nicRxDropped;         /* rx_dropped of the interface */
+    epicsUInt64 rmemMax;              /* net.core.rmem_max sysctl */
+} psHostNetStats;
+
+#define PS_HOST_THREAD_NAME_SIZE 16
+
+typedef struct psHostThreadStats {
+    int tid;                             /* Linux thread ID */
+    char name[PS_HOST_THREAD_NAME_SIZE]; /* Thread name, from comm */
+    epicsUInt64 cpuTicks;                /* User plus system time in clock ticks */
+    epicsUInt64 voluntarySwitches;       /* voluntary_ctxt_switches */
+    epicsUInt64 involuntarySwitches;     /* nonvoluntary_ctxt_switches */
+    int lastCpu;                         /* CPU the thread last ran on */
+} psHostThreadStats;
+
+/* Finds the interface with the most specific route to ipAddress in /proc/net/route */
+int psHostFindInterface(const char *root, const char *ipAddress, char *ifName, size_t size);
+/* Sums the drops of the UDP sockets in /proc/net/udp which belong to this process,
+ * or of every socket if the sockets of the process can not be read */
+int psHostReadUdpDrops(const char *root, epicsUInt64 *pDrops);
+/* Reads a counter of the Udp: lines in /proc/net/snmp, e.g. RcvbufErrors */
+int psHostReadSnmpUdp(const char *root, const char *counter, epicsUInt64 *pValue);
+/* Reads /sys/class/net/<ifName>/statistics/<counter> */
+int psHostReadNicCounter(const char *root, const char *ifName, const char *counter, epicsUInt64 *pValue);
+/* Reads /proc/sys/net/core/rmem_max */
+int psHostReadRmemMax(const char *root, epicsUInt64 *pValue);
+/* Reads the resident set size in bytes and the number of threads from /proc/self/status */
+int psHostReadProcessStatus(const char *root, epicsUInt64 *pRssBytes, int *pThreads);
+/* Reads /proc/self/task/<tid>/stat and status */
+int psHostReadThreadStats(const char *root, int tid, psHostThreadStats *pStats);
+/* Reads the statistics of every thread of this process, up to maxThreads.
+ * Returns the number of threads read, or -1. */
+int psHostReadAllThreadStats(const char *root, psHostThreadStats *pStats, int maxThreads);
+/* Returns the clock ticks per second of the cpuTicks */
+long psHostClockTicks(void);
+/* Returns the Linux thread ID of the calling thread, or -1 */
+int psHostGetThreadId(void);
+/* Sets the name of the calling thread, which is truncated to 15 characters */
+int psHostSetThreadName(const char *name);
+/* Reads all of the counters for pStats->ifName.  Counters which are not available are 0.
+ * Returns 0 if any counter was read. */
+int psHostReadNetStats(const char *root, psHostNetStats *pStats);
+
+#endif /* PS_HOST_STATS_H */
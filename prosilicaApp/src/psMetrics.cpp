@@ -0,0 +1,269 @@
+/* psMetrics.cpp
+ *
+ * OpenMetrics writer for the prosilica driver counters, see psMetrics.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <epicsAtomic.h>
+#include <epicsMutex.h>
+#include <epicsThread.h>
+#include <epicsString.h>
+#include <epicsStdio.h>
+
+#include "psMetrics.h"
+
+#define MAX_METRICS_DRIVERS 64
+#define MAX_FILE_NAME 256
+
+typedef enum {
+    PSMetricCounter,
+    PSMetricGauge
+} PSMetricType_t;
+
+typedef struct psMetricInfo {
+    const char *name;
+    PSMetricType_t type;
+    double scale;
+    const char *help;
+} psMetricInfo;
+
+/* In the order of PSMetric_t */
+static const psMetricInfo metricInfo[PSMetricNumValues] = {
+    {"prosilica_frames",                     PSMetricCounter, 1.,   "Frames delivered to the plugins"},
+    {"prosilica_bad_frames",                 PSMetricCounter, 1.,   "Frames received with an error"},
+    {"prosilica_gate_discarded_frames",      PSMetricCounter, 1.,   "Frames discarded outside the delivery gate"},
+    {"prosilica_camera_frames_completed",    PSMetricCounter, 1.,   "Frames completed by the PvAPI library"},
+    {"prosilica_camera_frames_dropped",      PSMetricCounter, 1.,   "Frames dropped by the PvAPI library"},
+    {"prosilica_camera_packets_received",    PSMetricCounter, 1.,   "Stream packets received"},
+    {"prosilica_camera_packets_missed",      PSMetricCounter, 1.,   "Stream packets missed"},
+    {"prosilica_camera_packets_erroneous",   PSMetricCounter, 1.,   "Stream packets received with an error"},
+    {"prosilica_camera_packets_requested",   PSMetricCounter, 1.,   "Stream packets requested to be resent"},
+    {"prosilica_camera_packets_resent",      PSMetricCounter, 1.,   "Stream packets resent by the camera"},
+    {"prosilica_host_udp_drops",             PSMetricCounter, 1.,   "Drops on the UDP sockets of the IOC"},
+    {"prosilica_host_nic_rx_missed",         PSMetricCounter, 1.,   "rx_missed_errors of the host interface"},
+    {"prosilica_host_nic_rx_dropped",        PSMetricCounter, 1.,   "rx_dropped of the host interface"},
+    {"prosilica_connected",                  PSMetricGauge,   1.,   "1 if the camera is connected"},
+    {"prosilica_acquiring",                  PSMetricGauge,   1.,   "1 if the camera is acquiring"},
+    {"prosilica_pool_buffers",               PSMetricGauge,   1.,   "NDArrays allocated by the NDArrayPool"},
+    {"prosilica_pool_free_buffers",          PSMetricGauge,   1.,   "NDArrays on the free list of the NDArrayPool"},
+    {"prosilica_pool_memory_bytes",          PSMetricGauge,   1.,   "Bytes allocated by the NDArrayPool"},
+    {"prosilica_first_frame_latency_seconds", PSMetricGauge,  1e-6, "Time from AcquisitionStart to the first frame"}
+};
+
+/* Upper bounds of the latency histogram buckets in seconds */
+static const double latencyBounds[PS_METRICS_LATENCY_BUCKETS] = {
+    0.0005, 0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5
+};
+
+/* Drivers are only added, so the writer can read the list without a lock */
+static psMetrics *metricsList[MAX_METRICS_DRIVERS];
+static int numMetrics;
+
+/* The writer settings are shared by the writer thread and the iocsh thread */
+static char writerFileName[MAX_FILE_NAME];
+static double writerPeriod;
+static int writerRunning;
+static epicsMutexId writerMutex;
+static epicsThreadOnceId writerOnce = EPICS_THREAD_ONCE_INIT;
+
+static void writerInit(void *)
+{
+    writerMutex = epicsMutexMustCreate();
+}
+
+int psMetricsRegister(psMetrics *pMetrics, const char *port)
+{
+    psMetricsLabels *pLabels;
+    int index;
+
+    memset(pMetrics, 0, sizeof(*pMetrics));
+    pLabels = (psMetricsLabels *)calloc(1, sizeof(psMetricsLabels));
+    strncpy(pLabels->port, port, PS_METRICS_LABEL_SIZE-1);
+    pMetrics->pLabels = pLabels;
+    index = epicsAtomicIncrIntT(&numMetrics) - 1;
+    if (index >= MAX_METRICS_DRIVERS) {
+        epicsAtomicDecrIntT(&numMetrics);
+        return -1;
+    }
+    /* The count is incremented before the pointer is set, so the writer skips NULL entries */
+    epicsAtomicSetPtrT((void **)&metricsList[index], pMetrics);
+    return 0;
+}
+
+void psMetricsSetLabels(psMetrics *pMetrics, const char *cameraId, const char *model)
+{
+    psMetricsLabels *pOld = (psMetricsLabels *)epicsAtomicGetPtrT((void * const *)&pMetrics->pLabels);
+    psMetricsLabels *pLabels;
+
+    if ((strcmp(pOld->cameraId, cameraId) == 0) && (strcmp(pOld->model, model) == 0)) return;
+    pLabels = (psMetricsLabels *)calloc(1, sizeof(psMetricsLabels));
+    strcpy(pLabels->port, pOld->port);
+    strncpy(pLabels->cameraId, cameraId, PS_METRICS_LABEL_SIZE-1);
+    strncpy(pLabels->model, model, PS_METRICS_LABEL_SIZE-1);
+    epicsAtomicSetPtrT((void **)&pMetrics->pLabels, pLabels);
+}
+
+void psMetricsAdd(psMetrics *pMetrics, PSMetric_t metric, size_t value)
+{
+    epicsAtomicAddSizeT(&pMetrics->values[metric], value);
+}
+
+void psMetricsSet(psMetrics *pMetrics, PSMetric_t metric, size_t value)
+{
+    epicsAtomicSetSizeT(&pMetrics->values[metric], value);
+}
+
+void psMetricsAddLatency(psMetrics *pMetrics, double seconds)
+{
+    int i;
+
+    if (seconds < 0.) seconds = 0.;
+    for (i=0; i<PS_METRICS_LATENCY_BUCKETS; i++) {
+        if (seconds <= latencyBounds[i]) break;
+    }
+    epicsAtomicIncrSizeT(&pMetrics->latencyCounts[i]);
+    epicsAtomicAddSizeT(&pMetrics->latencySum, (size_t)(seconds*1e6 + 0.5));
+}
+
+/* Writes a label value, escaping the characters which OpenMetrics requires */
+static void writeLabelValue(FILE *fp, const char *value)
+{
+    for (; *value; value++) {
+        if      (*value == '\\') fputs("\\\\", fp);
+        else if (*value == '"')  fputs("\\\"", fp);
+        else if (*value == '\n') fputs("\\n", fp);
+        else fputc(*value, fp);
+    }
+}
+
+static void writeLabels(FILE *fp, const psMetricsLabels *pLabels, const char *le)
+{
+    fputs("{port=\"", fp);
+    writeLabelValue(fp, pLabels->port);
+    fputs("\",camera_id=\"", fp);
+    writeLabelValue(fp, pLabels->cameraId);
+    fputs("\",model=\"", fp);
+    writeLabelValue(fp, pLabels->model);
+    fputc('"', fp);
+    if (le) fprintf(fp, ",le=\"%s\"", le);
+    fputc('}', fp);
+}
+
+void psMetricsWrite(FILE *fp)
+{
+    int num = epicsAtomicGetIntT(&numMetrics);
+    psMetrics *pMetrics;
+    const psMetricsLabels *pLabels;
+    const psMetricInfo *pInfo;
+    size_t value, count;
+    char le[32];
+    int i, j, metric;
+
+    if (num > MAX_METRICS_DRIVERS) num = MAX_METRICS_DRIVERS;
+    for (metric=0; metric<PSMetricNumValues; metric++) {
+        pInfo = &metricInfo[metric];
+        fprintf(fp, "# TYPE %s %s\n", pInfo->name, pInfo->type == PSMetricCounter ? "counter" : "gauge");
+        fprintf(fp, "# HELP %s %s\n", pInfo->name, pInfo->help);
+        for (i=0; i<num; i++) {
+            pMetrics = (psMetrics *)epicsAtomicGetPtrT((void * const *)&metricsList[i]);
+            if (!pMetrics) continue;
+            pLabels = (const psMetricsLabels *)epicsAtomicGetPtrT((void * const *)&pMetrics->pLabels);
+            value = epicsAtomicGetSizeT(&pMetrics->values[metric]);
+            fprintf(fp, "%s%s", pInfo->name, pInfo->type == PSMetricCounter ? "_total" : "");
+            writeLabels(fp, pLabels, NULL);
+            if (pInfo->scale == 1.) fprintf(fp, " %lu\n", (unsigned long)value);
+            else fprintf(fp, " %g\n", value * pInfo->scale);
+        }
+    }
+
+    fprintf(fp, "# TYPE prosilica_frame_latency_seconds histogram\n");
+    fprintf(fp, "# HELP prosilica_frame_latency_seconds Delay from the frame timestamp to the frame callback\n");
+    for (i=0; i<num; i++) {
+        pMetrics = (psMetrics *)epicsAtomicGetPtrT((void * const *)&metricsList[i]);
+        if (!pMetrics) continue;
+        pLabels = (const psMetricsLabels *)epicsAtomicGetPtrT((void * const *)&pMetrics->pLabels);
+        count = 0;
+        for (j=0; j<=PS_METRICS_LATENCY_BUCKETS; j++) {
+            count += epicsAtomicGetSizeT(&pMetrics->latencyCounts[j]);
+            if (j < PS_METRICS_LATENCY_BUCKETS) epicsSnprintf(le, sizeof(le), "%g", latencyBounds[j]);
+            else strcpy(le, "+Inf");
+            fputs("prosilica_frame_latency_seconds_bucket", fp);
+            writeLabels(fp, pLabels, le);
+            fprintf(fp, " %lu\n", (unsigned long)count);
+        }
+        fputs("prosilica_frame_latency_seconds_count", fp);
+        writeLabels(fp, pLabels, NULL);
+        fprintf(fp, " %lu\n", (unsigned long)count);
+        fputs("prosilica_frame_latency_seconds_sum", fp);
+        writeLabels(fp, pLabels, NULL);
+        fprintf(fp, " %g\n", epicsAtomicGetSizeT(&pMetrics->latencySum) * 1e-6);
+    }
+    fprintf(fp, "# EOF\n");
+}
+
+int psMetricsWriteFile(const char *fileName)
+{
+    FILE *fp;
+    char tempName[MAX_FILE_NAME+8];
+    int status = 0;
+
+    /* Write a temporary file and rename it, so the collector never reads a partial file */
+    epicsSnprintf(tempName, sizeof(tempName), "%s.tmp", fileName);
+    fp = fopen(tempName, "w");
+    if (!fp) return -1;
+    psMetricsWrite(fp);
+    if (fclose(fp) != 0) status = -1;
+    if (!status && (rename(tempName, fileName) != 0)) status = -1;
+    if (status) remove(tempName);
+    return status;
+}
+
+static void writerTask(void *arg)
+{
+    char fileName[MAX_FILE_NAME];
+    double period;
+
+    while (1) {
+        /* Copy the settings, so the file is written without holding the mutex */
+        epicsMutexMustLock(writerMutex);
+        period = writerPeriod;
+        if (period <= 0.) {
+            writerRunning = 0;
+            epicsMutexUnlock(writerMutex);
+            break;
+        }
+        strcpy(fileName, writerFileName);
+        epicsMutexUnlock(writerMutex);
+        if (psMetricsWriteFile(fileName))
+            printf("psMetrics: cannot write %s\n", fileName);
+        epicsThreadSleep(period);
+    }
+}
+
+int psMetricsStartWriter(const char *fileName, double period)
+{
+    int status = 0;
+
+    epicsThreadOnce(&writerOnce, writerInit, NULL);
+    epicsMutexMustLock(writerMutex);
+    if (period > 0.) {
+        /* The thread picks up a new file name or period at its next write */
+        strncpy(writerFileName, fileName, MAX_FILE_NAME-1);
+        writerFileName[MAX_FILE_NAME-1] = 0;
+    }
+    writerPeriod = period;
+    if ((period > 0.) && !writerRunning) {
+        writerRunning = 1;
+        if (!epicsThreadCreate("prosilicaMetrics", epicsThreadPriorityLow,
+                               epicsThreadGetStackSize(epicsThreadStackSmall),
+                               (EPICSTHREADFUNC)writerTask, NULL)) {
+            writerRunning = 0;
+            status = -1;
+        }
+    }
+    epicsMutexUnlock(writerMutex);
+    return status;
+}
@@ -0,0 +1,73 @@
+/* psMetrics.h
+ *
+ * Performance counters of the prosilica drivers, written in the OpenMetrics text format.
+ *
+ * Each driver registers one psMetrics structure and updates it with the epicsAtomic
+ * functions, usually where it also updates the corresponding parameter.  The writer reads
+ * the counters with epicsAtomic as well, so it never takes a port lock or accesses a camera.
+ */
+
+#ifndef PS_METRICS_H
+#define PS_METRICS_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define PS_METRICS_LABEL_SIZE 64
+#define PS_METRICS_LATENCY_BUCKETS 10 /* Not counting the +Inf bucket */
+
+typedef enum {
+    /* Counters */
+    PSMetricFrames,              /* Frames delivered to the plugins */
+    PSMetricBadFrames,           /* Frames received with an error */
+    PSMetricGateDiscarded,       /* Frames discarded outside the delivery gate */
+    PSMetricFramesCompleted,     /* StatFramesCompleted of the camera */
+    PSMetricFramesDropped,       /* StatFramesDropped of the camera */
+    PSMetricPacketsReceived,     /* StatPacketsReceived of the camera */
+    PSMetricPacketsMissed,       /* StatPacketsMissed of the camera */
+    PSMetricPacketsErroneous,    /* StatPacketsErroneous of the camera */
+    PSMetricPacketsRequested,    /* StatPacketsRequested of the camera */
+    PSMetricPacketsResent,       /* StatPacketsResent of the camera */
+    PSMetricHostUdpDrops,        /* Drops on the UDP sockets of the IOC */
+    PSMetricHostNicRxMissed,     /* rx_missed_errors of the host interface */
+    PSMetricHostNicRxDropped,    /* rx_dropped of the host interface */
+    /* Gauges */
+    PSMetricConnected,           /* 1 if the camera is connected */
+    PSMetricAcquiring,           /* 1 if the camera is acquiring */
+    PSMetricPoolBuffers,         /* NDArrays allocated by the NDArrayPool */
+    PSMetricPoolFreeBuffers,     /* NDArrays on the free list of the NDArrayPool */
+    PSMetricPoolMemory,          /* Bytes allocated by the NDArrayPool */
+    PSMetricFirstFrameLatency,   /* Acquire to first frame time in microseconds */
+    PSMetricNumValues
+} PSMetric_t;
+
+typedef struct psMetricsLabels {
+    char port[PS_METRICS_LABEL_SIZE];
+    char cameraId[PS_METRICS_LABEL_SIZE];
+    char model[PS_METRICS_LABEL_SIZE];
+} psMetricsLabels;
+
+typedef struct psMetrics {
+    psMetricsLabels *pLabels;    /* Replaced with epicsAtomicSetPtrT, never modified */
+    size_t values[PSMetricNumValues];
+    /* Histogram of the delay from the frame timestamp to the frame callback */
+    size_t latencyCounts[PS_METRICS_LATENCY_BUCKETS+1];
+    size_t latencySum;           /* Microseconds */
+} psMetrics;
+
+/* Adds a driver to the metrics.  pMetrics must stay valid for the life of the IOC. */
+int psMetricsRegister(psMetrics *pMetrics, const char *port);
+/* Sets the camera labels.  The old labels are not freed, since a writer may be using them;
+ * this only happens when the port connects to a different camera. */
+void psMetricsSetLabels(psMetrics *pMetrics, const char *cameraId, const char *model);
+void psMetricsAdd(psMetrics *pMetrics, PSMetric_t metric, size_t value);
+void psMetricsSet(psMetrics *pMetrics, PSMetric_t metric, size_t value);
+void psMetricsAddLatency(psMetrics *pMetrics, double seconds);
+/* Writes the metrics of all drivers */
+void psMetricsWrite(FILE *fp);
+/* Writes the metrics to a file, replacing it atomically.  Returns 0 on success. */
+int psMetricsWriteFile(const char *fileName);
+/* Starts a thread which writes the file every period seconds.  A period of 0 stops it. */
+int psMetricsStartWriter(const char *fileName, double period);
+
+#endif /* PS_METRICS_H */
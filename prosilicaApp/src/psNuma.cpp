@@ -0,0 +1,183 @@
+/* psNuma.cpp
+ *
+ * NUMA placement on Linux, see psNuma.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(linux) || defined(__linux__)
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
+
+#include <epicsStdio.h>
+
+#include "psNuma.h"
+
+#define MAX_LINE 1024
+
+#if defined(linux) || defined(__linux__)
+
+/* Opens root/path for reading */
+static FILE *openFile(const char *root, const char *path)
+{
+    char fileName[256];
+
+    epicsSnprintf(fileName, sizeof(fileName), "%s%s", root ? root : "", path);
+    return fopen(fileName, "r");
+}
+
+/* Reads a CPU list such as "0-5,12-17" into a CPU set */
+static int readCpuList(const char *root, const char *path, cpu_set_t *pSet)
+{
+    FILE *fp;
+    char line[MAX_LINE];
+    char *p, *end;
+    long first, last, cpu;
+    int numCpus = 0;
+
+    fp = openFile(root, path);
+    if (!fp) return -1;
+    if (!fgets(line, sizeof(line), fp)) line[0] = 0;
+    fclose(fp);
+    CPU_ZERO(pSet);
+    for (p=line; *p && (*p != '\n'); p=end) {
+        first = strtol(p, &end, 10);
+        if (end == p) break;
+        last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p) break;
+        }
+        for (cpu=first; (cpu<=last) && (cpu<CPU_SETSIZE); cpu++) {
+            CPU_SET(cpu, pSet);
+            numCpus++;
+        }
+        if (*end == ',') end++;
+    }
+    return numCpus > 0 ? 0 : -1;
+}
+
+int psNumaInterfaceNode(const char *root, const char *ifName)
+{
+    FILE *fp;
+    char path[256];
+    int node;
+
+    if (!ifName || !ifName[0]) return -1;
+    epicsSnprintf(path, sizeof(path), "/sys/class/net/%s/device/numa_node", ifName);
+    fp = openFile(root, path);
+    if (!fp) return -1;
+    if (fscanf(fp, "%d", &node) != 1) node = -1;
+    fclose(fp);
+    /* Hosts with a single node report -1 */
+    if ((node < 0) || (node >= PS_NUMA_MAX_NODES)) return -1;
+    return node;
+}
+
+int psNumaCpuNode(const char *root, int cpu)
+{
+    char path[256];
+    cpu_set_t cpus;
+    int node;
+
+    if ((cpu < 0) || (cpu >= CPU_SETSIZE)) return -1;
+    for (node=0; node<PS_NUMA_MAX_NODES; node++) {
+        epicsSnprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        if (readCpuList(root, path, &cpus)) continue;
+        if (CPU_ISSET(cpu, &cpus)) return node;
+    }
+    return -1;
+}
+
+int psNumaBindThread(const char *root, int tid, int node)
+{
+    char path[256];
+    cpu_set_t cpus;
+
+    if (tid <= 0) return -1;
+    if (node >= 0) epicsSnprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    else strcpy(path, "/sys/devices/system/cpu/online");
+    if (readCpuList(root, path, &cpus)) return -1;
+    return sched_setaffinity(tid, sizeof(cpus), &cpus) ? -1 : 0;
+}
+
+void *psNumaAllocPages(size_t size)
+{
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    void *pData;
+
+    if (size == 0) return NULL;
+    if (posix_memalign(&pData, pageSize, (size + pageSize - 1) & ~(pageSize - 1))) return NULL;
+    return pData;
+}
+
+int psNumaBindMemory(void *pData, size_t size, int node)
+{
+    unsigned long nodeMask;
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start, end;
+
+    if ((node < 0) || (node >= PS_NUMA_MAX_NODES) || !pData || (size == 0)) return -1;
+    /* mbind works on whole pages.  Only the pages inside the block are bound, since a page
+     * shared with another block may be in use by another thread on another node.  The block
+     * from psNumaAllocPages ends on a page boundary, so its last page is its own. */
+    start = ((size_t)pData + pageSize - 1) & ~(pageSize - 1);
+    if (((size_t)pData & (pageSize - 1)) == 0)
+        end = ((size_t)pData + size + pageSize - 1) & ~(pageSize - 1);
+    else
+        end = ((size_t)pData + size) & ~(pageSize - 1);
+    if (end <= start) return -1;
+    nodeMask = 1UL << node;
+    if (syscall(SYS_mbind, start, end - start, MPOL_PREFERRED, &nodeMask,
+                (unsigned long)(8 * sizeof(nodeMask)), MPOL_MF_MOVE)) return -1;
+    return 0;
+}
+
+int psNumaPageNode(const void *pData)
+{
+    int node = -1;
+
+    if (syscall(SYS_get_mempolicy, &node, NULL, 0UL, pData, (unsigned long)(MPOL_F_NODE | MPOL_F_ADDR)))
+        return -1;
+    return node;
+}
+
+#else /* Not Linux */
+
+int psNumaInterfaceNode(const char *root, const char *ifName)
+{
+    return -1;
+}
+
+int psNumaCpuNode(const char *root, int cpu)
+{
+    return -1;
+}
+
+int psNumaBindThread(const char *root, int tid, int node)
+{
+    return -1;
+}
+
+void *psNumaAllocPages(size_t size)
+{
+    return malloc(size);
+}
+
+int psNumaBindMemory(void *pData, size_t size, int node)
+{
+    return -1;
+}
+
+int psNumaPageNode(const void *pData)
+{
+    return -1;
+}
+
+#endif
@@ -0,0 +1,37 @@
+/* psNuma.h
+ *
+ * NUMA placement on Linux: the node of a network interface, binding threads to the CPUs
+ * of a node, and placing and locating memory pages.
+ *
+ * The node of an interface comes from /sys/class/net/<ifName>/device/numa_node, and the CPUs
+ * of a node from /sys/devices/system/node.  The system calls are made directly, so libnuma is
+ * not needed.  On hosts with a single node, or systems other than Linux, the node is -1 and
+ * the functions do nothing.  Like psHostStats the readers take the root of the file system,
+ * NULL or "" for the live system.
+ */
+
+#ifndef PS_NUMA_H
+#define PS_NUMA_H
+
+#include <stddef.h>
+
+#define PS_NUMA_MAX_NODES 64
+
+/* Returns the node of the device of an interface, or -1 if it is not known */
+int psNumaInterfaceNode(const char *root, const char *ifName);
+/* Returns the node of a CPU, or -1 if it is not known */
+int psNumaCpuNode(const char *root, int cpu);
+/* Restricts a thread of this process to the CPUs of a node, or allows it all of the online
+ * CPUs if node is -1.  Returns 0 on success. */
+int psNumaBindThread(const char *root, int tid, int node);
+/* Allocates size bytes starting on a page boundary and rounded up to whole pages, so that the
+ * block shares no page with other memory.  It is freed with free().  Returns NULL on failure. */
+void *psNumaAllocPages(size_t size);
+/* Makes node the preferred node of the whole pages of a block of memory, and moves the pages
+ * which are already on another node.  Pages shared with other memory are left alone, so a block
+ * from psNumaAllocPages is bound completely.  Returns 0 on success. */
+int psNumaBindMemory(void *pData, size_t size, int node);
+/* Returns the node of the page which contains pData, or -1 if it is not known */
+int psNumaPageNode(const void *pData);
+
+#endif /* PS_NUMA_H */
@@ -0,0 +1,144 @@
+/* psPerfCounters.cpp
+ *
+ * Hardware performance counters from perf_event_open, see psPerfCounters.h.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#if defined(linux) || defined(__linux__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include <epicsStdio.h>
+
+#include "psPerfCounters.h"
+
+static const char *eventNames[PSPerfNumEvents] = {
+    "cycles", "instructions", "LLC misses", "dTLB misses"
+};
+
+void psPerfInit(psPerfCounters *pCounters)
+{
+    int i;
+
+    for (i=0; i<PSPerfNumEvents; i++) {
+        pCounters->fd[i] = -1;
+        pCounters->index[i] = -1;
+    }
+    pCounters->numOpen = 0;
+    pCounters->tid = 0;
+}
+
+const char *psPerfEventName(int event)
+{
+    if ((event < 0) || (event >= PSPerfNumEvents)) return "";
+    return eventNames[event];
+}
+
+#if defined(linux) || defined(__linux__)
+
+static int openEvent(epicsUInt32 type, epicsUInt64 config, int groupFd)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    /* The enabled and running times are needed to scale the counts when the kernel multiplexes
+     * the group with other events on the PMU */
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    /* The leader starts disabled and enables the whole group once it is complete */
+    attr.disabled = (groupFd == -1);
+    /* Counting user space only is allowed with the default perf_event_paranoid of 2 */
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+
+int psPerfOpen(psPerfCounters *pCounters, char *errorMessage, size_t size)
+{
+    static const epicsUInt64 cacheMiss = (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    int leader;
+    int i;
+
+    psPerfClose(pCounters);
+    leader = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+    if (leader < 0) {
+        epicsSnprintf(errorMessage, size, "perf_event_open: %s", strerror(errno));
+        return -1;
+    }
+    pCounters->fd[PSPerfCycles] = leader;
+    pCounters->fd[PSPerfInstructions] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, leader);
+    pCounters->fd[PSPerfLLCMisses] = openEvent(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | cacheMiss, leader);
+    pCounters->fd[PSPerfDTLBMisses] = openEvent(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | cacheMiss, leader);
+    /* The group read returns the events in the order they were opened */
+    for (i=0; i<PSPerfNumEvents; i++) {
+        if (pCounters->fd[i] < 0) continue;
+        pCounters->index[i] = pCounters->numOpen++;
+    }
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    pCounters->tid = (int)syscall(SYS_gettid);
+    errorMessage[0] = 0;
+    return pCounters->numOpen;
+}
+
+void psPerfClose(psPerfCounters *pCounters)
+{
+    int i;
+
+    /* Close the members before the leader */
+    for (i=PSPerfNumEvents-1; i>=0; i--) {
+        if (pCounters->fd[i] >= 0) close(pCounters->fd[i]);
+    }
+    psPerfInit(pCounters);
+}
+
+int psPerfRead(psPerfCounters *pCounters, epicsUInt64 values[PSPerfNumEvents])
+{
+    /* nr, time_enabled, time_running, then the values in the order they were opened */
+    epicsUInt64 buffer[3 + PSPerfNumEvents];
+    double scale;
+    ssize_t len;
+    int i;
+
+    if (pCounters->numOpen == 0) return -1;
+    len = read(pCounters->fd[PSPerfCycles], buffer, sizeof(buffer));
+    if (len < (ssize_t)((3 + pCounters->numOpen) * sizeof(epicsUInt64))) return -1;
+    /* The group is only counted while it is on the PMU, so the counts are extrapolated to
+     * the whole time it was enabled */
+    if (buffer[2] == 0) scale = 0.;
+    else scale = (double)buffer[1] / (double)buffer[2];
+    for (i=0; i<PSPerfNumEvents; i++) {
+        values[i] = (pCounters->index[i] >= 0) ?
+                    (epicsUInt64)((double)buffer[3 + pCounters->index[i]] * scale + 0.5) : 0;
+    }
+    return 0;
+}
+
+#else /* Not Linux */
+
+int psPerfOpen(psPerfCounters *pCounters, char *errorMessage, size_t size)
+{
+    epicsSnprintf(errorMessage, size, "Not supported on this OS");
+    return -1;
+}
+
+void psPerfClose(psPerfCounters *pCounters)
+{
+    psPerfInit(pCounters);
+}
+
+int psPerfRead(psPerfCounters *pCounters, epicsUInt64 values[PSPerfNumEvents])
+{
+    return -1;
+}
+
+#endif
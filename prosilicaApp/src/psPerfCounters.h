@@ -0,0 +1,46 @@
+/* psPerfCounters.h
+ *
+ * Hardware performance counters of the calling thread, from perf_event_open on Linux.
+ *
+ * The counters are opened as one group, so they are read together with a single read().
+ * When the kernel multiplexes the group with other events the counts are scaled by the
+ * ratio of the time enabled to the time running, as perf stat does.
+ * Events which the CPU or the kernel does not provide are left out and read as 0.
+ * perf_event_open is often not permitted (kernel.perf_event_paranoid) or not available
+ * (virtual machines, other operating systems), in which case psPerfOpen fails and the
+ * caller carries on without the counters.
+ */
+
+#ifndef PS_PERF_COUNTERS_H
+#define PS_PERF_COUNTERS_H
+
+#include <stddef.h>
+#include <epicsTypes.h>
+
+typedef enum {
+    PSPerfCycles,
+    PSPerfInstructions,
+    PSPerfLLCMisses,
+    PSPerfDTLBMisses,
+    PSPerfNumEvents
+} PSPerfEvent_t;
+
+typedef struct psPerfCounters {
+    int fd[PSPerfNumEvents];     /* -1 for the events which are not open */
+    int index[PSPerfNumEvents];  /* Position of each event in the group read, -1 if not open */
+    int numOpen;
+    int tid;                     /* Thread the counters count */
+} psPerfCounters;
+
+/* Initializes the structure with no counters open */
+void psPerfInit(psPerfCounters *pCounters);
+/* Opens the counters for the calling thread, counting user space only.  Returns the number
+ * of events opened, or -1 with a message in errorMessage if the cycle counter can not be opened. */
+int psPerfOpen(psPerfCounters *pCounters, char *errorMessage, size_t size);
+void psPerfClose(psPerfCounters *pCounters);
+/* Reads all of the events.  Returns 0 on success. */
+int psPerfRead(psPerfCounters *pCounters, epicsUInt64 values[PSPerfNumEvents]);
+/* Returns the name of an event */
+const char *psPerfEventName(int event);
+
+#endif /* PS_PERF_COUNTERS_H */
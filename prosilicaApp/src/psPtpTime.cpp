@@ -0,0 +1,21 @@
+/* psPtpTime.cpp
+ *
+ * Conversion of the camera PTP timestamps, see psPtpTime.h.
+ */
+
+#include "psPtpTime.h"
+
+int psPtpTicksToEpicsTime(epicsUInt64 ticks, epicsUInt32 frequency, epicsTimeStamp *pTime)
+{
+    const epicsUInt64 epicsEpoch = (epicsUInt64)PS_PTP_TAI_UTC_OFFSET + POSIX_TIME_AT_EPICS_EPOCH;
+    epicsUInt64 sec, rem;
+
+    if (frequency == 0) return -1;
+    sec = ticks / frequency;
+    rem = ticks % frequency;
+    /* secPastEpoch is unsigned, so times before 1990 would wrap to the far future */
+    if ((sec < epicsEpoch) || (sec - epicsEpoch > 0xFFFFFFFFULL)) return -1;
+    pTime->secPastEpoch = (epicsUInt32)(sec - epicsEpoch);
+    pTime->nsec = (epicsUInt32)(rem * 1000000000ULL / frequency);
+    return 0;
+}
@@ -0,0 +1,22 @@
+/* psPtpTime.h
+ *
+ * Conversion of the timestamps of the camera IEEE 1588 (PTP) clock to EPICS time.
+ *
+ * A camera clock which is locked to a PTP master counts TAI time since the POSIX epoch,
+ * so its timestamps convert to EPICS time without reading the IOC clock.
+ */
+
+#ifndef PS_PTP_TIME_H
+#define PS_PTP_TIME_H
+
+#include <epicsTypes.h>
+#include <epicsTime.h>
+
+#define PS_PTP_TAI_UTC_OFFSET 37  /* Seconds between TAI, used by the camera PTP clock, and UTC */
+
+/* Converts ticks of a clock running at frequency Hz to EPICS time.  Returns 0, or -1 and
+ * leaves pTime unchanged if the time can not be an EPICS time, e.g. for a camera clock
+ * which has not been set by a PTP master and still counts from 0. */
+int psPtpTicksToEpicsTime(epicsUInt64 ticks, epicsUInt32 frequency, epicsTimeStamp *pTime);
+
+#endif /* PS_PTP_TIME_H */
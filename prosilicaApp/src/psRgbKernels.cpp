@@ -0,0 +1,47 @@
+/* psRgbKernels.cpp
+ *
+ * Pixel kernels for the RGB frames of the prosilica driver, see psRgbKernels.h.
+ */
+
+#include "psRgbKernels.h"
+
+/* Pixels split at a time.  The input and the three outputs of a tile stay in the L1 cache,
+ * and the tile is a whole number of cache lines for both pixel sizes. */
+#define DEINTERLEAVE_TILE 1024
+
+template <typename T>
+static void rgbDeinterleave(const T *pIn, T *pRed, T *pGreen, T *pBlue,
+                            int width, int height, size_t rowStride)
+{
+    const T *pSrc;
+    T *pR, *pG, *pB;
+    int x0, n, i, y;
+
+    for (y=0; y<height; y++) {
+        for (x0=0; x0<width; x0+=DEINTERLEAVE_TILE) {
+            n = width - x0;
+            if (n > DEINTERLEAVE_TILE) n = DEINTERLEAVE_TILE;
+            pSrc = pIn + 3 * ((size_t)y * width + x0);
+            pR = pRed   + y * rowStride + x0;
+            pG = pGreen + y * rowStride + x0;
+            pB = pBlue  + y * rowStride + x0;
+            for (i=0; i<n; i++) {
+                pR[i] = pSrc[3*i];
+                pG[i] = pSrc[3*i+1];
+                pB[i] = pSrc[3*i+2];
+            }
+        }
+    }
+}
+
+void psRgbDeinterleave8(const epicsUInt8 *pIn, epicsUInt8 *pRed, epicsUInt8 *pGreen, epicsUInt8 *pBlue,
+                        int width, int height, size_t rowStride)
+{
+    rgbDeinterleave<epicsUInt8>(pIn, pRed, pGreen, pBlue, width, height, rowStride);
+}
+
+void psRgbDeinterleave16(const epicsUInt16 *pIn, epicsUInt16 *pRed, epicsUInt16 *pGreen, epicsUInt16 *pBlue,
+                         int width, int height, size_t rowStride)
+{
+    rgbDeinterleave<epicsUInt16>(pIn, pRed, pGreen, pBlue, width, height, rowStride);
+}
@@ -0,0 +1,24 @@
+/* psRgbKernels.h
+ *
+ * Pixel kernels for the RGB frames of the prosilica driver.
+ *
+ * Like the Bayer kernels these are simple loops which the compiler can vectorize.  No target
+ * flags are set, so the instructions used are those of the target of the EPICS build.
+ */
+
+#ifndef PS_RGB_KERNELS_H
+#define PS_RGB_KERNELS_H
+
+#include <stddef.h>
+#include <epicsTypes.h>
+
+/* Splits interleaved RGB pixels (RGB1) into separate red, green and blue rows.  Row y of each
+ * colour is written at pRed, pGreen and pBlue + y*rowStride elements, so the same kernel writes
+ * RGB2 (the colours of a row follow each other, rowStride = 3*width) and RGB3 (one plane per
+ * colour, rowStride = width).  pIn must not overlap the output. */
+void psRgbDeinterleave8(const epicsUInt8 *pIn, epicsUInt8 *pRed, epicsUInt8 *pGreen, epicsUInt8 *pBlue,
+                        int width, int height, size_t rowStride);
+void psRgbDeinterleave16(const epicsUInt16 *pIn, epicsUInt16 *pRed, epicsUInt16 *pGreen, epicsUInt16 *pBlue,
+                         int width, int height, size_t rowStride);
+
+#endif /* PS_RGB_KERNELS_H */
@@ -0,0 +1,97 @@
+/* psHostStatsTest.cpp
+ *
+ * Tests of the readers of the host network counters against the fixture trees in
+ * fixtures/, which hold the /proc and /sys files of a made up host.  The route and
+ * socket addresses in the fixtures are in the byte order of a little endian host.
+ */
+
+#include <string.h>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include "psHostStats.h"
+
+/* The tests run in the O.<arch> directory */
+#define FIXTURE_ROOT     "../fixtures/hostStats"
+#define FIXTURE_NO_FD    "../fixtures/hostStatsNoFd"
+#define FIXTURE_MISSING  "../fixtures/missing"
+
+static void testFindInterface(void)
+{
+    char ifName[PS_HOST_IFNAME_SIZE] = "";
+    int status;
+
+    testDiag("psHostFindInterface");
+    status = psHostFindInterface(FIXTURE_ROOT, "169.254.1.10", ifName, sizeof(ifName));
+    testOk(status == 0 && strcmp(ifName, "eth2") == 0, "Most specific route, got %s", ifName);
+    status = psHostFindInterface(FIXTURE_ROOT, "169.254.7.7", ifName, sizeof(ifName));
+    testOk(status == 0 && strcmp(ifName, "eth1") == 0, "Wider route, got %s", ifName);
+    status = psHostFindInterface(FIXTURE_ROOT, "192.168.2.50", ifName, sizeof(ifName));
+    testOk(status == 0 && strcmp(ifName, "eth4") == 0, "Direct route before the default route, got %s", ifName);
+    status = psHostFindInterface(FIXTURE_ROOT, "10.1.2.3", ifName, sizeof(ifName));
+    testOk(status == 0 && strcmp(ifName, "eth0") == 0, "Default route, got %s", ifName);
+    status = psHostFindInterface(FIXTURE_ROOT, "192.168.3.5", ifName, sizeof(ifName));
+    testOk(status == 0 && strcmp(ifName, "eth0") == 0, "Route which is down is ignored, got %s", ifName);
+    testOk(psHostFindInterface(FIXTURE_ROOT, "300.1.2.3", ifName, sizeof(ifName)) == -1,
+           "Invalid address is rejected");
+    testOk(psHostFindInterface(FIXTURE_MISSING, "10.1.2.3", ifName, sizeof(ifName)) == -1,
+           "Missing route file is an error");
+}
+
+static void testUdp(void)
+{
+    epicsUInt64 value = 0;
+    int status;
+
+    testDiag("UDP counters");
+    status = psHostReadUdpDrops(FIXTURE_ROOT, &value);
+    testOk(status == 0 && value == 20, "Drops of the sockets of the process, got %llu", (unsigned long long)value);
+    status = psHostReadUdpDrops(FIXTURE_NO_FD, &value);
+    testOk(status == 0 && value == 1020, "Drops of every socket without the fd directory, got %llu", (unsigned long long)value);
+    status = psHostReadSnmpUdp(FIXTURE_ROOT, "RcvbufErrors", &value);
+    testOk(status == 0 && value == 42, "Udp RcvbufErrors, not UdpLite, got %llu", (unsigned long long)value);
+    status = psHostReadSnmpUdp(FIXTURE_ROOT, "InErrors", &value);
+    testOk(status == 0 && value == 45, "Udp InErrors, got %llu", (unsigned long long)value);
+    testOk(psHostReadSnmpUdp(FIXTURE_ROOT, "NoSuchCounter", &value) == -1, "Unknown counter is an error");
+    testOk(psHostReadSnmpUdp(FIXTURE_MISSING, "RcvbufErrors", &value) == -1, "Missing snmp file is an error");
+}
+
+static void testNic(void)
+{
+    epicsUInt64 value = 0;
+    psHostNetStats stats;
+    int status;
+
+    testDiag("Interface counters and rmem_max");
+    status = psHostReadNicCounter(FIXTURE_ROOT, "eth1", "rx_missed_errors", &value);
+    testOk(status == 0 && value == 7, "rx_missed_errors, got %llu", (unsigned long long)value);
+    testOk(psHostReadNicCounter(FIXTURE_ROOT, "eth2", "rx_missed_errors", &value) == -1,
+           "Interface without statistics is an error");
+    testOk(psHostReadNicCounter(FIXTURE_ROOT, "", "rx_dropped", &value) == -1, "Empty interface name is an error");
+    status = psHostReadRmemMax(FIXTURE_ROOT, &value);
+    testOk(status == 0 && value == 26214400, "rmem_max, got %llu", (unsigned long long)value);
+
+    memset(&stats, 0xff, sizeof(stats));
+    strcpy(stats.ifName, "eth1");
+    testOk1(psHostReadNetStats(FIXTURE_ROOT, &stats) == 0);
+    testOk(stats.udpDrops == 20 && stats.udpRcvbufErrors == 42 && stats.nicRxMissed == 7 &&
+           stats.nicRxDropped == 11 && stats.rmemMax == 26214400, "All of the counters of eth1");
+    strcpy(stats.ifName, "eth1");
+    testOk(psHostReadNetStats(FIXTURE_MISSING, &stats) == -1 && stats.udpDrops == 0 &&
+           stats.nicRxMissed == 0 && stats.rmemMax == 0, "No counters are 0 and an error");
+}
+
+MAIN(psHostStatsTest)
+{
+#if defined(linux) || defined(__linux__)
+    testPlan(20);
+    testFindInterface();
+    testUdp();
+    testNic();
+#else
+    testPlan(1);
+    testSkip(1, "The host counters are only read on Linux");
+#endif
+    return testDone();
+}
@@ -0,0 +1,56 @@
+/* psPtpTimeTest.cpp
+ *
+ * Tests of the conversion of the camera PTP timestamps to EPICS time.
+ */
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include "psPtpTime.h"
+
+/* TAI seconds since the POSIX epoch at the EPICS epoch */
+static const epicsUInt64 epicsEpoch = (epicsUInt64)PS_PTP_TAI_UTC_OFFSET + POSIX_TIME_AT_EPICS_EPOCH;
+
+static void testConversion(void)
+{
+    epicsTimeStamp t;
+    const epicsUInt32 freq = 1000000000;
+
+    testDiag("Conversion at 1 GHz");
+    testOk1(psPtpTicksToEpicsTime(epicsEpoch * freq, freq, &t) == 0);
+    testOk(t.secPastEpoch == 0 && t.nsec == 0, "EPICS epoch gives 0, got %u.%09u", t.secPastEpoch, t.nsec);
+
+    /* 2024-01-01 00:00:00 UTC is POSIX 1704067200 */
+    testOk1(psPtpTicksToEpicsTime((1704067200ULL + PS_PTP_TAI_UTC_OFFSET) * freq + 250000000, freq, &t) == 0);
+    testOk(t.secPastEpoch == 1704067200u - POSIX_TIME_AT_EPICS_EPOCH && t.nsec == 250000000,
+           "2024-01-01 00:00:00.25 UTC, got %u.%09u", t.secPastEpoch, t.nsec);
+
+    testDiag("Conversion at a frequency which does not divide 1 s");
+    testOk1(psPtpTicksToEpicsTime((epicsEpoch + 10) * 79861111 + 79861110, 79861111, &t) == 0);
+    testOk(t.secPastEpoch == 10 && t.nsec == 999999987, "Last tick of a second, got %u.%09u",
+           t.secPastEpoch, t.nsec);
+}
+
+static void testInvalid(void)
+{
+    epicsTimeStamp t, before;
+
+    testDiag("Times which are not EPICS times");
+    t.secPastEpoch = 1234;
+    t.nsec = 5678;
+    before = t;
+    testOk(psPtpTicksToEpicsTime(1000, 1000000000, &t) == -1, "Unset camera clock near 0 is rejected");
+    testOk(psPtpTicksToEpicsTime((epicsEpoch - 1) * 1000, 1000, &t) == -1, "Second before the EPICS epoch is rejected");
+    testOk(psPtpTicksToEpicsTime((epicsEpoch + 0x100000000ULL) * 1000, 1000, &t) == -1,
+           "Time beyond the EPICS time range is rejected");
+    testOk(psPtpTicksToEpicsTime(epicsEpoch * 1000, 0, &t) == -1, "Frequency 0 is rejected");
+    testOk(t.secPastEpoch == before.secPastEpoch && t.nsec == before.nsec, "Time unchanged after errors");
+}
+
+MAIN(psPtpTimeTest)
+{
+    testPlan(11);
+    testConversion();
+    testInvalid();
+    return testDone();
+}